@@ -120,6 +120,29 @@ function GameState:init()
         
     end
 
+    -- Consecutive C++ systems are updated by a SystemScheduler, which runs
+    -- systems with non-conflicting component access in parallel. Lua
+    -- systems are always updated on the main thread.
+    self.updateStages = {}
+    local scheduler = nil
+    for i,s in ipairs(self.systems) do
+
+        if s.isCppSystem then
+
+            if scheduler == nil then
+                scheduler = SystemScheduler.new()
+                table.insert(self.updateStages, scheduler)
+            end
+
+            scheduler:addSystem(s)
+            
+        else
+
+            scheduler = nil
+            table.insert(self.updateStages, s)
+        end
+    end
+
     if self.extraInitializer ~= nil then
 
         self:extraInitializer()
@@ -140,6 +163,7 @@ function GameState:shutdown()
         
     end
     
+    self.updateStages = nil
     self.cppData = nil
     self.physicsWorld = nil
     self.entityManager = nil
@@ -180,7 +204,7 @@ end
 --! @brief Updates game logic
 function GameState:update(renderTime, logicTime)
 
-    for i,s in ipairs(self.systems) do
+    for i,s in ipairs(self.updateStages) do
         --Uncomment to debug mystical crashes and other anomalies
         -- print("Updating system " .. s.name)
         s:update(renderTime, logicTime)
@@ -195,9 +219,15 @@ end
 --! @brief Restores saved entities from storage
 --! @param storage the StorageContainer that was created with a previous call to
 --! GameState:storage
-function GameState:load(storage)
+--! @param delta optional StorageContainer from GameState:storage("delta"),
+--! applied on top of a "snapshot" storage
+function GameState:load(storage, delta)
 
     local entities = storage:get("entities")
+
+    if delta ~= nil then
+        entities = EntityManager.applyDelta(entities, delta:get("entities"))
+    end
     
     self.entityManager:clear()
 
@@ -207,10 +237,19 @@ end
 
 --! @brief Saves all current entities into a StorageContainer
 --! @see GameState:load
+--! @param mode "full" (the default), "snapshot" or "delta", see
+--! EntityManager::snapshot and EntityManager::delta
 --! @returns StorageContainer
-function GameState:storage()
+function GameState:storage(mode)
     
-    local entities = self.entityManager:storage(Engine.componentFactory)
+    local entities
+    if mode == "snapshot" then
+        entities = self.entityManager:snapshot(Engine.componentFactory)
+    elseif mode == "delta" then
+        entities = self.entityManager:delta(Engine.componentFactory)
+    else
+        entities = self.entityManager:storage(Engine.componentFactory)
+    end
 
     local storage = StorageContainer.new()
     storage:set("entities", entities)
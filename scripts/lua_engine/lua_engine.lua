@@ -368,7 +368,8 @@ end
 
 --! @protected @brief Called from C++ side to load game states from a StorageContainer
 --! @param saveGame StorageContainer with saved data
-function LuaEngine:loadSavegameGameStates(saveGame)
+--! @param delta optional StorageContainer with the changes since saveGame
+function LuaEngine:loadSavegameGameStates(saveGame, delta)
 
     local previousGameState = self.currentGameState
 
@@ -376,6 +377,11 @@ function LuaEngine:loadSavegameGameStates(saveGame)
 
     local gameStatesContainer = saveGame:get("gameStates")
 
+    local deltaGameStates = nil
+    if delta ~= nil then
+        deltaGameStates = delta:get("gameStates")
+    end
+
     for name, system in pairs(self.gameStates) do
 
         if gameStatesContainer:contains(name) then
@@ -384,7 +390,11 @@ function LuaEngine:loadSavegameGameStates(saveGame)
             -- during loading, temporarily switch it
             self.currentGameState = system
             
-            system:load(gameStatesContainer:get(name))
+            if deltaGameStates ~= nil and deltaGameStates:contains(name) then
+                system:load(gameStatesContainer:get(name), deltaGameStates:get(name))
+            else
+                system:load(gameStatesContainer:get(name))
+            end
 
         else 
             system.entityManager:clear()
@@ -411,7 +421,7 @@ function LuaEngine:loadSavegameGameStates(saveGame)
     self.currentGameState = nil
     
     -- Switch gamestate
-    local gameStateName = saveGame:get("currentGameState")
+    local gameStateName = (delta or saveGame):get("currentGameState")
 
     local gameState = self:getGameState(gameStateName)
 
@@ -431,7 +441,8 @@ end
 
 --! @protected @brief Called from C++ side to load game states from a StorageContainer
 --! @param saveGame StorageContainer to be filled with saved data
-function LuaEngine:saveCurrentStates(saveGame)
+--! @param mode passed on to GameState:storage
+function LuaEngine:saveCurrentStates(saveGame, mode)
 
     saveGame:set("currentGameState", self.currentGameState.name)
     
@@ -439,7 +450,7 @@ function LuaEngine:saveCurrentStates(saveGame)
 
     for name, system in pairs(self.gameStates) do
 
-        gameStatesContainer:set(name, system:storage())
+        gameStatesContainer:set(name, system:storage(mode))
         
     end
     
@@ -447,6 +458,20 @@ function LuaEngine:saveCurrentStates(saveGame)
     
 end
 
+--! @protected @brief Called from C++ side when a savegame has been written
+--! @param filename The savegame file
+--! @param succeeded Whether the file was written completely
+--! @param errorMessage What went wrong, if anything
+function LuaEngine:savegameWritten(filename, succeeded, errorMessage)
+
+    if succeeded then
+        print("Saved " .. filename)
+    else
+        print("Error saving " .. filename .. ": " .. errorMessage)
+    end
+    
+end
+
 --! Sets the console object. Called from console.lua
 function LuaEngine:registerConsoleObject(console)
 
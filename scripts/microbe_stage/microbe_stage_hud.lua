@@ -614,7 +614,7 @@ currentHint = currentHint - 1
 end
 function HudSystem:saveButtonClicked()
     getComponent("gui_sounds", self.gameState, SoundSourceComponent):playSound("button-hover-click")
-    Engine:save("quick.sav")
+    Engine:saveIncremental("quick.sav")
     print("Game Saved");
 	--Because using update load button here doesn't seem to work unless you press save twice
     self.rootGUIWindow:getChild("PauseMenu"):getChild("LoadGameButton"):enable();
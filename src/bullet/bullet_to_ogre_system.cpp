@@ -33,6 +33,10 @@ struct BulletToOgreSystem::Implementation {
 BulletToOgreSystem::BulletToOgreSystem()
   : m_impl(new Implementation())
 {
+    // Only copies into the transforms, OgreUpdateSceneNodeSystem applies
+    // them to the scene
+    this->declareRead(RigidBodyComponent::TYPE_ID);
+    this->declareWrite(OgreSceneNodeComponent::TYPE_ID);
 }
 
 
@@ -57,7 +61,7 @@ BulletToOgreSystem::shutdown() {
 
 void
 BulletToOgreSystem::update(int, int) {
-    for (auto& value : m_impl->m_entities) {
+    m_impl->m_entities.parallelForEach([](const auto& value) {
         RigidBodyComponent* rigidBodyComponent = std::get<0>(value.second);
         OgreSceneNodeComponent* sceneNodeComponent = std::get<1>(value.second);
         auto& sceneNodeTransform = sceneNodeComponent->m_transform;
@@ -65,7 +69,7 @@ BulletToOgreSystem::update(int, int) {
         sceneNodeTransform.orientation = rigidBodyProperties.rotation;
         sceneNodeTransform.position = rigidBodyProperties.position;
         sceneNodeTransform.touch();
-    }
+    }, 256);
 }
 
 
@@ -141,6 +141,11 @@ struct CollisionSystem::Implementation {
 CollisionSystem::CollisionSystem()
   : m_impl(new Implementation())
 {
+    // Clears the contact manifolds of the world's dispatcher. The rigid
+    // bodies stand in for the physics world, so this can't run in parallel
+    // to anything else that touches it.
+    this->declareRead(CollisionComponent::TYPE_ID);
+    this->declareWrite(RigidBodyComponent::TYPE_ID);
 }
 
 
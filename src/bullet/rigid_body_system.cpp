@@ -209,7 +209,7 @@ RigidBodyComponent::storage() const {
     return storage;
 }
 
-REGISTER_COMPONENT(RigidBodyComponent)
+REGISTER_COMPONENT_WITH_STORAGE(RigidBodyComponent, Dense)
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -504,6 +504,9 @@ struct RigidBodyOutputSystem::Implementation {
 RigidBodyOutputSystem::RigidBodyOutputSystem()
   : m_impl(new Implementation())
 {
+    // Copies the stepped bodies' state into each component's dynamic
+    // properties
+    this->declareWrite(RigidBodyComponent::TYPE_ID);
 }
 
 
@@ -0,0 +1,157 @@
+// Measures savegame throughput
+//
+// Encodes and decodes a synthetic savegame shaped like the output of
+// EntityManager::storage() and reports MB/s and heap allocations per run.
+//
+//     SerializationBenchmark [componentCount] [iterations]
+
+#include "engine/savegame_compression.h"
+#include "engine/serialization.h"
+#include "engine/tests/savegame_generator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+
+using namespace thrive;
+
+namespace {
+
+std::atomic<size_t> g_allocations {0};
+
+struct Measurement {
+
+    size_t allocations;
+
+    double seconds;
+
+};
+
+/**
+* @brief Runs \a function \a iterations times
+*
+* @return
+*   Time and allocations of an average run
+*/
+template<typename Function>
+Measurement
+measure(
+    unsigned int iterations,
+    Function function
+) {
+    // Warm up
+    function();
+    size_t allocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; ++i) {
+        function();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return Measurement{
+        (g_allocations - allocations) / iterations,
+        elapsed.count() / iterations
+    };
+}
+
+
+void
+report(
+    const char* name,
+    size_t bytes,
+    const Measurement& measurement
+) {
+    std::printf(
+        "%-24s %10.2f ms %10.1f MB/s %12zu allocations\n",
+        name,
+        measurement.seconds * 1000.0,
+        bytes / measurement.seconds / (1024.0 * 1024.0),
+        measurement.allocations
+    );
+}
+
+} // namespace
+
+
+void*
+operator new(
+    size_t size
+) {
+    ++g_allocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+
+void
+operator delete(
+    void* memory
+) noexcept {
+    std::free(memory);
+}
+
+
+void
+operator delete(
+    void* memory,
+    size_t
+) noexcept {
+    ::operator delete(memory);
+}
+
+
+int
+main(
+    int argc,
+    char** argv
+) {
+    unsigned int componentCount = argc > 1 ? std::stoul(argv[1]) : 20000;
+    unsigned int iterations = argc > 2 ? std::stoul(argv[2]) : 10;
+    StorageContainer savegame = generateSavegame(componentCount);
+    std::string encoded;
+    {
+        std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+        stream << savegame;
+        encoded = stream.str();
+    }
+    std::string compressed = SavegameCompression::compress(encoded);
+    std::printf(
+        "%u components, %zu bytes encoded, %zu bytes compressed, %u iterations\n\n",
+        componentCount,
+        encoded.size(),
+        compressed.size(),
+        iterations
+    );
+    // Throughput is relative to the uncompressed size throughout
+    report("encode", encoded.size(), measure(iterations, [&] {
+        std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+        stream << savegame;
+    }));
+    report("decode", encoded.size(), measure(iterations, [&] {
+        std::istringstream stream(encoded, std::ios_base::in | std::ios_base::binary);
+        StorageContainer storage;
+        stream >> storage;
+    }));
+    report("compress", encoded.size(), measure(iterations, [&] {
+        SavegameCompression::compress(encoded);
+    }));
+    report("decompress", encoded.size(), measure(iterations, [&] {
+        SavegameCompression::decompress(compressed.data(), compressed.size());
+    }));
+    report("decode compressed", encoded.size(), measure(iterations, [&] {
+        std::istringstream stream(compressed, std::ios_base::in | std::ios_base::binary);
+        StorageContainer storage;
+        stream >> storage;
+    }));
+    report("view one collection", encoded.size(), measure(iterations, [&] {
+        StorageView view = StorageView::fromBuffer(encoded);
+        view.view("collections").list("MicrobeComponent");
+    }));
+    return 0;
+}
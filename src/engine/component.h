@@ -3,6 +3,7 @@
 */
 #pragma once
 
+#include "engine/component_pool.h"
 #include "engine/typedefs.h"
 
 #include <memory>
@@ -152,6 +153,8 @@ private:
 *   variable.
 * - \c typeName: Overrides Component::typeName() and returns the name returned
 *   by \c TYPE_NAME.
+* - \c operator \c new and \c operator \c delete: Allocate instances from
+*   the component's own ComponentPool, see COMPONENT_POOL_ALLOCATION.
 *
 * @param name 
 *   The component's name
@@ -183,7 +186,7 @@ private:
             return TYPE_NAME(); \
         } \
         \
-    private: \
+    COMPONENT_POOL_ALLOCATION \
 
 
 /**
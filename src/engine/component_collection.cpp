@@ -2,38 +2,196 @@
 
 #include "util/contains.h"
 
+#include <array>
 #include <iostream>
+#include <limits>
+#include <unordered_map>
 #include <unordered_set>
 #include <stdexcept>
 
 
 using namespace thrive;
 
+namespace {
+
+using Index = uint32_t;
+
+static const Index INVALID_INDEX = std::numeric_limits<Index>::max();
+
+// Number of entity ids covered by one page of a dense index
+static const size_t INDEX_PAGE_SIZE = 4096;
+
+using IndexPage = std::array<Index, INDEX_PAGE_SIZE>;
+
+using StorageRegistry = std::unordered_map<
+    ComponentTypeId,
+    ComponentCollection::Storage
+>;
+
+StorageRegistry&
+storageRegistry() {
+    static StorageRegistry registry;
+    return registry;
+}
+
+} // namespace
+
+
 struct ComponentCollection::Implementation {
 
     Implementation(
-        ComponentTypeId type
-    ) : m_type(type)
+        ComponentTypeId type,
+        Storage storage
+    ) : m_storage(storage),
+        m_type(type)
     {
     }
 
+    Index
+    findIndex(
+        EntityId entityId
+    ) const {
+        if (m_storage == Storage::Dense) {
+            EntityId slot = entityIndex(entityId);
+            size_t page = slot / INDEX_PAGE_SIZE;
+            if (page >= m_indexPages.size() or not m_indexPages[page]) {
+                return INVALID_INDEX;
+            }
+            Index index = (*m_indexPages[page])[slot % INDEX_PAGE_SIZE];
+            // The slot may be used by a different generation of the entity
+            if (index == INVALID_INDEX or m_entities[index] != entityId) {
+                return INVALID_INDEX;
+            }
+            return index;
+        }
+        else {
+            auto iter = m_indexMap.find(entityId);
+            if (iter == m_indexMap.end()) {
+                return INVALID_INDEX;
+            }
+            return iter->second;
+        }
+    }
+
+    void
+    setIndex(
+        EntityId entityId,
+        Index index
+    ) {
+        if (m_storage == Storage::Dense) {
+            EntityId slot = entityIndex(entityId);
+            size_t page = slot / INDEX_PAGE_SIZE;
+            if (page >= m_indexPages.size()) {
+                m_indexPages.resize(page + 1);
+            }
+            if (not m_indexPages[page]) {
+                m_indexPages[page].reset(new IndexPage());
+                m_indexPages[page]->fill(INVALID_INDEX);
+            }
+            (*m_indexPages[page])[slot % INDEX_PAGE_SIZE] = index;
+        }
+        else if (index == INVALID_INDEX) {
+            m_indexMap.erase(entityId);
+        }
+        else {
+            m_indexMap[entityId] = index;
+        }
+    }
+
+    void
+    notifyAdded(
+        EntityId entityId,
+        Component& component
+    ) {
+        for (auto& value : m_changeCallbacks) {
+            value.second.first(entityId, component);
+        }
+    }
+
+    void
+    notifyRemoved(
+        EntityId entityId,
+        Component& component
+    ) {
+        for (auto& value : m_changeCallbacks) {
+            value.second.second(entityId, component);
+        }
+    }
+
+    void
+    removeAt(
+        Index index
+    ) {
+        this->notifyRemoved(m_entities[index], *m_components[index]);
+        this->eraseAt(index);
+    }
+
+    void
+    eraseAt(
+        Index index
+    ) {
+        EntityId entityId = m_entities[index];
+        std::unique_ptr<Component> component = std::move(m_components[index]);
+        component->setOwner(NULL_ENTITY);
+        // Swap and pop
+        Index last = static_cast<Index>(m_entities.size() - 1);
+        if (index != last) {
+            m_entities[index] = m_entities[last];
+            m_components[index] = std::move(m_components[last]);
+            this->setIndex(m_entities[index], index);
+        }
+        m_entities.pop_back();
+        m_components.pop_back();
+        this->setIndex(entityId, INVALID_INDEX);
+    }
+
     std::unordered_map<
         unsigned int,
         std::pair<ChangeCallback, ChangeCallback>
     > m_changeCallbacks;
 
-    std::unordered_map<EntityId, std::unique_ptr<Component>> m_components;
+    std::vector<std::unique_ptr<Component>> m_components;
+
+    std::vector<EntityId> m_entities;
+
+    std::unordered_map<EntityId, Index> m_indexMap;
+
+    std::vector<std::unique_ptr<IndexPage>> m_indexPages;
 
     unsigned int m_nextChangeCallbackId = 0;
 
+    Storage m_storage = Storage::Map;
+
     ComponentTypeId m_type = NULL_COMPONENT_TYPE;
 
 };
 
 
-ComponentCollection::ComponentCollection(
+ComponentCollection::Storage
+ComponentCollection::defaultStorage(
     ComponentTypeId type
-) : m_impl(new Implementation(type))
+) {
+    auto iter = storageRegistry().find(type);
+    if (iter == storageRegistry().end()) {
+        return Storage::Map;
+    }
+    return iter->second;
+}
+
+
+void
+ComponentCollection::setDefaultStorage(
+    ComponentTypeId type,
+    Storage storage
+) {
+    storageRegistry()[type] = storage;
+}
+
+
+ComponentCollection::ComponentCollection(
+    ComponentTypeId type,
+    Storage storage
+) : m_impl(new Implementation(type, storage))
 {
 }
 
@@ -55,22 +213,22 @@ ComponentCollection::addComponent(
     std::unique_ptr<Component> component
 ) {
     bool isNew = true;
+    Component* rawComponent = component.get();
+    Index index = m_impl->findIndex(entityId);
     // Check if we are overwriting an old component
-    if (m_impl->m_components.erase(entityId) > 0) {
+    if (index != INVALID_INDEX) {
         isNew = false;
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *component);
-        }
+        m_impl->notifyRemoved(entityId, *m_impl->m_components[index]);
+        m_impl->m_components[index]->setOwner(NULL_ENTITY);
+        m_impl->m_components[index] = std::move(component);
     }
-    // Insert new component
-    Component* rawComponent = component.get();
-    m_impl->m_components.insert(std::make_pair(
-        entityId,
-        std::move(component)
-    ));
-    for (auto& value : m_impl->m_changeCallbacks) {
-        value.second.first(entityId, *rawComponent);
+    else {
+        index = static_cast<Index>(m_impl->m_entities.size());
+        m_impl->m_entities.push_back(entityId);
+        m_impl->m_components.push_back(std::move(component));
+        m_impl->setIndex(entityId, index);
     }
+    m_impl->notifyAdded(entityId, *rawComponent);
     rawComponent->setOwner(entityId);
     return isNew;
 }
@@ -78,20 +236,15 @@ ComponentCollection::addComponent(
 
 void
 ComponentCollection::clear() {
-    auto iter = m_impl->m_components.begin();
-    while (iter != m_impl->m_components.end()) {
-        EntityId entityId = iter->first;
-        std::unique_ptr<Component>& component = iter->second;
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *component);
-        }
-        component->setOwner(NULL_ENTITY);
-        iter = m_impl->m_components.erase(iter);
+    while (not m_impl->m_entities.empty()) {
+        m_impl->removeAt(static_cast<Index>(m_impl->m_entities.size() - 1));
     }
+    m_impl->m_indexMap.clear();
+    m_impl->m_indexPages.clear();
 }
 
 
-const std::unordered_map<EntityId, std::unique_ptr<Component>>&
+const std::vector<std::unique_ptr<Component>>&
 ComponentCollection::components() const {
     return m_impl->m_components;
 }
@@ -103,13 +256,19 @@ ComponentCollection::empty() const {
 }
 
 
+const std::vector<EntityId>&
+ComponentCollection::entities() const {
+    return m_impl->m_entities;
+}
+
+
 Component*
 ComponentCollection::get(
     EntityId entityId
 ) const {
-    auto iter = m_impl->m_components.find(entityId);
-    if (iter != m_impl->m_components.end()) {
-        return iter->second.get();
+    Index index = m_impl->findIndex(entityId);
+    if (index != INVALID_INDEX) {
+        return m_impl->m_components[index].get();
     }
     else {
         return nullptr;
@@ -135,19 +294,53 @@ bool
 ComponentCollection::removeComponent(
     EntityId entityId
 ) {
-    auto iter = m_impl->m_components.find(entityId);
-    if (iter != m_impl->m_components.end()) {
-        for (auto& value : m_impl->m_changeCallbacks) {
-            value.second.second(entityId, *iter->second);
-        }
-        iter->second->setOwner(NULL_ENTITY);
-        m_impl->m_components.erase(iter);
+    Index index = m_impl->findIndex(entityId);
+    if (index != INVALID_INDEX) {
+        m_impl->removeAt(index);
         return true;
     }
     return false;
 }
 
 
+size_t
+ComponentCollection::removeComponents(
+    const std::vector<EntityId>& entityIds
+) {
+    // Dispatch per callback so that each listener handles the whole batch
+    // in one go. All components are still in place at this point.
+    for (auto& value : m_impl->m_changeCallbacks) {
+        for (EntityId entityId : entityIds) {
+            Index index = m_impl->findIndex(entityId);
+            if (index != INVALID_INDEX) {
+                value.second.second(entityId, *m_impl->m_components[index]);
+            }
+        }
+    }
+    size_t removed = 0;
+    for (EntityId entityId : entityIds) {
+        Index index = m_impl->findIndex(entityId);
+        if (index != INVALID_INDEX) {
+            m_impl->eraseAt(index);
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+
+size_t
+ComponentCollection::size() const {
+    return m_impl->m_components.size();
+}
+
+
+ComponentCollection::Storage
+ComponentCollection::storage() const {
+    return m_impl->m_storage;
+}
+
+
 ComponentTypeId
 ComponentCollection::type() const {
     return m_impl->m_type;
@@ -160,4 +353,3 @@ ComponentCollection::unregisterChangeCallbacks(
 ) {
     m_impl->m_changeCallbacks.erase(id);
 }
-
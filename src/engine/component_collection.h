@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <functional>
+#include <vector>
 
 namespace thrive {
 
@@ -18,6 +19,11 @@ class EntityManager;
 * callbacks for when a component has been added or removed (mainly used by
 * the EntityFilter).
 *
+* Components are kept in packed arrays (one for the owning entities, one for
+* the components) so that iterating over a collection is a linear scan. Which
+* structure maps an entity id to its index in those arrays is selected per
+* component type, see ComponentCollection::Storage.
+*
 * Component collections are pretty much read-only for anything but the
 * EntityManager. Use the manager to actually add or remove components.
 */
@@ -30,6 +36,62 @@ public:
     */
     using ChangeCallback = std::function<void(EntityId, Component&)>;
 
+    /**
+    * @brief How a collection maps entity ids to its packed arrays
+    */
+    enum class Storage {
+
+        /**
+        * @brief Hash map index
+        *
+        * Memory scales with the number of components. Best for component
+        * types that only few entities have.
+        */
+        Map,
+
+        /**
+        * @brief Sparse set index
+        *
+        * A paged array indexed directly by the entity's slot index. Lookups
+        * are a single array access, but pages are allocated for the whole
+        * slot range in use. Best for component types that many entities have.
+        */
+        Dense
+
+    };
+
+    /**
+    * @brief Returns the storage used for new collections of a type
+    *
+    * @param type
+    *   The component type
+    *
+    * @return
+    *   The storage set by setDefaultStorage() or Storage::Map if none was
+    *   set.
+    */
+    static Storage
+    defaultStorage(
+        ComponentTypeId type
+    );
+
+    /**
+    * @brief Sets the storage used for new collections of a type
+    *
+    * Already existing collections are not affected. Usually called through
+    * REGISTER_COMPONENT_WITH_STORAGE.
+    *
+    * @param type
+    *   The component type
+    * @param storage
+    *   The storage to use
+    */
+    static void
+    setDefaultStorage(
+        ComponentTypeId type,
+        Storage storage
+    );
+
     /**
     * @brief Destructor
     */
@@ -50,10 +112,12 @@ public:
     clear();
 
     /**
-    * @brief Returns a reference to the internal component map
+    * @brief Returns the packed array of components
     *
+    * The component at index \a i belongs to the entity at index \a i of
+    * entities(). The order changes when components are removed.
     */
-    const std::unordered_map<EntityId, std::unique_ptr<Component>>&
+    const std::vector<std::unique_ptr<Component>>&
     components() const;
 
     /**
@@ -64,6 +128,14 @@ public:
     bool
     empty() const;
 
+    /**
+    * @brief Returns the packed array of entities
+    *
+    * @see components()
+    */
+    const std::vector<EntityId>&
+    entities() const;
+
     /**
     * @brief Retrieves a component from the collection
     *
@@ -98,6 +170,18 @@ public:
         ChangeCallback onComponentRemoved
     );
 
+    /**
+    * @brief The number of components in this collection
+    */
+    size_t
+    size() const;
+
+    /**
+    * @brief The storage used by this collection
+    */
+    Storage
+    storage() const;
+
     /**
     * @brief The type id of the collection's components
     */
@@ -128,9 +212,11 @@ private:
     * @brief Constructor
     *
     * @param type The type id of the components held by this collection.
+    * @param storage The index structure to use
     */
     ComponentCollection(
-        ComponentTypeId type
+        ComponentTypeId type,
+        Storage storage
     );
 
     /**
@@ -156,7 +242,8 @@ private:
     /**
     * @brief Removes a component
     *
-    * Also calls any callbacks registered for removed components.
+    * Also calls any callbacks registered for removed components. The last
+    * component is moved into the freed slot of the packed arrays.
     *
     * @param entityId
     *   The entity the component belongs to
@@ -170,6 +257,25 @@ private:
         EntityId entityId
     );
 
+    /**
+    * @brief Removes the components of several entities
+    *
+    * Calls every registered removal callback for all affected entities
+    * before any component is destroyed. Entities without a component in
+    * this collection are skipped.
+    *
+    * @param entityIds
+    *   The entities whose components should be removed. Must not contain
+    *   duplicates.
+    *
+    * @return
+    *   The number of removed components
+    */
+    size_t
+    removeComponents(
+        const std::vector<EntityId>& entityIds
+    );
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
 
@@ -4,6 +4,8 @@
 
 #include "scripting/wrapper_classes.h"
 
+#include <unordered_set>
+
 using namespace thrive;
 
 using Registry = std::unordered_map<
@@ -33,6 +35,13 @@ globalRegistry() {
 }
 
 
+static std::unordered_set<std::string>&
+threadSafeTypes() {
+    static std::unordered_set<std::string> names;
+    return names;
+}
+
+
 static ComponentTypeId
 ComponentFactory_registerComponentType(
     ComponentFactory* self,
@@ -132,6 +141,21 @@ ComponentFactory::getTypeId(
 }
 
 
+ComponentFactory::ComponentLoader
+ComponentFactory::getLoader(
+    const std::string& name
+) const {
+    auto iter = globalRegistry().find(name);
+    if (iter == globalRegistry().end()) {
+        iter = m_impl->m_registry.find(name);
+        if (iter == m_impl->m_registry.end()) {
+            return ComponentLoader();
+        }
+    }
+    return iter->second.second;
+}
+
+
 std::string
 ComponentFactory::getTypeName(
     ComponentTypeId typeId
@@ -150,6 +174,22 @@ ComponentFactory::getTypeName(
 }
 
 
+void
+ComponentFactory::setThreadSafe(
+    const std::string& name
+) {
+    threadSafeTypes().insert(name);
+}
+
+
+bool
+ComponentFactory::isThreadSafeType(
+    const std::string& name
+) const {
+    return threadSafeTypes().count(name) > 0;
+}
+
+
 std::unique_ptr<Component>
 ComponentFactory::load(
     const std::string& typeName,
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "engine/component.h"
+#include "engine/component_collection.h"
 #include "util/make_unique.h"
 
 #include <functional>
@@ -78,6 +79,60 @@ public:
         );
     }
 
+    /**
+    * @brief Registers a component type with a non-default storage
+    *
+    * @tparam C
+    *   The subclass of Component.
+    *
+    * @param storage
+    *   The storage entity managers use for collections of this type
+    *
+    * @return The type's unique id
+    *
+    * @note
+    *   You should probably use the REGISTER_COMPONENT_WITH_STORAGE macro
+    *   instead of calling this directly.
+    */
+    template<typename C>
+    static ComponentTypeId
+    registerGlobalComponentType(
+        ComponentCollection::Storage storage
+    ) {
+        ComponentTypeId typeId = registerGlobalComponentType<C>();
+        ComponentCollection::setDefaultStorage(typeId, storage);
+        return typeId;
+    }
+
+    /**
+    * @brief Registers a component type whose components may be loaded and
+    * stored on worker threads
+    *
+    * Only use this if the type's constructor, load() and storage() neither
+    * touch the Lua state nor any other state shared between components.
+    *
+    * @tparam C
+    *   The subclass of Component.
+    *
+    * @param storage
+    *   The storage entity managers use for collections of this type
+    *
+    * @return The type's unique id
+    *
+    * @note
+    *   You should probably use the REGISTER_COMPONENT_THREAD_SAFE macro
+    *   instead of calling this directly.
+    */
+    template<typename C>
+    static ComponentTypeId
+    registerThreadSafeComponentType(
+        ComponentCollection::Storage storage
+    ) {
+        ComponentTypeId typeId = registerGlobalComponentType<C>(storage);
+        ComponentFactory::setThreadSafe(C::TYPE_NAME());
+        return typeId;
+    }
+
     /**
     * @brief Looks up a component type name and returns its id
     *
@@ -94,6 +149,20 @@ public:
         const std::string& name
     ) const;
 
+    /**
+    * @brief Looks up a component type's loader
+    *
+    * @param name
+    *   The component type name
+    *
+    * @return
+    *   The loader or an empty function if the type name is not registered
+    */
+    ComponentLoader
+    getLoader(
+        const std::string& name
+    ) const;
+
     /**
     * @brief Looks up a component type id and returns its name
     *
@@ -108,6 +177,22 @@ public:
         ComponentTypeId typeId
     ) const;
 
+    /**
+    * @brief Whether components of a type may be loaded and stored on
+    * worker threads
+    *
+    * Only types registered with REGISTER_COMPONENT_THREAD_SAFE are. All
+    * others, including every Lua component type, are loaded and stored on
+    * the calling thread.
+    *
+    * @param name
+    *   The component type name
+    */
+    bool
+    isThreadSafeType(
+        const std::string& name
+    ) const;
+
     /**
     * @brief Loads a component from storage
     *
@@ -162,6 +247,11 @@ private:
         ComponentLoader loader
     );
 
+    static void
+    setThreadSafe(
+        const std::string& name
+    );
+
     struct Implementation;
     std::unique_ptr<Implementation> m_impl;
 
@@ -175,4 +265,38 @@ private:
 #define REGISTER_COMPONENT(cls) \
     const ComponentTypeId cls::TYPE_ID = thrive::ComponentFactory::registerGlobalComponentType<cls>();
 
+/**
+ * @brief Registers a component class with a specific collection storage
+ *
+ * Use this instead of REGISTER_COMPONENT for component types that are
+ * iterated over by performance critical systems.
+ *
+ * @param cls
+ *   The component class
+ * @param storage
+ *   A ComponentCollection::Storage value, without the enum prefix
+ */
+#define REGISTER_COMPONENT_WITH_STORAGE(cls, storage) \
+    const ComponentTypeId cls::TYPE_ID = thrive::ComponentFactory::registerGlobalComponentType<cls>( \
+        thrive::ComponentCollection::Storage::storage \
+    );
+
+/**
+ * @brief Registers a component class whose components may be loaded and
+ * stored on worker threads
+ *
+ * Use this instead of REGISTER_COMPONENT_WITH_STORAGE for component types
+ * that are saved in bulk and whose constructor, load() and storage() don't
+ * touch the Lua state or other shared state.
+ *
+ * @param cls
+ *   The component class
+ * @param storage
+ *   A ComponentCollection::Storage value, without the enum prefix
+ */
+#define REGISTER_COMPONENT_THREAD_SAFE(cls, storage) \
+    const ComponentTypeId cls::TYPE_ID = thrive::ComponentFactory::registerThreadSafeComponentType<cls>( \
+        thrive::ComponentCollection::Storage::storage \
+    );
+
 }
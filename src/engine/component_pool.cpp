@@ -0,0 +1,138 @@
+#include "engine/component_pool.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+// Blocks of the first slab, later slabs double up to MAX_SLAB_BLOCKS
+const size_t MIN_SLAB_BLOCKS = 32;
+
+const size_t MAX_SLAB_BLOCKS = 4096;
+
+const size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+struct FreeBlock {
+
+    FreeBlock* next;
+
+};
+
+} // namespace
+
+
+struct ComponentPool::Implementation {
+
+    void
+    addSlab() {
+        size_t blockCount = std::min(
+            std::max(m_capacity, MIN_SLAB_BLOCKS),
+            MAX_SLAB_BLOCKS
+        );
+        // operator new[] aligns for any fundamental type
+        std::unique_ptr<char[]> slab(new char[blockCount * m_blockSize]);
+        for (size_t i = blockCount; i > 0; --i) {
+            auto block = reinterpret_cast<FreeBlock*>(
+                slab.get() + (i - 1) * m_blockSize
+            );
+            block->next = m_freeList;
+            m_freeList = block;
+        }
+        m_slabs.push_back(std::move(slab));
+        m_capacity += blockCount;
+    }
+
+    size_t m_blockSize = 0;
+
+    size_t m_capacity = 0;
+
+    FreeBlock* m_freeList = nullptr;
+
+    // Size of the objects in the pool, before padding to m_blockSize
+    size_t m_objectSize = 0;
+
+    std::mutex m_mutex;
+
+    std::vector<std::unique_ptr<char[]>> m_slabs;
+
+    size_t m_usedBlocks = 0;
+
+};
+
+
+ComponentPool::ComponentPool()
+  : m_impl(new Implementation())
+{
+}
+
+
+ComponentPool::~ComponentPool() {}
+
+
+void*
+ComponentPool::allocate(
+    size_t size
+) {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    if (m_impl->m_objectSize == 0) {
+        m_impl->m_objectSize = size;
+        size_t blockSize = std::max(size, sizeof(FreeBlock));
+        m_impl->m_blockSize =
+            (blockSize + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+    }
+    if (size != m_impl->m_objectSize) {
+        return ::operator new(size);
+    }
+    if (not m_impl->m_freeList) {
+        m_impl->addSlab();
+    }
+    FreeBlock* block = m_impl->m_freeList;
+    m_impl->m_freeList = block->next;
+    m_impl->m_usedBlocks += 1;
+    return block;
+}
+
+
+size_t
+ComponentPool::blockSize() const {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_blockSize;
+}
+
+
+size_t
+ComponentPool::capacity() const {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_capacity;
+}
+
+
+void
+ComponentPool::deallocate(
+    void* pointer,
+    size_t size
+) {
+    if (not pointer) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    if (size != m_impl->m_objectSize) {
+        ::operator delete(pointer);
+        return;
+    }
+    auto block = static_cast<FreeBlock*>(pointer);
+    block->next = m_impl->m_freeList;
+    m_impl->m_freeList = block;
+    m_impl->m_usedBlocks -= 1;
+}
+
+
+size_t
+ComponentPool::usedBlocks() const {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_usedBlocks;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+namespace thrive {
+
+/**
+* @brief Recycles the memory of one component type
+*
+* Memory is taken from slabs of equally sized blocks. Freed blocks go into a
+* free list and are handed out again by the next allocation, so short lived
+* components don't hit the general purpose heap. Slabs are only released
+* when the pool is destroyed.
+*
+* The block size is fixed by the first allocation. Requests of any other
+* size, e.g. from a derived class without its own pool, are forwarded to the
+* global operator new.
+*
+* All functions are thread safe.
+*
+* Component classes get a pool through the COMPONENT macro, see
+* COMPONENT_POOL_ALLOCATION.
+*/
+class ComponentPool {
+
+public:
+
+    /**
+    * @brief Constructor
+    */
+    ComponentPool();
+
+    /**
+    * @brief Destructor
+    *
+    * Releases all slabs. Blocks still in use become invalid.
+    */
+    ~ComponentPool();
+
+    /**
+    * @brief Allocates memory for one component
+    *
+    * @param size
+    *   The number of bytes
+    *
+    * @return
+    *   Uninitialized memory, suitably aligned for any type
+    */
+    void*
+    allocate(
+        size_t size
+    );
+
+    /**
+    * @brief The size of the pool's blocks
+    *
+    * @return
+    *   0 if nothing has been allocated yet
+    */
+    size_t
+    blockSize() const;
+
+    /**
+    * @brief The total number of blocks in all slabs
+    */
+    size_t
+    capacity() const;
+
+    /**
+    * @brief Returns memory obtained from allocate()
+    *
+    * @param pointer
+    *   The memory to free. \c nullptr is ignored.
+    * @param size
+    *   The size passed to allocate()
+    */
+    void
+    deallocate(
+        void* pointer,
+        size_t size
+    );
+
+    /**
+    * @brief The number of blocks currently handed out
+    */
+    size_t
+    usedBlocks() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
+
+/**
+* @brief Makes a component class allocate its instances from a ComponentPool
+*
+* Part of the COMPONENT macro. The pool is created on first use and never
+* destroyed, so components outliving static destruction are still safe to
+* delete.
+*/
+#define COMPONENT_POOL_ALLOCATION \
+    public: \
+        \
+        static thrive::ComponentPool& COMPONENT_POOL() { \
+            static thrive::ComponentPool* pool = new thrive::ComponentPool(); \
+            return *pool; \
+        } \
+        \
+        static void* operator new(std::size_t size) { \
+            return COMPONENT_POOL().allocate(size); \
+        } \
+        \
+        static void operator delete(void* pointer, std::size_t size) { \
+            COMPONENT_POOL().deallocate(pointer, size); \
+        } \
+        \
+        /* Class scope operator new hides the global placement new */ \
+        static void* operator new(std::size_t, void* place) { \
+            return place; \
+        } \
+        \
+        static void operator delete(void*, void*) {} \
+        \
+    private: \
+
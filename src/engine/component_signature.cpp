@@ -0,0 +1,27 @@
+#include "engine/component_signature.h"
+
+#include "scripting/luajit.h"
+
+using namespace thrive;
+
+
+const size_t ComponentSignature::MAX_BITS;
+
+const size_t ComponentSignature::NO_BIT;
+
+
+void
+ComponentSignature::luaBindings(
+    sol::state &lua
+){
+    lua.new_usertype<ComponentSignature>("ComponentSignature",
+
+        sol::constructors<sol::types<>>(),
+
+        "containsAll", &ComponentSignature::containsAll,
+        "intersects", &ComponentSignature::intersects,
+        "none", &ComponentSignature::none,
+        "set", &ComponentSignature::set,
+        "test", &ComponentSignature::test
+    );
+}
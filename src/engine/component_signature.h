@@ -0,0 +1,183 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace sol {
+class state;
+}
+
+namespace thrive {
+
+/**
+* @brief A fixed size bit set of component collections
+*
+* Each EntityManager assigns its component collections consecutive bit
+* indices. An entity's signature has the bits of all collections that hold
+* one of its components set, so checking whether an entity has a set of
+* components is a single AND / compare.
+*/
+class ComponentSignature {
+
+public:
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - ComponentSignature::new
+    * - ComponentSignature::containsAll
+    * - ComponentSignature::intersects
+    * - ComponentSignature::none
+    * - ComponentSignature::set
+    * - ComponentSignature::test
+    */
+    static void
+    luaBindings(sol::state &lua);
+
+    /**
+    * @brief The number of collections a signature can describe
+    */
+    static const size_t MAX_BITS = 128;
+
+    /**
+    * @brief Bit index for collections that don't fit into a signature
+    */
+    static const size_t NO_BIT = MAX_BITS;
+
+    /**
+    * @brief Whether every bit set in \a other is also set in this signature
+    */
+    bool
+    containsAll(
+        const ComponentSignature& other
+    ) const {
+        for (size_t i = 0; i < WORD_COUNT; ++i) {
+            if ((m_words[i] & other.m_words[i]) != other.m_words[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+    * @brief Calls \a function with the index of every set bit, ascending
+    */
+    template<typename Function>
+    void
+    forEachSetBit(
+        Function function
+    ) const {
+        for (size_t i = 0; i < WORD_COUNT; ++i) {
+            uint64_t word = m_words[i];
+            while (word) {
+                size_t bit = static_cast<size_t>(__builtin_ctzll(word));
+                function(i * 64 + bit);
+                word &= word - 1;
+            }
+        }
+    }
+
+    /**
+    * @brief Whether at least one bit is set in both signatures
+    */
+    bool
+    intersects(
+        const ComponentSignature& other
+    ) const {
+        for (size_t i = 0; i < WORD_COUNT; ++i) {
+            if (m_words[i] & other.m_words[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+    * @brief Whether no bit is set
+    */
+    bool
+    none() const {
+        for (uint64_t word : m_words) {
+            if (word) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool
+    operator == (
+        const ComponentSignature& other
+    ) const {
+        return m_words == other.m_words;
+    }
+
+    bool
+    operator != (
+        const ComponentSignature& other
+    ) const {
+        return m_words != other.m_words;
+    }
+
+    /**
+    * @brief Clears all bits
+    */
+    void
+    reset() {
+        m_words.fill(0);
+    }
+
+    /**
+    * @brief Clears a bit
+    *
+    * Bits >= MAX_BITS are ignored.
+    */
+    void
+    reset(
+        size_t bit
+    ) {
+        if (bit < MAX_BITS) {
+            m_words[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+        }
+    }
+
+    /**
+    * @brief Sets a bit
+    *
+    * Bits >= MAX_BITS are ignored.
+    */
+    void
+    set(
+        size_t bit
+    ) {
+        if (bit < MAX_BITS) {
+            m_words[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    /**
+    * @brief Checks a bit
+    *
+    * @return \c false for bits >= MAX_BITS
+    */
+    bool
+    test(
+        size_t bit
+    ) const {
+        if (bit >= MAX_BITS) {
+            return false;
+        }
+        return (m_words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+private:
+
+    static const size_t WORD_COUNT = MAX_BITS / 64;
+
+    std::array<uint64_t, WORD_COUNT> m_words {{}};
+
+};
+
+}
@@ -0,0 +1,413 @@
+#include "engine/creation_library.h"
+
+#include "engine/serialization.h"
+#include "scripting/luajit.h"
+
+#include <algorithm>
+#include <boost/filesystem.hpp>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace thrive;
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+// Bump when the index layout changes, older indices are rebuilt
+const int32_t INDEX_VERSION = 1;
+
+/**
+* @brief Reads the metadata of a creation written by Engine::saveCreation
+*
+* Only the values shown in the library are decoded.
+*/
+CreationLibrary::Entry
+describe(
+    const fs::path& file
+) {
+    StorageView creation = StorageView::open(file.string());
+    CreationLibrary::Entry entry;
+    entry.file = file.string();
+    entry.name = file.stem().string();
+    entry.thriveVersion = creation.get<std::string>("thriveversion");
+    for (const StorageView& component : creation.list("components")) {
+        if (component.contains<std::string>("speciesName")) {
+            entry.speciesName = component.get<std::string>("speciesName");
+            entry.organelleCount = static_cast<uint32_t>(
+                component.list("organelles").size()
+            );
+            break;
+        }
+    }
+    return entry;
+}
+
+
+StorageContainer
+entryStorage(
+    const CreationLibrary::Entry& entry
+) {
+    StorageContainer storage;
+    storage.set("file", entry.file);
+    storage.set("modified", entry.modified);
+    storage.set("name", entry.name);
+    storage.set("organelleCount", entry.organelleCount);
+    storage.set("size", entry.size);
+    storage.set("speciesName", entry.speciesName);
+    storage.set("thumbnail", entry.thumbnail);
+    storage.set("thriveVersion", entry.thriveVersion);
+    return storage;
+}
+
+
+CreationLibrary::Entry
+loadEntry(
+    const StorageContainer& storage
+) {
+    CreationLibrary::Entry entry;
+    entry.file = storage.get<std::string>("file");
+    entry.modified = storage.get<int64_t>("modified");
+    entry.name = storage.get<std::string>("name");
+    entry.organelleCount = storage.get<uint32_t>("organelleCount");
+    entry.size = storage.get<uint64_t>("size");
+    entry.speciesName = storage.get<std::string>("speciesName");
+    entry.thumbnail = storage.get<std::string>("thumbnail");
+    entry.thriveVersion = storage.get<std::string>("thriveVersion");
+    return entry;
+}
+
+} // namespace
+
+
+struct CreationLibrary::Implementation {
+
+    Implementation(
+        const std::string& directory,
+        const std::string& extension
+    ) : m_directory(directory),
+        m_extension("." + extension),
+        m_indexFile(directory + ".index")
+    {
+    }
+
+    /**
+    * @brief Validates the index unless the directory is unchanged since the
+    * last validation
+    *
+    * Adding, removing or renaming files changes the directory's
+    * modification time. Files overwritten in place by the game are updated
+    * through CreationLibrary::update().
+    *
+    * Modification times only have a resolution of seconds. A directory
+    * modified in the second it was validated in may change again unnoticed,
+    * so it's validated again next time.
+    */
+    void
+    ensureValid() {
+        boost::system::error_code error;
+        std::time_t directoryTime = fs::last_write_time(m_directory, error);
+        if (error) {
+            directoryTime = 0;
+        }
+        if (
+            not m_validated or
+            directoryTime != m_directoryTime or
+            directoryTime >= m_validationTime
+        ) {
+            this->refresh();
+        }
+    }
+
+    /**
+    * @brief Finds a creation's entry
+    *
+    * @return
+    *   The first entry not sorted before \a name
+    */
+    std::vector<Entry>::iterator
+    find(
+        const std::string& name
+    ) {
+        return std::lower_bound(
+            m_entries.begin(),
+            m_entries.end(),
+            name,
+            [](const Entry& entry, const std::string& name) {
+                return entry.name < name;
+            }
+        );
+    }
+
+    /**
+    * @brief See CreationLibrary::refresh
+    */
+    void
+    refresh() {
+        boost::system::error_code error;
+        std::time_t directoryTime = fs::last_write_time(m_directory, error);
+        m_validated = true;
+        m_validationTime = std::time(nullptr);
+        m_directoryTime = error ? 0 : directoryTime;
+        std::unordered_map<std::string, Entry*> indexed;
+        for (Entry& entry : m_entries) {
+            indexed.emplace(entry.file, &entry);
+        }
+        std::vector<Entry> entries;
+        std::unordered_set<std::string> thumbnails;
+        bool changed = false;
+        if (fs::is_directory(m_directory, error)) {
+            for (fs::directory_iterator iter(m_directory), end; iter != end; ++iter) {
+                const fs::path& path = iter->path();
+                if (not fs::is_regular_file(iter->status())) {
+                    continue;
+                }
+                if (path.extension() == ".png") {
+                    thumbnails.insert(path.stem().string());
+                    continue;
+                }
+                if (path.extension() != m_extension) {
+                    continue;
+                }
+                std::time_t modified = fs::last_write_time(path, error);
+                if (error) {
+                    continue;
+                }
+                uint64_t size = fs::file_size(path, error);
+                if (error) {
+                    continue;
+                }
+                auto indexIter = indexed.find(path.string());
+                if (
+                    indexIter != indexed.end() and
+                    indexIter->second->modified == modified and
+                    indexIter->second->size == size
+                ) {
+                    entries.push_back(std::move(*indexIter->second));
+                    continue;
+                }
+                changed = true;
+                try {
+                    Entry entry = describe(path);
+                    entry.modified = modified;
+                    entry.size = size;
+                    entries.push_back(std::move(entry));
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Skipping creation " << path.string() << ": "
+                        << e.what() << std::endl;
+                }
+            }
+        }
+        changed = changed or entries.size() != m_entries.size();
+        for (Entry& entry : entries) {
+            std::string thumbnail;
+            if (thumbnails.count(entry.name) > 0) {
+                thumbnail = (m_directory / (entry.name + ".png")).string();
+            }
+            if (thumbnail != entry.thumbnail) {
+                entry.thumbnail = std::move(thumbnail);
+                changed = true;
+            }
+        }
+        std::sort(
+            entries.begin(),
+            entries.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+                return lhs.name < rhs.name;
+            }
+        );
+        m_entries = std::move(entries);
+        if (changed) {
+            this->writeIndex();
+        }
+    }
+
+    void
+    readIndex() {
+        m_entries.clear();
+        if (not fs::exists(m_indexFile)) {
+            return;
+        }
+        try {
+            StorageContainer index = StorageView::open(m_indexFile.string()).decode();
+            if (index.get<int32_t>("version") != INDEX_VERSION) {
+                return;
+            }
+            for (const StorageContainer& entry : index.get<StorageList>("entries")) {
+                m_entries.push_back(loadEntry(entry));
+            }
+        }
+        catch (const std::exception& e) {
+            // The index is only a cache, it's rebuilt from the creations
+            std::cerr << "Rebuilding creation index " << m_indexFile.string()
+                << ": " << e.what() << std::endl;
+            m_entries.clear();
+        }
+        std::sort(
+            m_entries.begin(),
+            m_entries.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+                return lhs.name < rhs.name;
+            }
+        );
+    }
+
+    void
+    writeIndex() {
+        StorageList entries;
+        entries.reserve(m_entries.size());
+        for (const Entry& entry : m_entries) {
+            entries.append(entryStorage(entry));
+        }
+        StorageContainer index;
+        index.set("version", INDEX_VERSION);
+        index.set("entries", std::move(entries));
+        // Replaced at once, so a crash never leaves a truncated index
+        fs::path temporaryFile = m_indexFile.string() + ".tmp";
+        try {
+            {
+                std::ofstream stream(
+                    temporaryFile.string(),
+                    std::ofstream::trunc | std::ofstream::binary
+                );
+                stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+                stream << index;
+            }
+            fs::rename(temporaryFile, m_indexFile);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Could not write creation index " << m_indexFile.string()
+                << ": " << e.what() << std::endl;
+        }
+    }
+
+    fs::path m_directory;
+
+    std::time_t m_directoryTime = 0;
+
+    // Sorted by name
+    std::vector<Entry> m_entries;
+
+    std::string m_extension;
+
+    fs::path m_indexFile;
+
+    bool m_validated = false;
+
+    std::time_t m_validationTime = 0;
+
+};
+
+
+void
+CreationLibrary::luaBindings(
+    sol::state& lua
+) {
+    lua.new_usertype<Entry>("CreationLibraryEntry",
+
+        "new", sol::no_constructor,
+
+        "file", sol::readonly(&Entry::file),
+        "modified", sol::readonly(&Entry::modified),
+        "name", sol::readonly(&Entry::name),
+        "organelleCount", sol::readonly(&Entry::organelleCount),
+        "size", sol::readonly(&Entry::size),
+        "speciesName", sol::readonly(&Entry::speciesName),
+        "thumbnail", sol::readonly(&Entry::thumbnail),
+        "thriveVersion", sol::readonly(&Entry::thriveVersion)
+    );
+
+    lua.new_usertype<CreationLibrary>("CreationLibrary",
+
+        "new", sol::no_constructor,
+
+        "query", [](CreationLibrary& self, size_t offset, size_t count,
+            sol::this_state s)
+        {
+            sol::state_view lua(s);
+            sol::table entries = lua.create_table();
+            int index = 1;
+            for (Entry& entry : self.query(offset, count)) {
+                entries[index++] = std::move(entry);
+            }
+            return entries;
+        },
+        "refresh", &CreationLibrary::refresh,
+        "size", &CreationLibrary::size
+    );
+}
+
+
+CreationLibrary::CreationLibrary(
+    const std::string& directory,
+    const std::string& extension
+) : m_impl(new Implementation(directory, extension))
+{
+    m_impl->readIndex();
+}
+
+
+CreationLibrary::~CreationLibrary() {}
+
+
+std::vector<CreationLibrary::Entry>
+CreationLibrary::query(
+    size_t offset,
+    size_t count
+) {
+    m_impl->ensureValid();
+    std::vector<Entry> page;
+    if (offset >= m_impl->m_entries.size()) {
+        return page;
+    }
+    auto begin = m_impl->m_entries.begin() + offset;
+    auto end = begin + std::min(count, m_impl->m_entries.size() - offset);
+    page.assign(begin, end);
+    return page;
+}
+
+
+void
+CreationLibrary::refresh() {
+    m_impl->refresh();
+}
+
+
+size_t
+CreationLibrary::size() {
+    m_impl->ensureValid();
+    return m_impl->m_entries.size();
+}
+
+
+void
+CreationLibrary::update(
+    const std::string& file
+) {
+    fs::path path(file);
+    Entry entry = describe(path);
+    entry.modified = fs::last_write_time(path);
+    entry.size = fs::file_size(path);
+    fs::path thumbnail = path.parent_path() / (entry.name + ".png");
+    if (fs::exists(thumbnail)) {
+        entry.thumbnail = thumbnail.string();
+    }
+    auto iter = m_impl->find(entry.name);
+    if (iter != m_impl->m_entries.end() and iter->name == entry.name) {
+        *iter = std::move(entry);
+    }
+    else {
+        m_impl->m_entries.insert(iter, std::move(entry));
+    }
+    m_impl->writeIndex();
+    // A new file changes the directory, but the index is up to date
+    if (m_impl->m_validated) {
+        boost::system::error_code error;
+        std::time_t directoryTime = fs::last_write_time(m_impl->m_directory, error);
+        m_impl->m_directoryTime = error ? 0 : directoryTime;
+    }
+}
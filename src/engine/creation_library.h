@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sol {
+class state;
+}
+
+namespace thrive {
+
+/**
+* @brief Index of the creations saved for one stage
+*
+* Listing creations used to scan the creation directory and parse every
+* file. The library keeps what the editor shows about each creation in an
+* index file next to the directory instead. The index is validated against
+* the files' modification times and sizes, so only new or changed files are
+* parsed. Engine::saveCreation updates it directly.
+*
+* Creations are sorted by name.
+*/
+class CreationLibrary {
+
+public:
+
+    /**
+    * @brief What the library knows about a creation
+    */
+    struct Entry {
+
+        /**
+        * @brief The creation's file
+        */
+        std::string file;
+
+        /**
+        * @brief Last modification of the file, in seconds since the epoch
+        */
+        int64_t modified = 0;
+
+        /**
+        * @brief The creation's name, its filename without extension
+        */
+        std::string name;
+
+        /**
+        * @brief Number of organelles of the creation's microbe
+        */
+        uint32_t organelleCount = 0;
+
+        /**
+        * @brief Size of the file in bytes
+        */
+        uint64_t size = 0;
+
+        /**
+        * @brief Species name of the creation's microbe
+        */
+        std::string speciesName;
+
+        /**
+        * @brief The thumbnail image, "<name>.png" next to the creation, or
+        * empty if there is none
+        */
+        std::string thumbnail;
+
+        /**
+        * @brief Version of Thrive the creation was saved with
+        */
+        std::string thriveVersion;
+
+    };
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - CreationLibrary::query: Returns a table of entries
+    * - CreationLibrary::refresh
+    * - CreationLibrary::size
+    * - Entry as CreationLibraryEntry, read only
+    */
+    static void
+    luaBindings(
+        sol::state& lua
+    );
+
+    /**
+    * @brief Opens a library
+    *
+    * Reads the index, but doesn't validate it before the first query.
+    *
+    * @param directory
+    *   The directory holding the creations. The index is written to
+    *   \a directory with ".index" appended.
+    * @param extension
+    *   The extension of creation files, without the dot
+    */
+    CreationLibrary(
+        const std::string& directory,
+        const std::string& extension
+    );
+
+    /**
+    * @brief Destructor
+    */
+    ~CreationLibrary();
+
+    /**
+    * @brief Returns a page of creations
+    *
+    * Validates the index first if the directory changed since the last
+    * validation.
+    *
+    * @param offset
+    *   Index of the first creation to return
+    * @param count
+    *   Maximum number of creations to return
+    */
+    std::vector<Entry>
+    query(
+        size_t offset,
+        size_t count
+    );
+
+    /**
+    * @brief Validates the index against the files on disk
+    *
+    * Parses new and changed creations, drops deleted ones and writes the
+    * index if anything changed.
+    */
+    void
+    refresh();
+
+    /**
+    * @brief Number of creations, validating the index if necessary
+    */
+    size_t
+    size();
+
+    /**
+    * @brief Updates the index for a creation that was just written
+    *
+    * @param file
+    *   The creation's file
+    */
+    void
+    update(
+        const std::string& file
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
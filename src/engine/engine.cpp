@@ -2,9 +2,12 @@
 
 #include "engine/component_collection.h"
 #include "engine/component_factory.h"
+#include "engine/creation_library.h"
 #include "engine/entity.h"
 #include "engine/entity_manager.h"
+#include "engine/entity_template.h"
 #include "engine/game_state.h"
+#include "engine/savegame_writer.h"
 #include "engine/serialization.h"
 #include "engine/system.h"
 #include "engine/rng.h"
@@ -84,6 +87,27 @@ using namespace thrive;
 static const char* RESOURCES_CFG = "resources.cfg";
 static const char* PLUGINS_CFG   = "plugins.cfg";
 
+// Appended to a savegame's filename for its delta
+static const char* DELTA_SUFFIX  = ".delta";
+
+// Incremental saves write this many deltas before the next full snapshot
+static const unsigned int DELTAS_PER_SNAPSHOT = 10;
+
+// Decodes a whole file. Loading restores every collection anyway, so a
+// StorageView would only add the cost of indexing.
+static StorageContainer
+readStorage(
+    const std::string& filename
+) {
+    std::ifstream stream(filename, std::ifstream::binary);
+    if (not stream.is_open()) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+    StorageContainer storage;
+    stream >> storage;
+    return storage;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Engine
 ////////////////////////////////////////////////////////////////////////////////
@@ -109,32 +133,75 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
     void
     loadSavegame() {
-        std::ifstream stream(
-            m_serialization.loadFile,
-            std::ifstream::binary
-        );
+        // The file may still be being written
+        m_savegameWriter.wait();
+        std::string loadFile = std::move(m_serialization.loadFile);
         m_serialization.loadFile = "";
-        stream.clear();
-        stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
         StorageContainer savegame;
         try {
-            stream >> savegame;
+            savegame = readStorage(loadFile);
         }
-        catch(const std::ofstream::failure& e) {
+        catch(const std::exception& e) {
             std::cerr << "Error loading file: " << e.what() << std::endl;
             throw;
         }
+        StorageContainer delta = this->loadDelta(loadFile, savegame);
+        bool hasDelta = delta.contains("baseSnapshotId");
+        // The loaded state is no longer what any snapshot describes
+        m_deltaChain = DeltaChain();
 
         // Load game states
         sol::protected_function luaMethod = m_luaState["g_luaEngine"]
             ["loadSavegameGameStates"];
 
-        if(!luaMethod(m_luaState["g_luaEngine"], &savegame).valid()){
+        // A null pointer arrives as nil
+        StorageContainer* deltaPointer = hasDelta ? &delta : nullptr;
+        if(!luaMethod(m_luaState["g_luaEngine"], &savegame, deltaPointer).valid()){
 
             throw std::runtime_error("LuaEngine failed to load saved game states");
         }
 
-        m_playerData.load(savegame.get<StorageContainer>("playerData"));
+        m_playerData.load(
+            (hasDelta ? delta : savegame).get<StorageContainer>("playerData")
+        );
+    }
+
+    /**
+    * @brief Loads the delta written on top of a snapshot, if any
+    *
+    * @return
+    *   The delta or an empty container if there is no matching one
+    */
+    StorageContainer
+    loadDelta(
+        const std::string& loadFile,
+        const StorageContainer& savegame
+    ) {
+        std::string deltaFile = loadFile + DELTA_SUFFIX;
+        if (
+            not savegame.contains<uint64_t>("snapshotId") or
+            not boost::filesystem::exists(deltaFile)
+        ) {
+            return StorageContainer();
+        }
+        StorageContainer delta;
+        try {
+            delta = readStorage(deltaFile);
+        }
+        catch(const std::exception& e) {
+            // The snapshot alone is still a consistent savegame
+            std::cerr << "Ignoring unreadable " << deltaFile << ": " << e.what()
+                << std::endl;
+            return StorageContainer();
+        }
+        // Deltas of an older snapshot of the same file are stale
+        if (
+            delta.get<uint64_t>("baseSnapshotId") !=
+            savegame.get<uint64_t>("snapshotId")
+        ) {
+            return StorageContainer();
+        }
+        return delta;
     }
 
     void
@@ -230,12 +297,27 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
     void
     saveSavegame() {
         StorageContainer savegame;
+        std::string saveFile = std::move(m_serialization.saveFile);
+        m_serialization.saveFile = "";
+        // "full", "snapshot" or "delta", see EntityManager
+        std::string mode = "full";
+        if (m_serialization.saveIncrementally) {
+            bool continueChain = (
+                saveFile == m_deltaChain.baseFile and
+                m_deltaChain.deltaCount < DELTAS_PER_SNAPSHOT
+            );
+            mode = continueChain ? "delta" : "snapshot";
+        }
+        else if (saveFile == m_deltaChain.baseFile) {
+            // Overwrites the snapshot
+            m_deltaChain = DeltaChain();
+        }
 
         // Load game states
         sol::protected_function luaMethod = m_luaState["g_luaEngine"]
             ["saveCurrentStates"];
 
-        if(!luaMethod(m_luaState["g_luaEngine"], &savegame).valid()){
+        if(!luaMethod(m_luaState["g_luaEngine"], &savegame, mode).valid()){
 
             throw std::runtime_error("LuaEngine failed to save game states");
         }
@@ -243,26 +325,42 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
         savegame.set("playerData", m_playerData.storage());
 
         savegame.set("thriveversion", m_thriveVersion);
-        std::ofstream stream(
-            m_serialization.saveFile,
-            std::ofstream::trunc | std::ofstream::binary
+        if (mode == "snapshot") {
+            std::random_device random;
+            m_deltaChain.baseFile = saveFile;
+            m_deltaChain.snapshotId = (uint64_t(random()) << 32) | random();
+            m_deltaChain.deltaCount = 0;
+            savegame.set("snapshotId", m_deltaChain.snapshotId);
+        }
+        else if (mode == "delta") {
+            m_deltaChain.deltaCount += 1;
+            savegame.set("baseSnapshotId", m_deltaChain.snapshotId);
+            saveFile += DELTA_SUFFIX;
+        }
+        // Encoding and writing happens in the background
+        m_savegameWriter.write(
+            std::move(saveFile),
+            std::move(savegame)
         );
-        m_serialization.saveFile = "";
-        stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-        if (stream) {
-            try {
-                stream << savegame;
-                stream.flush();
-                stream.close();
+    }
+
+    void
+    reportWrittenSavegames() {
+        for (const auto& result : m_savegameWriter.takeResults()) {
+            // Deltas against a snapshot that never made it to disk are
+            // useless
+            if (not result.succeeded and result.filename == m_deltaChain.baseFile) {
+                m_deltaChain = DeltaChain();
             }
-            catch (const std::ofstream::failure& e) {
-                std::cerr << "Error saving file: " << e.what() << std::endl;
-                throw;
+            sol::protected_function luaMethod = m_luaState["g_luaEngine"]
+                ["savegameWritten"];
+
+            if(!luaMethod(m_luaState["g_luaEngine"], result.filename,
+                result.succeeded, result.error).valid()){
+
+                throw std::runtime_error("LuaEngine failed to handle written savegame");
             }
         }
-        else {
-            std::perror("Could not open file for saving");
-        }
     }
 
     void
@@ -510,8 +608,40 @@ struct Engine::Implementation : public Ogre::WindowEventListener {
 
         std::string saveFile;
 
+        bool saveIncrementally = false;
+
     } m_serialization;
 
+    /**
+    * @brief The snapshot incremental saves write their deltas against
+    */
+    struct DeltaChain {
+
+        // Empty if the next incremental save has to write a snapshot
+        std::string baseFile;
+
+        uint64_t snapshotId = 0;
+
+        unsigned int deltaCount = 0;
+
+    } m_deltaChain;
+
+    // Created on first use, keyed by stage
+    std::unordered_map<std::string, std::unique_ptr<CreationLibrary>> m_creationLibraries;
+
+    struct CachedTemplate {
+
+        std::time_t modified;
+
+        EntityTemplate entityTemplate;
+
+    };
+
+    // Decoded creations, keyed by file
+    std::unordered_map<std::string, CachedTemplate> m_entityTemplates;
+
+    SavegameWriter m_savegameWriter;
+
     std::unique_ptr<SoundManager> m_soundManager;
     std::unique_ptr<CEGUI::InputAggregator> m_aggregator;
 
@@ -528,12 +658,15 @@ void Engine::luaBindings(
         "playerData", &Engine::playerData,
         "load", &Engine::load,
         "save", &Engine::save,
+        "saveIncremental", &Engine::saveIncremental,
         "fileExists", &Engine::fileExists,
         "saveCreation", static_cast<void(Engine::*)(EntityId, std::string,
             std::string)const>(&Engine::saveCreation),
         "loadCreation", static_cast<EntityId(Engine::*)(std::string)>(&Engine::loadCreation),
         "screenShot", &Engine::screenShot,
         "getCreationFileList", &Engine::getCreationFileList,
+        "creationLibrary", &Engine::creationLibrary,
+        "entityTemplate", &Engine::entityTemplate,
         "quit", &Engine::quit,
         "thriveVersion", sol::property(&Engine::thriveVersion),
         "update", &Engine::update,
@@ -548,6 +681,14 @@ void Engine::luaBindings(
                 return self.m_impl->m_paused;
             }),
 
+        "saveInProgress", sol::property([](Engine &self){
+                return self.m_impl->m_savegameWriter.busy();
+            }),
+
+        "saveProgress", sol::property([](Engine &self){
+                return self.m_impl->m_savegameWriter.progress();
+            }),
+
         "luaMemory", sol::property([](Engine &self){
                 return self.m_impl->m_luaState.memory_used();
             })
@@ -774,6 +915,16 @@ Engine::save(
     std::string filename
 ) {
     m_impl->m_serialization.saveFile = filename;
+    m_impl->m_serialization.saveIncrementally = false;
+}
+
+
+void
+Engine::saveIncremental(
+    std::string filename
+) {
+    m_impl->m_serialization.saveFile = filename;
+    m_impl->m_serialization.saveIncrementally = true;
 }
 
 void
@@ -810,8 +961,9 @@ Engine::saveCreation(
     }
     else {
         creation.set("thriveversion", this->thriveVersion());
+        std::string file = (pth / fs::path(name + "." + type)).string<std::string>();
         std::ofstream stream(
-            (pth / fs::path(name + "." + type)).string<std::string>(),
+            file,
             std::ofstream::trunc | std::ofstream::binary
         );
         stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
@@ -825,6 +977,15 @@ Engine::saveCreation(
                 std::cerr << "Error saving file: " << e.what() << std::endl;
                 throw;
             }
+            // Overwrites within a second keep the modification time
+            m_impl->m_entityTemplates.erase(file);
+            try {
+                this->creationLibrary(type).update(file);
+            }
+            catch (const std::exception& e) {
+                // The next query picks the creation up from the directory
+                std::cerr << "Could not index creation: " << e.what() << std::endl;
+            }
         }
         else {
             std::perror("Could not open file for saving");
@@ -851,22 +1012,35 @@ Engine::loadCreation(
     std::string file,
     EntityManager& entityManager
 ) {
-    std::ifstream stream(
-        file,
-        std::ifstream::binary
-    );
-    stream.clear();
-    stream.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-    StorageContainer creation;
+    EntityTemplate creation;
     try {
-        stream >> creation;
+        creation = this->entityTemplate(file);
     }
-    catch(const std::ofstream::failure& e) {
+    catch(const std::exception& e) {
         std::cerr << "Error loading file: " << e.what() << std::endl;
         throw;
     }
-    EntityId entityId = entityManager.loadEntity(creation, m_impl->m_componentFactory);
-    return entityId;
+    return entityManager.instantiate(creation);
+}
+
+EntityTemplate
+Engine::entityTemplate(
+    const std::string& file
+) {
+    std::time_t modified = boost::filesystem::last_write_time(file);
+    auto iter = m_impl->m_entityTemplates.find(file);
+    if (iter != m_impl->m_entityTemplates.end() and iter->second.modified == modified) {
+        return iter->second.entityTemplate;
+    }
+    EntityTemplate entityTemplate(
+        readStorage(file),
+        m_impl->m_componentFactory
+    );
+    m_impl->m_entityTemplates[file] = Implementation::CachedTemplate{
+        modified,
+        entityTemplate
+    };
+    return entityTemplate;
 }
 
 void
@@ -876,21 +1050,25 @@ Engine::screenShot(std::string path){
 
 
 
+CreationLibrary&
+Engine::creationLibrary(
+    const std::string& stage
+) const {
+    auto& library = m_impl->m_creationLibraries[stage];
+    if (not library) {
+        library.reset(new CreationLibrary("creations/" + stage, stage));
+    }
+    return *library;
+}
+
 std::string
 Engine::getCreationFileList(
     std::string stage
 ) const {
-    namespace fs = boost::filesystem;
-    fs::path directory("./creations/" + stage);
-    fs::directory_iterator end_iter;
+    CreationLibrary& library = this->creationLibrary(stage);
     std::stringstream stringbuilder;
-    if ( fs::exists(directory) && fs::is_directory(directory)) {
-        for( fs::directory_iterator dir_iter(directory) ; dir_iter != end_iter ; ++dir_iter) {
-            if (fs::is_regular_file(dir_iter->status()) )
-            {
-                stringbuilder << dir_iter->path().string() << " ";
-            }
-        }
+    for (const CreationLibrary::Entry& entry : library.query(0, library.size())) {
+        stringbuilder << entry.file << " ";
     }
     return stringbuilder.str();
 }
@@ -939,6 +1117,7 @@ Engine::update(
     if (not m_impl->m_serialization.saveFile.empty()) {
         m_impl->saveSavegame();
     }
+    m_impl->reportWrittenSavegames();
     Ogre::WindowEventUtilities::messagePump();
     if (m_impl->m_quitRequested) {
         Game::instance().quit();
@@ -33,6 +33,8 @@ namespace OIS {
 namespace thrive {
 
 class ComponentFactory;
+class CreationLibrary;
+class EntityTemplate;
 class EntityManager;
 class Entity;
 class PlayerData;
@@ -67,8 +69,11 @@ public:
     * - Engine::load()
     * - Engine::fileExists()
     * - Engine::save()
+    * - Engine::saveIncremental()
     * - Engine::saveCreation()
     * - Engine::loadCreation()
+    * - Engine::creationLibrary()
+    * - Engine::entityTemplate()
     * - Engine::screenShot()
     * - Engine::quit()
     * - Engine::pauseGame()
@@ -76,6 +81,8 @@ public:
     * - Engine::componentFactory() (as property)
     * - Engine::keyboard() (as property)
     * - Engine::mouse() (as property)
+    * - saveInProgress (as property)
+    * - saveProgress (as property)
     * - Engine::thriveVersion()
     * - Engine::registerConsoleObject()
     *
@@ -204,6 +211,10 @@ public:
     /**
     * @brief Creates a savegame
     *
+    * The game states are collected on the next update. The file is written
+    * in the background, LuaEngine:savegameWritten is called once it is
+    * done.
+    *
     * @param filename
     *   The file to save
     */
@@ -212,6 +223,22 @@ public:
         std::string filename
     );
 
+    /**
+    * @brief Creates a savegame, writing only what changed if possible
+    *
+    * The first incremental save to a file, and every few after that, writes
+    * a full snapshot to \a filename. The others only write the entities
+    * that changed since that snapshot to \a filename with ".delta"
+    * appended. Loading \a filename applies a matching delta automatically.
+    *
+    * @param filename
+    *   The file to save
+    */
+    void
+    saveIncremental(
+        std::string filename
+    );
+
     /**
     * @brief Saves a creation to file
     *
@@ -270,6 +297,20 @@ public:
         std::string file
     );
 
+    /**
+    * @brief Returns the template for a saved creation
+    *
+    * Templates are cached by file and decoded again only when the file
+    * changes, so spawning the same creation repeatedly doesn't reread it.
+    *
+    * @param file
+    *   The creation's file
+    */
+    EntityTemplate
+    entityTemplate(
+        const std::string& file
+    );
+
     /**
     * @brief Takes a screenshot
     *
@@ -281,9 +322,22 @@ public:
        std::string path
     );
 
+    /**
+    * @brief The library of creations saved for a stage
+    *
+    * @param stage
+    *   The game stage, e.g. "microbe"
+    */
+    CreationLibrary&
+    creationLibrary(
+        const std::string& stage
+    ) const;
+
     /**
     * @brief Obtains a list of filenames for saved creations that match the provided type
     *
+    * Served from the stage's CreationLibrary.
+    *
     * @param stage
     *   The game stage to filter creations on
     *
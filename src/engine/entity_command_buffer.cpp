@@ -0,0 +1,183 @@
+#include "engine/entity_command_buffer.h"
+
+#include "engine/component.h"
+#include "engine/entity_manager.h"
+
+#include <assert.h>
+#include <utility>
+
+using namespace thrive;
+
+namespace {
+
+enum class CommandType {
+    AddComponent,
+    CreateEntity,
+    RemoveComponent,
+    RemoveEntity
+};
+
+const size_t NO_PENDING_ENTITY = static_cast<size_t>(-1);
+
+struct Command {
+
+    std::unique_ptr<Component> component;
+
+    EntityId entityId = NULL_ENTITY;
+
+    size_t pendingEntity = NO_PENDING_ENTITY;
+
+    CommandType type;
+
+    ComponentTypeId typeId = NULL_COMPONENT_TYPE;
+
+};
+
+} // namespace
+
+
+struct EntityCommandBuffer::Implementation {
+
+    std::vector<Command> m_commands;
+
+    size_t m_pendingEntityCount = 0;
+
+};
+
+
+EntityCommandBuffer::EntityCommandBuffer()
+  : m_impl(new Implementation())
+{
+}
+
+
+EntityCommandBuffer::EntityCommandBuffer(
+    EntityCommandBuffer&& other
+) : m_impl(std::move(other.m_impl))
+{
+    other.m_impl.reset(new Implementation());
+}
+
+
+EntityCommandBuffer::~EntityCommandBuffer() {}
+
+
+EntityCommandBuffer&
+EntityCommandBuffer::operator= (
+    EntityCommandBuffer&& other
+) {
+    std::swap(m_impl, other.m_impl);
+    other.clear();
+    return *this;
+}
+
+
+void
+EntityCommandBuffer::addComponent(
+    EntityId entityId,
+    std::unique_ptr<Component> component
+) {
+    assert(entityId != NULL_ENTITY);
+    Command command;
+    command.type = CommandType::AddComponent;
+    command.entityId = entityId;
+    command.component = std::move(component);
+    m_impl->m_commands.push_back(std::move(command));
+}
+
+
+void
+EntityCommandBuffer::addComponent(
+    PendingEntity entity,
+    std::unique_ptr<Component> component
+) {
+    assert(entity.index < m_impl->m_pendingEntityCount && "Unknown pending entity");
+    Command command;
+    command.type = CommandType::AddComponent;
+    command.pendingEntity = entity.index;
+    command.component = std::move(component);
+    m_impl->m_commands.push_back(std::move(command));
+}
+
+
+void
+EntityCommandBuffer::clear() {
+    m_impl->m_commands.clear();
+    m_impl->m_pendingEntityCount = 0;
+}
+
+
+EntityCommandBuffer::PendingEntity
+EntityCommandBuffer::createEntity() {
+    Command command;
+    command.type = CommandType::CreateEntity;
+    command.pendingEntity = m_impl->m_pendingEntityCount;
+    m_impl->m_commands.push_back(std::move(command));
+    return PendingEntity{m_impl->m_pendingEntityCount++};
+}
+
+
+bool
+EntityCommandBuffer::empty() const {
+    return m_impl->m_commands.empty();
+}
+
+
+std::vector<EntityId>
+EntityCommandBuffer::playback(
+    EntityManager& entityManager
+) {
+    std::vector<EntityId> createdEntities;
+    createdEntities.reserve(m_impl->m_pendingEntityCount);
+    for (Command& command : m_impl->m_commands) {
+        EntityId entityId = command.entityId;
+        if (command.pendingEntity != NO_PENDING_ENTITY and
+            command.type != CommandType::CreateEntity
+        ) {
+            entityId = createdEntities[command.pendingEntity];
+        }
+        switch (command.type) {
+            case CommandType::AddComponent:
+                entityManager.addComponent(
+                    entityId,
+                    std::move(command.component)
+                );
+                break;
+            case CommandType::CreateEntity:
+                createdEntities.push_back(entityManager.generateNewId());
+                break;
+            case CommandType::RemoveComponent:
+                entityManager.removeComponent(entityId, command.typeId);
+                break;
+            case CommandType::RemoveEntity:
+                entityManager.removeEntity(entityId);
+                break;
+        }
+    }
+    this->clear();
+    return createdEntities;
+}
+
+
+void
+EntityCommandBuffer::removeComponent(
+    EntityId entityId,
+    ComponentTypeId typeId
+) {
+    Command command;
+    command.type = CommandType::RemoveComponent;
+    command.entityId = entityId;
+    command.typeId = typeId;
+    m_impl->m_commands.push_back(std::move(command));
+}
+
+
+void
+EntityCommandBuffer::removeEntity(
+    EntityId entityId
+) {
+    Command command;
+    command.type = CommandType::RemoveEntity;
+    command.entityId = entityId;
+    m_impl->m_commands.push_back(std::move(command));
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "engine/typedefs.h"
+
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+class Component;
+class EntityManager;
+
+/**
+* @brief Records structural changes to apply to an EntityManager later
+*
+* Adding components fires the collection callbacks immediately and touches
+* shared state, so it must happen on one thread. Code running on worker
+* threads records its changes into a command buffer instead. The buffer is
+* played back on the main thread at a sync point.
+*
+* A buffer itself is not thread safe, use one per task. Playing back several
+* buffers in a fixed order gives a deterministic result regardless of how
+* the tasks were scheduled.
+*/
+class EntityCommandBuffer {
+
+public:
+
+    /**
+    * @brief Handle for an entity created by this buffer
+    *
+    * The entity gets its id during playback().
+    */
+    struct PendingEntity {
+
+        size_t index;
+
+    };
+
+    /**
+    * @brief Constructor
+    */
+    EntityCommandBuffer();
+
+    /**
+    * @brief Move constructor
+    */
+    EntityCommandBuffer(
+        EntityCommandBuffer&& other
+    );
+
+    /**
+    * @brief Destructor
+    */
+    ~EntityCommandBuffer();
+
+    /**
+    * @brief Move assignment
+    */
+    EntityCommandBuffer&
+    operator= (
+        EntityCommandBuffer&& other
+    );
+
+    /**
+    * @brief Records a component addition to an existing entity
+    *
+    * @param entityId
+    *   The entity to add to
+    * @param component
+    *   The component to add
+    */
+    void
+    addComponent(
+        EntityId entityId,
+        std::unique_ptr<Component> component
+    );
+
+    /**
+    * @brief Records a component addition to an entity created by this buffer
+    *
+    * @param entity
+    *   A handle returned by createEntity()
+    * @param component
+    *   The component to add
+    */
+    void
+    addComponent(
+        PendingEntity entity,
+        std::unique_ptr<Component> component
+    );
+
+    /**
+    * @brief Discards all recorded commands
+    */
+    void
+    clear();
+
+    /**
+    * @brief Records the creation of a new entity
+    *
+    * @return
+    *   A handle to add components to the new entity
+    */
+    PendingEntity
+    createEntity();
+
+    /**
+    * @brief Whether no commands have been recorded
+    */
+    bool
+    empty() const;
+
+    /**
+    * @brief Applies all recorded commands in the order they were recorded
+    *
+    * Clears the buffer afterwards.
+    *
+    * @param entityManager
+    *   The entity manager to modify
+    *
+    * @return
+    *   The ids of the created entities, in the order of createEntity() calls
+    */
+    std::vector<EntityId>
+    playback(
+        EntityManager& entityManager
+    );
+
+    /**
+    * @brief Records a component removal
+    *
+    * @param entityId
+    *   The component's owner
+    * @param typeId
+    *   The component's type id
+    */
+    void
+    removeComponent(
+        EntityId entityId,
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Records an entity removal
+    *
+    * @param entityId
+    *   The entity to remove
+    */
+    void
+    removeEntity(
+        EntityId entityId
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -24,21 +24,23 @@ struct ComponentGroupBuilder {
         typename ExtractComponentType<ComponentTypes>::PointerType...
     >;
 
+    using Collections = std::array<ComponentCollection*, sizeof...(ComponentTypes)>;
+
     static bool 
     build(
-        EntityManager* entityManager,
+        const Collections& collections,
         EntityId entityId,
         ComponentGroup& group
     ) {
         using ComponentType = typename std::tuple_element<index, std::tuple<ComponentTypes...>>::type;
         using RawType = typename ExtractComponentType<ComponentType>::Type;
         bool isRequired = IsRequired<ComponentType>::value;
-        RawType* component = entityManager->getComponent<RawType>(entityId);
+        RawType* component = static_cast<RawType*>(collections[index]->get(entityId));
         if (isRequired and not component) {
             return false;
         }
         std::get<index>(group) = component;
-        return ComponentGroupBuilder<index-1, ComponentTypes...>::build(entityManager, entityId, group);
+        return ComponentGroupBuilder<index-1, ComponentTypes...>::build(collections, entityId, group);
     }
         
 };
@@ -47,16 +49,18 @@ struct ComponentGroupBuilder {
 template<typename... ComponentTypes>
 struct ComponentGroupBuilder<0, ComponentTypes...> {
 
+    using Collections = std::array<ComponentCollection*, sizeof...(ComponentTypes)>;
+
     static bool 
     build(
-        EntityManager* entityManager,
+        const Collections& collections,
         EntityId entityId,
         std::tuple<typename ExtractComponentType<ComponentTypes>::PointerType...>& group
     ) {
         using ComponentType = typename std::tuple_element<0, std::tuple<ComponentTypes...>>::type;
         using RawType = typename ExtractComponentType<ComponentType>::Type;
         bool isRequired = IsRequired<ComponentType>::value;
-        RawType* component = entityManager->getComponent<RawType>(entityId);
+        RawType* component = static_cast<RawType*>(collections[0]->get(entityId));
         if (isRequired and not component) {
             return false;
         }
@@ -103,8 +107,31 @@ struct EntityFilter<ComponentTypes...>::Implementation {
 
     void
     initEntities() {
-        for (EntityId id : m_entityManager->entities()) {
-            this->initEntity(id);
+        // Only entities in the smallest required collection can match. If
+        // all components are optional, every watched collection is visited.
+        const bool isRequired[] = {
+            detail::IsRequired<ComponentTypes>::value...
+        };
+        ComponentCollection* smallest = nullptr;
+        for (size_t i = 0; i < m_collections.size(); ++i) {
+            if (isRequired[i] and (
+                not smallest or m_collections[i]->size() < smallest->size()
+            )) {
+                smallest = m_collections[i];
+            }
+        }
+        if (smallest) {
+            m_entities.reserve(smallest->size());
+            for (EntityId id : smallest->entities()) {
+                this->initEntity(id);
+            }
+        }
+        else {
+            for (ComponentCollection* collection : m_collections) {
+                for (EntityId id : collection->entities()) {
+                    this->initEntity(id);
+                }
+            }
         }
     }
 
@@ -112,15 +139,18 @@ struct EntityFilter<ComponentTypes...>::Implementation {
     initEntity(
         EntityId id
     ) {
+        // Cheap rejection before looking up each component
+        if (not m_entityManager->hasComponents(id, m_requiredSignature)) {
+            return;
+        }
         ComponentGroup group;
         bool isComplete = detail::ComponentGroupBuilder<sizeof...(ComponentTypes) - 1, ComponentTypes...>::build(
-            m_entityManager,
+            m_collections,
             id,
             group
         );
         if (isComplete) {
             m_entities[id] = group;
-            m_entities.insert(std::make_pair(id, group));
             if (m_recordChanges) {
                 m_addedEntities[id] = group;
             }
@@ -177,6 +207,13 @@ struct EntityFilter<ComponentTypes...>::Implementation {
         auto& collection = m_entityManager->getComponentCollection(
             RawType::TYPE_ID
         );
+        m_collections[tupleIndex] = &collection;
+        if (isRequired) {
+            // Types without a bit are still checked by initEntity()
+            m_requiredSignature.set(
+                m_entityManager->componentBit(RawType::TYPE_ID)
+            );
+        }
         // Callbacks
         auto onAdded = [this] (EntityId id, Component&) {
             this->onComponentAdded(id);
@@ -208,16 +245,25 @@ struct EntityFilter<ComponentTypes...>::Implementation {
             pair.first.get().unregisterChangeCallbacks(pair.second);
         }
         m_registeredCallbacks.clear();
+        m_collections.fill(nullptr);
+        m_requiredSignature.reset();
     }
 
     EntityMap m_addedEntities;
 
+    typename detail::ComponentGroupBuilder<
+        0,
+        ComponentTypes...
+    >::Collections m_collections {};
+
     EntityMap m_entities;
 
     EntityManager* m_entityManager = nullptr;
 
     bool m_recordChanges;
 
+    ComponentSignature m_requiredSignature;
+
     std::forward_list<std::pair<
         std::reference_wrapper<ComponentCollection>, 
         unsigned int
@@ -281,6 +327,63 @@ EntityFilter<ComponentTypes...>::entities() const {
 }
 
 
+template<typename... ComponentTypes>
+template<typename Function>
+void
+EntityFilter<ComponentTypes...>::parallelForEach(
+    ThreadPool& threadPool,
+    Function function,
+    size_t chunkSize
+) const {
+    const EntityMap& entities = m_impl->m_entities;
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    std::vector<ThreadPool::Task> tasks;
+    tasks.reserve((entities.size() + chunkSize - 1) / chunkSize);
+    for (size_t first = 0; first < entities.size(); first += chunkSize) {
+        size_t last = std::min(first + chunkSize, entities.size());
+        tasks.emplace_back([&entities, &function, first, last] {
+            for (size_t i = first; i < last; ++i) {
+                function(entities.data()[i]);
+            }
+        });
+    }
+    threadPool.run(tasks);
+}
+
+
+template<typename... ComponentTypes>
+template<typename Function>
+void
+EntityFilter<ComponentTypes...>::parallelForEachDeferred(
+    ThreadPool& threadPool,
+    Function function,
+    size_t chunkSize
+) {
+    assert(m_impl->m_entityManager && "Filter has no entity manager to play back into");
+    const EntityMap& entities = m_impl->m_entities;
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    size_t chunkCount = (entities.size() + chunkSize - 1) / chunkSize;
+    std::vector<EntityCommandBuffer> commandBuffers(chunkCount);
+    std::vector<ThreadPool::Task> tasks;
+    tasks.reserve(chunkCount);
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk) {
+        size_t first = chunk * chunkSize;
+        size_t last = std::min(first + chunkSize, entities.size());
+        EntityCommandBuffer& commandBuffer = commandBuffers[chunk];
+        tasks.emplace_back([&entities, &function, &commandBuffer, first, last] {
+            for (size_t i = first; i < last; ++i) {
+                function(entities.data()[i], commandBuffer);
+            }
+        });
+    }
+    threadPool.run(tasks);
+    // Playback modifies the filter, so it has to wait for all chunks
+    for (EntityCommandBuffer& commandBuffer : commandBuffers) {
+        commandBuffer.playback(*m_impl->m_entityManager);
+    }
+}
+
+
 template<typename... ComponentTypes>
 std::unordered_set<EntityId>&
 EntityFilter<ComponentTypes...>::removedEntities() {
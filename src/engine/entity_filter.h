@@ -2,12 +2,17 @@
 
 #include "engine/entity_manager.h"
 #include "engine/component_collection.h"
+#include "engine/entity_command_buffer.h"
+#include "engine/packed_entity_map.h"
+#include "engine/thread_pool.h"
 
+#include <algorithm>
+#include <array>
 #include <assert.h>
 #include <forward_list>
 #include <functional>
 #include <tuple>
-#include <unordered_map>
+#include <unordered_set>
 
 #include <iostream>
 
@@ -50,6 +55,12 @@ struct ExtractComponentType<Optional<ComponentType>> {
 * An entity filter helps a system in finding the entities that have exactly
 * the right components to be relevant for the system.
 *
+* The matching entities and their component groups are kept in a packed
+* array sorted by entity id, so iterating over a filter is a linear scan
+* and begin() / end() form one contiguous range. The filter caches the
+* component collections it watches, so building a group on a component
+* change does not go through the entity manager.
+*
 * @tparam ComponentTypes
 *   The component classes to watch for. You can wrap a class with the
 *   Optional template if you want to know if it's there, but it's not
@@ -110,8 +121,16 @@ public:
 
     /**
     * @brief Typedef for the filter's list of relevant entities
+    *
+    * Iterators and pointers into the map are invalidated when entities are
+    * added to or removed from the filter.
+    */
+    using EntityMap = PackedEntityMap<ComponentGroup>;
+
+    /**
+    * @brief Default number of entities per task in parallelForEach()
     */
-    using EntityMap = std::unordered_map<EntityId, ComponentGroup>;
+    static const size_t DEFAULT_CHUNK_SIZE = 64;
 
     /**
     * @brief Constructor
@@ -201,6 +220,81 @@ public:
     const EntityMap&
     entities() const;
 
+    /**
+    * @brief Calls a function for every relevant entity, in parallel
+    *
+    * The entities are split into consecutive chunks of \a chunkSize
+    * entities. The chunks only depend on the filter's content and
+    * \a chunkSize, so the same entities always end up in the same chunk.
+    * Each chunk is processed in order on one thread, different chunks may
+    * run concurrently. Returns once all chunks are done.
+    *
+    * The function must not add components or entities. Removals are
+    * fine, they are queued until EntityManager::processRemovals().
+    *
+    * @param function
+    *   Called with an entry of entities(), i.e. an
+    *   <tt>std::pair<EntityId, ComponentGroup></tt>
+    * @param chunkSize
+    *   The number of entities per task
+    */
+    template<typename Function>
+    void
+    parallelForEach(
+        Function function,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE
+    ) const {
+        this->parallelForEach(ThreadPool::global(), function, chunkSize);
+    }
+
+    /**
+    * @brief Calls a function for every relevant entity, in parallel
+    *
+    * Like the other overload, but runs on \a threadPool.
+    */
+    template<typename Function>
+    void
+    parallelForEach(
+        ThreadPool& threadPool,
+        Function function,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE
+    ) const;
+
+    /**
+    * @brief Like parallelForEach(), but with a command buffer per chunk
+    *
+    * The function records structural changes (creating entities, adding
+    * components) into the command buffer it is passed. After all chunks
+    * are done, the buffers are played back on the calling thread in chunk
+    * order, so the result doesn't depend on thread scheduling.
+    *
+    * @param function
+    *   Called with an entry of entities() and an EntityCommandBuffer&
+    * @param chunkSize
+    *   The number of entities per task
+    */
+    template<typename Function>
+    void
+    parallelForEachDeferred(
+        Function function,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE
+    ) {
+        this->parallelForEachDeferred(ThreadPool::global(), function, chunkSize);
+    }
+
+    /**
+    * @brief Like parallelForEach(), but with a command buffer per chunk
+    *
+    * Like the other overload, but runs on \a threadPool.
+    */
+    template<typename Function>
+    void
+    parallelForEachDeferred(
+        ThreadPool& threadPool,
+        Function function,
+        size_t chunkSize = DEFAULT_CHUNK_SIZE
+    );
+
     /**
     * @brief Returns the entities removed from this filter
     *
@@ -2,10 +2,16 @@
 
 #include "engine/component_collection.h"
 #include "engine/component_factory.h"
+#include "engine/component_signature.h"
+#include "engine/entity_template.h"
 #include "engine/serialization.h"
+#include "engine/thread_pool.h"
 
 #include <atomic>
 #include <boost/thread.hpp>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -37,45 +43,392 @@ EntityManager::luaBindings(sol::state &lua){
             }),
 
         "storage", &EntityManager::storage,
+        "snapshot", &EntityManager::snapshot,
+        "delta", &EntityManager::delta,
+        "applyDelta", &EntityManager::applyDelta,
         "restore", &EntityManager::restore,
+        "instantiate", sol::overload(
+            [](EntityManager& self, const EntityTemplate& entityTemplate) {
+                return self.instantiate(entityTemplate);
+            },
+            [](EntityManager& self, const EntityTemplate& entityTemplate,
+                sol::table positionTable, sol::this_state s)
+            {
+                std::vector<Ogre::Vector3> positions;
+                positions.reserve(positionTable.size());
+                for (size_t i = 1; i <= positionTable.size(); ++i) {
+                    positions.push_back(positionTable.get<Ogre::Vector3>(i));
+                }
+                sol::state_view lua(s);
+                sol::table entityIds = lua.create_table();
+                int index = 1;
+                for (EntityId entityId : self.instantiate(entityTemplate, positions)) {
+                    entityIds[index++] = entityId;
+                }
+                return entityIds;
+            }
+        ),
         "clear", &EntityManager::clear,
         
         "generateNewId", &EntityManager::generateNewId,
+        "exists", &EntityManager::exists,
+        "componentSignature", &EntityManager::componentSignature,
+        "hasComponents", &EntityManager::hasComponents,
+        "signatureOf", [](EntityManager& self, sol::table componentTypes) {
+            ComponentSignature signature;
+            for (const auto& pair : componentTypes) {
+                ComponentTypeId typeId = pair.second.as<sol::table>().get<
+                    ComponentTypeId>("TYPE_ID");
+                size_t bit = self.componentBit(typeId);
+                if (bit == ComponentSignature::NO_BIT) {
+                    throw std::runtime_error("Component type has no signature bit");
+                }
+                signature.set(bit);
+            }
+            return signature;
+        },
         "transferEntity", &EntityManager::transferEntity
     );
 }
 
+namespace {
+
+/**
+* @brief Bookkeeping for one entity slot
+*/
+struct EntitySlot {
+
+    ComponentSignature signature;
+
+    EntityId generation = 0;
+
+    uint16_t componentCount = 0;
+
+    bool isAllocated = false;
+
+};
+
+/**
+* @brief A collection's components, stored by EntityManager::storage()
+*/
+struct StoredCollection {
+
+    std::string typeName;
+
+    StorageList components;
+
+};
+
+/**
+* @brief A collection's components, loaded by EntityManager::restore()
+*/
+struct LoadedCollection {
+
+    std::string typeName;
+
+    StorageList storage;
+
+    std::vector<std::unique_ptr<Component>> components;
+
+};
+
+} // namespace
+
 struct EntityManager::Implementation {
 
+    Implementation() {
+        // Slot 0 is reserved so that NULL_ENTITY is never handed out
+        m_slots.resize(1);
+        m_slots[0].isAllocated = true;
+    }
+
+    EntityId
+    allocate() {
+        while (not m_freeSlots.empty()) {
+            EntityId index = m_freeSlots.front();
+            m_freeSlots.pop_front();
+            // Free slots may have been claimed by restore() in the meantime
+            if (not m_slots[index].isAllocated) {
+                m_slots[index].isAllocated = true;
+                return makeEntityId(index, m_slots[index].generation);
+            }
+        }
+        EntityId index = static_cast<EntityId>(m_slots.size());
+        assert(index <= ENTITY_INDEX_MASK && "Out of entity slots");
+        m_slots.emplace_back();
+        m_slots.back().isAllocated = true;
+        return makeEntityId(index, 0);
+    }
+
+    /**
+    * @brief Allocates the slot of \a entityId with its generation
+    *
+    * Only for ids read back from storage, everything else must go through
+    * allocate(). Slots skipped by growing the slot array become free slots.
+    *
+    * @return
+    *   Whether the slot is now allocated with \a entityId's generation
+    */
+    bool
+    claim(
+        EntityId entityId
+    ) {
+        EntityId index = entityIndex(entityId);
+        if (index == NULL_ENTITY) {
+            return false;
+        }
+        if (index >= m_slots.size()) {
+            for (EntityId gap = static_cast<EntityId>(m_slots.size()); gap < index; ++gap) {
+                m_freeSlots.push_back(gap);
+            }
+            m_slots.resize(index + 1);
+        }
+        EntitySlot& slot = m_slots[index];
+        if (slot.isAllocated) {
+            return slot.generation == entityGeneration(entityId);
+        }
+        slot.generation = entityGeneration(entityId);
+        slot.isAllocated = true;
+        return true;
+    }
+
+    EntitySlot*
+    liveSlot(
+        EntityId entityId
+    ) {
+        EntityId index = entityIndex(entityId);
+        if (index == NULL_ENTITY or index >= m_slots.size()) {
+            return nullptr;
+        }
+        EntitySlot& slot = m_slots[index];
+        if (not slot.isAllocated or
+            slot.generation != entityGeneration(entityId)
+        ) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    const EntitySlot*
+    liveSlot(
+        EntityId entityId
+    ) const {
+        return const_cast<Implementation*>(this)->liveSlot(entityId);
+    }
+
+    void
+    release(
+        EntityId entityId
+    ) {
+        EntitySlot* slot = this->liveSlot(entityId);
+        if (not slot) {
+            return;
+        }
+        slot->isAllocated = false;
+        slot->componentCount = 0;
+        slot->signature.reset();
+        slot->generation = (slot->generation + 1) & ENTITY_GENERATION_MASK;
+        m_freeSlots.push_back(entityIndex(entityId));
+        m_volatileEntities.erase(entityId);
+    }
+
+    void
+    rebuildFreeSlots() {
+        m_freeSlots.clear();
+        for (size_t i = 1; i < m_slots.size(); ++i) {
+            if (not m_slots[i].isAllocated) {
+                m_freeSlots.push_back(static_cast<EntityId>(i));
+            }
+        }
+    }
+
+    /**
+    * @brief Adds a component to a live entity
+    *
+    * @param collection
+    *   The collection for the component's type
+    *
+    * @param bit
+    *   The collection's signature bit
+    */
+    void
+    attach(
+        EntityId entityId,
+        ComponentCollection& collection,
+        size_t bit,
+        std::unique_ptr<Component> component
+    ) {
+        EntitySlot* slot = this->liveSlot(entityId);
+        if (not slot) {
+            throw std::runtime_error("Cannot add component to stale entity id");
+        }
+        // The signature bit has to be set before the added-callbacks run so
+        // that entity filters can rely on it
+        slot->signature.set(bit);
+        bool isNew = collection.addComponent(entityId, std::move(component));
+        if (isNew) {
+            // Added-callbacks may create entities and move the slots
+            this->liveSlot(entityId)->componentCount += 1;
+        }
+    }
+
+    size_t
+    collectionBit(
+        ComponentTypeId typeId
+    ) {
+        auto iter = m_collectionBits.find(typeId);
+        if (iter != m_collectionBits.end()) {
+            return iter->second;
+        }
+        this->getComponentCollection(typeId);
+        return m_collectionBits[typeId];
+    }
+
     ComponentCollection&
     getComponentCollection(
         ComponentTypeId typeId
     ) {
+        // Lookups of existing collections must not modify the map, they may
+        // happen concurrently
+        auto iter = m_collections.find(typeId);
+        if (iter != m_collections.end()) {
+            return *iter->second;
+        }
         std::unique_ptr<ComponentCollection>& collection = m_collections[typeId];
         if (not collection) {
-            collection.reset(new ComponentCollection(typeId));
+            collection.reset(new ComponentCollection(
+                typeId,
+                ComponentCollection::defaultStorage(typeId)
+            ));
+            if (m_collectionsByBit.size() < ComponentSignature::MAX_BITS) {
+                m_collectionBits[typeId] = m_collectionsByBit.size();
+                m_collectionsByBit.push_back(collection.get());
+                m_removalBuckets.emplace_back();
+            }
+            else {
+                m_collectionBits[typeId] = ComponentSignature::NO_BIT;
+                m_overflowCollections.push_back(collection.get());
+            }
         }
         return *collection;
     }
 
+    void
+    componentRemoved(
+        EntityId entityId
+    ) {
+        EntitySlot* slot = this->liveSlot(entityId);
+        assert(slot && slot->componentCount > 0 && "Removed component from non-existent entity");
+        slot->componentCount -= 1;
+        if (slot->componentCount == 0) {
+            m_emptiedEntities.push_back(entityId);
+        }
+    }
+
+    void
+    queueComponentRemoval(
+        EntityId entityId,
+        ComponentTypeId typeId
+    ) {
+        EntitySlot* slot = this->liveSlot(entityId);
+        auto iter = m_collectionBits.find(typeId);
+        if (not slot or iter == m_collectionBits.end()) {
+            return;
+        }
+        size_t bit = iter->second;
+        if (bit != ComponentSignature::NO_BIT) {
+            // Clearing the bit right away also drops duplicate requests
+            if (slot->signature.test(bit)) {
+                slot->signature.reset(bit);
+                m_removalBuckets[bit].push_back(entityId);
+            }
+        }
+        else if (m_collections[typeId]->removeComponent(entityId)) {
+            this->componentRemoved(entityId);
+        }
+    }
+
+    void
+    queueEntityRemoval(
+        EntityId entityId
+    ) {
+        EntitySlot* slot = this->liveSlot(entityId);
+        if (not slot) {
+            return;
+        }
+        slot->signature.forEachSetBit([this, entityId](size_t bit) {
+            m_removalBuckets[bit].push_back(entityId);
+        });
+        slot->signature.reset();
+        for (ComponentCollection* collection : m_overflowCollections) {
+            if (collection->removeComponent(entityId)) {
+                this->componentRemoved(entityId);
+            }
+        }
+    }
+
+    void
+    removeQueuedComponents() {
+        for (size_t bit = 0; bit < m_removalBuckets.size(); ++bit) {
+            std::vector<EntityId>& bucket = m_removalBuckets[bit];
+            if (bucket.empty()) {
+                continue;
+            }
+            m_collectionsByBit[bit]->removeComponents(bucket);
+            for (EntityId entityId : bucket) {
+                this->componentRemoved(entityId);
+            }
+            bucket.clear();
+        }
+    }
+
     std::unordered_map<
         ComponentTypeId,
         std::unique_ptr<ComponentCollection>
     > m_collections;
 
-    std::list<std::pair<EntityId, ComponentTypeId>> m_componentsToRemove;
+    std::unordered_map<ComponentTypeId, size_t> m_collectionBits;
+
+    std::vector<ComponentCollection*> m_collectionsByBit;
+
+    std::vector<ComponentCollection*> m_overflowCollections;
 
-    EntityId m_currentId = NULL_ENTITY + 1;
+    std::vector<std::pair<EntityId, ComponentTypeId>> m_componentsToRemove;
 
-    std::unordered_map<EntityId, uint16_t> m_entities;
+    // Guards the removal queues, systems updated in parallel may request
+    // removals concurrently
+    std::mutex m_removalMutex;
 
-    std::list<EntityId> m_entitiesToRemove;
+    std::vector<EntitySlot> m_slots;
+
+    std::deque<EntityId> m_freeSlots;
+
+    std::vector<EntityId> m_entitiesToRemove;
 
     std::unordered_map<std::string, EntityId> m_namedIds;
 
     std::unordered_set<EntityId> m_volatileEntities;
 
-    std::unordered_map<EntityId, std::vector<EntityId>*> m_entityChildren;
+    std::unordered_map<EntityId, std::vector<EntityId>> m_entityChildren;
+
+    // Content hashes of the components in the last snapshot, by type name
+    // and owner
+    std::unordered_map<
+        std::string,
+        std::unordered_map<EntityId, size_t>
+    > m_snapshotHashes;
+
+    bool m_hasSnapshot = false;
+
+    // Scratch buffers for processRemovals(), kept to reuse their capacity
+
+    std::vector<std::vector<EntityId>> m_removalBuckets;
+
+    std::vector<EntityId> m_emptiedEntities;
+
+    std::vector<std::pair<EntityId, ComponentTypeId>> m_pendingComponents;
+
+    std::vector<EntityId> m_pendingEntities;
 
 };
 
@@ -95,15 +448,13 @@ EntityManager::addComponent(
 ) {
     assert(entityId != NULL_ENTITY);
     ComponentTypeId typeId = component->typeId();
-    auto& componentCollection = m_impl->getComponentCollection(typeId);
     Component* rawComponent = component.get();
-    bool isNew = componentCollection.addComponent(
+    m_impl->attach(
         entityId,
+        m_impl->getComponentCollection(typeId),
+        m_impl->collectionBit(typeId),
         std::move(component)
     );
-    if (isNew) {
-        m_impl->m_entities[entityId] += 1;
-    }
     return rawComponent;
 }
 
@@ -114,8 +465,15 @@ EntityManager::clear() {
         pair.second->clear();
     }
     m_impl->m_componentsToRemove.clear();
-    m_impl->m_entities.clear();
+    // Release all slots so that ids handed out so far become stale
+    for (size_t i = 1; i < m_impl->m_slots.size(); ++i) {
+        EntitySlot& slot = m_impl->m_slots[i];
+        if (slot.isAllocated) {
+            m_impl->release(makeEntityId(static_cast<EntityId>(i), slot.generation));
+        }
+    }
     m_impl->m_entitiesToRemove.clear();
+    m_impl->m_entityChildren.clear();
     m_impl->m_namedIds.clear();
     m_impl->m_volatileEntities.clear();
 }
@@ -124,8 +482,11 @@ EntityManager::clear() {
 std::unordered_set<EntityId>
 EntityManager::entities() {
     std::unordered_set<EntityId> entities;
-    for (const auto& pair : m_impl->m_entities) {
-        entities.insert(pair.first);
+    for (size_t i = 1; i < m_impl->m_slots.size(); ++i) {
+        const EntitySlot& slot = m_impl->m_slots[i];
+        if (slot.isAllocated and slot.componentCount > 0) {
+            entities.insert(makeEntityId(static_cast<EntityId>(i), slot.generation));
+        }
     }
     return entities;
 }
@@ -135,13 +496,49 @@ bool
 EntityManager::exists(
     EntityId entityId
 ) const {
-    return m_impl->m_entities.find(entityId) != m_impl->m_entities.end();
+    const EntitySlot* slot = m_impl->liveSlot(entityId);
+    return slot and slot->componentCount > 0;
 }
 
 
 EntityId
 EntityManager::generateNewId() {
-    return m_impl->m_currentId++;
+    return m_impl->allocate();
+}
+
+
+bool
+EntityManager::isValid(
+    EntityId entityId
+) const {
+    return m_impl->liveSlot(entityId) != nullptr;
+}
+
+
+size_t
+EntityManager::componentBit(
+    ComponentTypeId typeId
+) {
+    return m_impl->collectionBit(typeId);
+}
+
+
+ComponentSignature
+EntityManager::componentSignature(
+    EntityId entityId
+) const {
+    const EntitySlot* slot = m_impl->liveSlot(entityId);
+    return slot ? slot->signature : ComponentSignature();
+}
+
+
+bool
+EntityManager::hasComponents(
+    EntityId entityId,
+    const ComponentSignature& signature
+) const {
+    const EntitySlot* slot = m_impl->liveSlot(entityId);
+    return slot and slot->signature.containsAll(signature);
 }
 
 
@@ -174,7 +571,8 @@ EntityManager::getNamedId(
     }
     auto iter = m_impl->m_namedIds.find(name);
     if (iter != m_impl->m_namedIds.end()) {
-        if (forceNew){
+        // The named entity may have been destroyed and its slot recycled
+        if (forceNew or not this->isValid(iter->second)){
             iter->second = this->generateNewId();
         }
         return iter->second;
@@ -217,40 +615,52 @@ EntityManager::nonEmptyCollections() const {
 
 void
 EntityManager::processRemovals() {
-    for (const auto& pair : m_impl->m_componentsToRemove) {
-        EntityId entityId = pair.first;
-        ComponentTypeId typeId = pair.second;
-        auto& componentCollection = m_impl->getComponentCollection(typeId);
-        bool removed = componentCollection.removeComponent(entityId);
-        if (removed) {
-            auto iter = m_impl->m_entities.find(entityId);
-            iter->second -= 1;
-            if (iter->second == 0) {
-                m_impl->m_entities.erase(iter);
-                auto childIter = m_impl->m_entityChildren.find(entityId);
-                if (childIter != m_impl->m_entityChildren.end()){
-                     m_impl->m_entitiesToRemove.push_back(childIter->first);
-                }
-                m_impl->m_entityChildren.erase(childIter);
+    Implementation& impl = *m_impl;
+    // Removals requested while processing (e.g. by component destructors)
+    // are handled in another round
+    while (not impl.m_componentsToRemove.empty() or
+        not impl.m_entitiesToRemove.empty()
+    ) {
+        impl.m_pendingComponents.swap(impl.m_componentsToRemove);
+        impl.m_pendingEntities.swap(impl.m_entitiesToRemove);
+        // Single components, batched per collection
+        for (const auto& pair : impl.m_pendingComponents) {
+            impl.queueComponentRemoval(pair.first, pair.second);
+        }
+        impl.removeQueuedComponents();
+        // Entities that lost their last component cease to exist. Their
+        // children have to be removed, too.
+        for (EntityId entityId : impl.m_emptiedEntities) {
+            if (impl.m_entityChildren.count(entityId) > 0) {
+                impl.m_pendingEntities.push_back(entityId);
             }
             else {
-                assert(iter->second > 0 && "Removed component from non-existent entity");
+                impl.release(entityId);
             }
         }
-    }
-    m_impl->m_componentsToRemove.clear();
-    for (EntityId entityId : m_impl->m_entitiesToRemove) {
-        if (m_impl->m_entityChildren.find(entityId) != m_impl->m_entityChildren.end()){
-            for(EntityId childId : *m_impl->m_entityChildren.at(entityId)){
-                m_impl->m_entitiesToRemove.push_back(childId);
+        impl.m_emptiedEntities.clear();
+        // Whole entities, including their children
+        for (size_t i = 0; i < impl.m_pendingEntities.size(); ++i) {
+            EntityId entityId = impl.m_pendingEntities[i];
+            auto childIter = impl.m_entityChildren.find(entityId);
+            if (childIter != impl.m_entityChildren.end()) {
+                impl.m_pendingEntities.insert(
+                    impl.m_pendingEntities.end(),
+                    childIter->second.begin(),
+                    childIter->second.end()
+                );
+                impl.m_entityChildren.erase(childIter);
             }
-            m_impl->m_entityChildren.erase(entityId);
+            impl.queueEntityRemoval(entityId);
         }
-        for (const auto& pair : m_impl->m_collections) {
-            pair.second->removeComponent(entityId);
+        impl.removeQueuedComponents();
+        impl.m_emptiedEntities.clear();
+        for (EntityId entityId : impl.m_pendingEntities) {
+            impl.release(entityId);
         }
+        impl.m_pendingComponents.clear();
+        impl.m_pendingEntities.clear();
     }
-    m_impl->m_entitiesToRemove.clear();
 }
 
 
@@ -259,6 +669,7 @@ EntityManager::removeComponent(
     EntityId entityId,
     ComponentTypeId typeId
 ) {
+    std::lock_guard<std::mutex> lock(m_impl->m_removalMutex);
     m_impl->m_componentsToRemove.emplace_back(entityId, typeId);
 }
 
@@ -266,6 +677,7 @@ void
 EntityManager::removeEntity(
     EntityId entityId
 ) {
+    std::lock_guard<std::mutex> lock(m_impl->m_removalMutex);
     m_impl->m_entitiesToRemove.push_back(entityId);
 }
 
@@ -313,47 +725,137 @@ EntityManager::storeEntity(
 
 EntityId
 EntityManager::loadEntity(
-    StorageContainer storage,
+    const StorageContainer& storage,
     const ComponentFactory& componentFactory
+) {
+    return this->instantiate(EntityTemplate(storage, componentFactory));
+}
+
+EntityId
+EntityManager::instantiate(
+    const EntityTemplate& entityTemplate
 ) {
     EntityId entityId = this->generateNewId();
-    StorageList componentList = storage.get<StorageList>("components");
-    for (const StorageContainer& entry : componentList) {
-        auto component = componentFactory.load(entry.get<std::string>("typename"), entry);
-        this->addComponent(entityId, std::move(component));
+    for (const EntityTemplate::Part& part : entityTemplate.parts()) {
+        this->addComponent(entityId, part.create(nullptr));
     }
     return entityId;
 }
 
+std::vector<EntityId>
+EntityManager::instantiate(
+    const EntityTemplate& entityTemplate,
+    const std::vector<Ogre::Vector3>& positions
+) {
+    // Collections and signature bits are looked up once per template
+    // component, not once per instance
+    struct Target {
+        ComponentTypeId typeId;
+        ComponentCollection* collection;
+        size_t bit;
+    };
+    std::vector<Target> targets(
+        entityTemplate.size(),
+        Target{NULL_COMPONENT_TYPE, nullptr, ComponentSignature::NO_BIT}
+    );
+    std::vector<EntityId> entityIds;
+    entityIds.reserve(positions.size());
+    for (const Ogre::Vector3& position : positions) {
+        EntityId entityId = this->generateNewId();
+        for (size_t i = 0; i < targets.size(); ++i) {
+            Target& target = targets[i];
+            auto component = entityTemplate.parts()[i].create(&position);
+            ComponentTypeId typeId = component->typeId();
+            if (typeId != target.typeId) {
+                target.typeId = typeId;
+                target.collection = &m_impl->getComponentCollection(typeId);
+                target.bit = m_impl->collectionBit(typeId);
+            }
+            m_impl->attach(
+                entityId,
+                *target.collection,
+                target.bit,
+                std::move(component)
+            );
+        }
+        entityIds.push_back(entityId);
+    }
+    return entityIds;
+}
+
 void
 EntityManager::restore(
     const StorageContainer& storage,
     const ComponentFactory& factory
 ) {
     this->clear();
-    // Current Id
-    m_impl->m_currentId = storage.get<EntityId>("currentId");
+    // Number of slots ("currentId" in older saves, where ids were never
+    // recycled and equal their slot index). Older saves with more ids than
+    // fit into the index bits can't be restored, their higher ids would be
+    // taken for generations of lower ones.
+    EntityId slotCount = storage.get<EntityId>("currentId");
+    if (slotCount > ENTITY_INDEX_MASK + 1) {
+        throw std::runtime_error(
+            "Cannot restore " + std::to_string(slotCount) +
+            " entity slots, at most " + std::to_string(ENTITY_INDEX_MASK + 1) +
+            " are supported"
+        );
+    }
+    if (slotCount > m_impl->m_slots.size()) {
+        m_impl->m_slots.resize(slotCount);
+    }
     // Named entities
     StorageList namedIds = storage.get<StorageList>("namedIds");
     for (const auto& entry : namedIds) {
         std::string name = entry.get<std::string>("name");
         EntityId id = entry.get<EntityId>("entityId");
+        m_impl->claim(id);
         m_impl->m_namedIds[name] = id;
     }
-    // Collections
+    // Collections. Thread safe component types are loaded in parallel, one
+    // task per collection. Only adding them to the collections is sequential.
     StorageContainer collections = storage.get<StorageContainer>("collections");
     auto typeNames = collections.keys();
+    std::vector<LoadedCollection> loaded(typeNames.size());
+    std::vector<ThreadPool::Task> tasks;
+    size_t index = 0;
     for (const std::string& typeName : typeNames) {
-        StorageList componentList = collections.get<StorageList>(typeName);
-        for (const StorageContainer& componentStorage : componentList) {
-            auto component = factory.load(typeName, componentStorage);
+        LoadedCollection& collection = loaded[index++];
+        collection.typeName = typeName;
+        collection.storage = collections.get<StorageList>(typeName);
+        auto load = [&collection, &factory]() {
+            collection.components.reserve(collection.storage.size());
+            for (const StorageContainer& componentStorage : collection.storage) {
+                collection.components.push_back(
+                    factory.load(collection.typeName, componentStorage)
+                );
+            }
+        };
+        if (factory.isThreadSafeType(typeName)) {
+            tasks.push_back(load);
+        }
+        else {
+            // May touch the Lua state, load on the calling thread
+            load();
+        }
+    }
+    ThreadPool::global().run(tasks);
+    for (LoadedCollection& collection : loaded) {
+        for (auto& component : collection.components) {
+            if (not component) {
+                std::cerr << "Unknown component type: " << collection.typeName << std::endl;
+                break;
+            }
             EntityId owner = component->owner();
             if (owner == NULL_ENTITY) {
-                std::cerr << "Component with no entity: " << typeName << std::endl;
+                std::cerr << "Component with no entity: " << collection.typeName << std::endl;
+                continue;
             }
+            m_impl->claim(owner);
             this->addComponent(owner, std::move(component));
         }
     }
+    m_impl->rebuildFreeSlots();
     // Components to remove
     StorageList componentsToRemove = storage.get<StorageList>("componentsToRemove");
     for (const StorageContainer& entry : componentsToRemove) {
@@ -375,10 +877,7 @@ EntityManager::addChild(
     EntityId child,
     EntityId parent
 ) {
-    if (m_impl->m_entityChildren.find(parent) == m_impl->m_entityChildren.end()){
-        m_impl->m_entityChildren.insert(std::make_pair(parent, new std::vector<EntityId>()));
-    }
-    m_impl->m_entityChildren.at(parent)->push_back(child);
+    m_impl->m_entityChildren[parent].push_back(child);
 }
 
 bool
@@ -420,27 +919,49 @@ EntityManager::storage(
     const ComponentFactory& factory
 ) const {
     StorageContainer storage;
-    // Current Id
-    storage.set("currentId", m_impl->m_currentId);
-    // Collections
-    StorageContainer collections;
+    // Slot count
+    storage.set("currentId", static_cast<EntityId>(m_impl->m_slots.size()));
+    // Collections. Thread safe component types are stored in parallel, one
+    // task per collection.
+    std::vector<StoredCollection> stored;
+    stored.reserve(m_impl->m_collections.size());
+    std::vector<ThreadPool::Task> tasks;
     for (const auto& item : m_impl->m_collections) {
-        const auto& components = item.second->components();
-        StorageList componentList;
-        componentList.reserve(components.size());
-        for (const auto& pair : components) {
-            EntityId entityId = pair.first;
-            const std::unique_ptr<Component>& component = pair.second;
-            if (component->isVolatile() or
-                m_impl->m_volatileEntities.count(entityId) > 0
-            ) {
-                continue;
+        if (item.second->empty()) {
+            continue;
+        }
+        stored.emplace_back();
+        StoredCollection& collection = stored.back();
+        collection.typeName = factory.getTypeName(item.first);
+        const ComponentCollection& source = *item.second;
+        auto store = [this, &collection, &source]() {
+            const auto& entities = source.entities();
+            const auto& components = source.components();
+            collection.components.reserve(components.size());
+            for (size_t i = 0; i < components.size(); ++i) {
+                EntityId entityId = entities[i];
+                const std::unique_ptr<Component>& component = components[i];
+                if (component->isVolatile() or
+                    m_impl->m_volatileEntities.count(entityId) > 0
+                ) {
+                    continue;
+                }
+                collection.components.append(component->storage());
             }
-            componentList.append(component->storage());
+        };
+        if (factory.isThreadSafeType(collection.typeName)) {
+            tasks.push_back(store);
         }
-        if (not componentList.empty()) {
-            std::string typeName = factory.getTypeName(item.first);
-            collections.set(typeName, std::move(componentList));
+        else {
+            // May touch the Lua state, store on the calling thread
+            store();
+        }
+    }
+    ThreadPool::global().run(tasks);
+    StorageContainer collections;
+    for (StoredCollection& collection : stored) {
+        if (not collection.components.empty()) {
+            collections.set(collection.typeName, std::move(collection.components));
         }
     }
     storage.set("collections", std::move(collections));
@@ -478,3 +999,131 @@ EntityManager::storage(
 }
 
 
+StorageContainer
+EntityManager::snapshot(
+    const ComponentFactory& factory
+) {
+    StorageContainer storage = this->storage(factory);
+    m_impl->m_snapshotHashes.clear();
+    StorageContainer collections = storage.get<StorageContainer>("collections");
+    for (const std::string& typeName : collections.keys()) {
+        auto& hashes = m_impl->m_snapshotHashes[typeName];
+        for (const StorageContainer& component : collections.get<StorageList>(typeName)) {
+            hashes[component.get<EntityId>("owner")] = component.contentHash();
+        }
+    }
+    m_impl->m_hasSnapshot = true;
+    return storage;
+}
+
+
+StorageContainer
+EntityManager::delta(
+    const ComponentFactory& factory
+) const {
+    if (not m_impl->m_hasSnapshot) {
+        throw std::logic_error("No snapshot to build a delta against");
+    }
+    StorageContainer storage = this->storage(factory);
+    StorageContainer collections = storage.get<StorageContainer>("collections");
+    StorageContainer changedCollections;
+    StorageList removedComponents;
+    auto addRemoved = [&removedComponents](const std::string& typeName, EntityId entityId) {
+        StorageContainer entry;
+        entry.set("entityId", entityId);
+        entry.set("componentTypeName", typeName);
+        removedComponents.append(std::move(entry));
+    };
+    for (const std::string& typeName : collections.keys()) {
+        StorageList componentList = collections.get<StorageList>(typeName);
+        auto hashIter = m_impl->m_snapshotHashes.find(typeName);
+        if (hashIter == m_impl->m_snapshotHashes.end()) {
+            changedCollections.set(typeName, std::move(componentList));
+            continue;
+        }
+        const auto& hashes = hashIter->second;
+        std::unordered_set<EntityId> owners;
+        StorageList changedList;
+        for (const StorageContainer& component : componentList) {
+            EntityId owner = component.get<EntityId>("owner");
+            owners.insert(owner);
+            auto iter = hashes.find(owner);
+            if (iter == hashes.end() or iter->second != component.contentHash()) {
+                changedList.append(component);
+            }
+        }
+        if (not changedList.empty()) {
+            changedCollections.set(typeName, std::move(changedList));
+        }
+        for (const auto& pair : hashes) {
+            if (owners.count(pair.first) == 0) {
+                addRemoved(typeName, pair.first);
+            }
+        }
+    }
+    // Collections that are gone completely
+    for (const auto& item : m_impl->m_snapshotHashes) {
+        if (collections.contains(item.first)) {
+            continue;
+        }
+        for (const auto& pair : item.second) {
+            addRemoved(item.first, pair.first);
+        }
+    }
+    storage.set("collections", std::move(changedCollections));
+    storage.set("removedComponents", std::move(removedComponents));
+    return storage;
+}
+
+
+StorageContainer
+EntityManager::applyDelta(
+    const StorageContainer& snapshot,
+    const StorageContainer& delta
+) {
+    // Everything but the collections is stored in full in the delta
+    StorageContainer merged = delta;
+    StorageContainer snapshotCollections = snapshot.get<StorageContainer>("collections");
+    StorageContainer deltaCollections = delta.get<StorageContainer>("collections");
+    // Snapshot components that are removed or replaced
+    std::unordered_map<std::string, std::unordered_set<EntityId>> dropped;
+    for (const StorageContainer& entry : delta.get<StorageList>("removedComponents")) {
+        dropped[entry.get<std::string>("componentTypeName")].insert(
+            entry.get<EntityId>("entityId")
+        );
+    }
+    for (const std::string& typeName : deltaCollections.keys()) {
+        auto& owners = dropped[typeName];
+        for (const StorageContainer& component : deltaCollections.get<StorageList>(typeName)) {
+            owners.insert(component.get<EntityId>("owner"));
+        }
+    }
+    StorageContainer collections;
+    for (const std::string& typeName : snapshotCollections.keys()) {
+        StorageList componentList = snapshotCollections.get<StorageList>(typeName);
+        auto iter = dropped.find(typeName);
+        if (iter != dropped.end()) {
+            StorageList kept;
+            kept.reserve(componentList.size());
+            for (const StorageContainer& component : componentList) {
+                if (iter->second.count(component.get<EntityId>("owner")) == 0) {
+                    kept.append(component);
+                }
+            }
+            componentList = std::move(kept);
+        }
+        for (const StorageContainer& component : deltaCollections.get<StorageList>(typeName)) {
+            componentList.append(component);
+        }
+        if (not componentList.empty()) {
+            collections.set(typeName, std::move(componentList));
+        }
+    }
+    for (const std::string& typeName : deltaCollections.keys()) {
+        if (not snapshotCollections.contains(typeName)) {
+            collections.set(typeName, deltaCollections.get<StorageList>(typeName));
+        }
+    }
+    merged.set("collections", std::move(collections));
+    return merged;
+}
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "engine/component_signature.h"
 #include "engine/typedefs.h"
 #include "util/make_unique.h"
 
 #include <memory>
+#include <OgreVector3.h>
 #include <unordered_set>
+#include <vector>
 
 namespace sol{
 class state;
@@ -15,6 +18,7 @@ namespace thrive {
 class Component;
 class ComponentCollection;
 class ComponentFactory;
+class EntityTemplate;
 class GameStateData;
 class StorageContainer;
 
@@ -34,6 +38,17 @@ public:
     *
     * Exposes:
     * - EntityManager::new
+    * - EntityManager::exists
+    * - EntityManager::componentSignature
+    * - EntityManager::hasComponents
+    * - EntityManager::signatureOf: Takes a table of component classes
+    * - EntityManager::storage
+    * - EntityManager::snapshot
+    * - EntityManager::delta
+    * - EntityManager::applyDelta
+    * - EntityManager::restore
+    * - EntityManager::instantiate: Takes a template and optionally a table
+    *   of positions, returning a table of entity ids for the latter
     *
     * @return
     */
@@ -61,6 +76,9 @@ public:
     * @return
     *   The component as a non-owning pointer
     *
+    * @throws std::runtime_error if \a entityId was not generated by this
+    *   manager or its entity has been removed
+    *
     * @note:
     *   Use the templated version to receive the proper type back
     */
@@ -116,7 +134,10 @@ public:
     /**
     * @brief Generates a new, unique entity id
     *
-    * This function is safe.
+    * Entity ids consist of a slot index and a generation (see
+    * ENTITY_INDEX_BITS). Slots of removed entities are recycled with an
+    * increased generation, so ids of removed entities stay distinguishable
+    * from the ids of new ones.
     *
     * @return A new entity id
     */
@@ -189,7 +210,7 @@ public:
     *
     * If the name is unknown, a new entity id is created. This function always
     * returns the same entity id for the same name during the same application
-    * instance.
+    * instance, unless the named entity has been removed in the meantime.
     *
     * @param name
     *   The entity's name
@@ -252,6 +273,71 @@ public:
         EntityId entityId
     ) const;
 
+    /**
+    * @brief Checks whether an entity id is still valid
+    *
+    * An id is valid from its creation by generateNewId() until the entity
+    * is removed, even if no component has been added yet.
+    *
+    * @param entityId
+    *   The id to check for
+    *
+    * @return
+    *   \c false if the id's slot has been recycled or was never handed out
+    */
+    bool
+    isValid(
+        EntityId entityId
+    ) const;
+
+    /**
+    * @brief Returns the signature bit of a component type
+    *
+    * Creates the type's collection if necessary.
+    *
+    * @param typeId
+    *   The component type
+    *
+    * @return
+    *   The bit index or ComponentSignature::NO_BIT if all bits are taken
+    *   by other types. Types without a bit can't be queried by signature.
+    */
+    size_t
+    componentBit(
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Returns the component types an entity has
+    *
+    * @param entityId
+    *   The entity to query
+    *
+    * @return
+    *   The entity's signature. Empty for invalid ids.
+    */
+    ComponentSignature
+    componentSignature(
+        EntityId entityId
+    ) const;
+
+    /**
+    * @brief Checks whether an entity has all components of a signature
+    *
+    * @param entityId
+    *   The entity to check
+    * @param signature
+    *   The required component types, see componentBit()
+    *
+    * @return
+    *   \c true if all bits of \a signature are set for the entity
+    */
+    bool
+    hasComponents(
+        EntityId entityId,
+        const ComponentSignature& signature
+    ) const;
+
     /**
     * @brief Returns the set of non-empty collection ids
     *
@@ -315,10 +401,44 @@ public:
     */
     EntityId
     loadEntity(
-        StorageContainer storage,
+        const StorageContainer& storage,
         const ComponentFactory& componentFactory
     );
 
+    /**
+    * @brief Creates an entity from a template
+    *
+    * @param entityTemplate
+    *   The template
+    *
+    * @return
+    *   The new entity's id
+    */
+    EntityId
+    instantiate(
+        const EntityTemplate& entityTemplate
+    );
+
+    /**
+    * @brief Creates one entity from a template per position
+    *
+    * Components that store a "position" are placed at the entity's
+    * position, everything else is loaded as stored in the template.
+    *
+    * @param entityTemplate
+    *   The template
+    * @param positions
+    *   Where to place the entities
+    *
+    * @return
+    *   The new entities' ids, in the order of \a positions
+    */
+    std::vector<EntityId>
+    instantiate(
+        const EntityTemplate& entityTemplate,
+        const std::vector<Ogre::Vector3>& positions
+    );
+
     /**
     * @brief Removes all components queued for removal
     */
@@ -338,6 +458,7 @@ public:
     *
     * To allow self-removing components such as script handles, the component
     * is only removed with the next call to EntityManager::processRemovals().
+    * Safe to call from systems updated in parallel.
     *
     * @param entityId
     *   The component's owner
@@ -357,6 +478,7 @@ public:
     *
     * To allow self-removing components such as script handles, the component
     * is only removed with the next call to EntityManager::processRemovals().
+    * Safe to call from systems updated in parallel.
     *
     * @param entityId
     *   The entity to remove
@@ -450,6 +572,63 @@ public:
         const ComponentFactory& factory
     ) const;
 
+    /**
+    * @brief Like storage(), but also remembers the stored components as the
+    * base for delta()
+    *
+    * The base survives clear() and restore(), it describes what was written
+    * to a file, not the current state.
+    *
+    * @param factory
+    *   The component factory to use for type name lookup
+    *
+    * @return
+    */
+    StorageContainer
+    snapshot(
+        const ComponentFactory& factory
+    );
+
+    /**
+    * @brief Serializes only what changed since the last snapshot()
+    *
+    * The result has the same layout as storage(), except that "collections"
+    * only holds components that were added or whose stored form differs
+    * from the snapshot. Components in the snapshot that no longer exist are
+    * listed in "removedComponents". Combine it with the snapshot through
+    * applyDelta().
+    *
+    * Each delta is relative to the snapshot, not to the previous delta.
+    *
+    * @param factory
+    *   The component factory to use for type name lookup
+    *
+    * @return
+    *
+    * @throws std::logic_error if no snapshot has been taken
+    */
+    StorageContainer
+    delta(
+        const ComponentFactory& factory
+    ) const;
+
+    /**
+    * @brief Merges a delta() into the snapshot() it was taken against
+    *
+    * @param snapshot
+    *   The snapshot
+    * @param delta
+    *   The delta
+    *
+    * @return
+    *   A container that can be passed to restore()
+    */
+    static StorageContainer
+    applyDelta(
+        const StorageContainer& snapshot,
+        const StorageContainer& delta
+    );
+
 private:
 
     friend class Engine;
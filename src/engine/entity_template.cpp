@@ -0,0 +1,78 @@
+#include "engine/entity_template.h"
+
+#include "scripting/luajit.h"
+
+#include <stdexcept>
+
+using namespace thrive;
+
+
+std::unique_ptr<Component>
+EntityTemplate::Part::create(
+    const Ogre::Vector3* position
+) const {
+    if (position and hasPosition) {
+        // Only the top level of the copy is detached
+        StorageContainer placed = storage;
+        placed.set("position", *position);
+        return loader(placed);
+    }
+    return loader(storage);
+}
+
+
+void
+EntityTemplate::luaBindings(
+    sol::state& lua
+) {
+    lua.new_usertype<EntityTemplate>("EntityTemplate",
+
+        sol::constructors<sol::types<>,
+            sol::types<const StorageContainer&, const ComponentFactory&>>(),
+
+        "size", &EntityTemplate::size
+    );
+}
+
+
+EntityTemplate::EntityTemplate()
+  : m_parts(std::make_shared<std::vector<Part>>())
+{
+}
+
+
+EntityTemplate::EntityTemplate(
+    const StorageContainer& storage,
+    const ComponentFactory& factory
+) {
+    auto parts = std::make_shared<std::vector<Part>>();
+    StorageList components = storage.get<StorageList>("components");
+    parts->reserve(components.size());
+    for (StorageContainer& component : components) {
+        std::string typeName = component.get<std::string>("typename");
+        Part part;
+        part.typeId = factory.getTypeId(typeName);
+        part.loader = factory.getLoader(typeName);
+        if (not part.loader) {
+            throw std::runtime_error(
+                "Unknown component type " + typeName + " in entity template"
+            );
+        }
+        part.hasPosition = component.contains<Ogre::Vector3>("position");
+        part.storage = std::move(component);
+        parts->push_back(std::move(part));
+    }
+    m_parts = std::move(parts);
+}
+
+
+const std::vector<EntityTemplate::Part>&
+EntityTemplate::parts() const {
+    return *m_parts;
+}
+
+
+size_t
+EntityTemplate::size() const {
+    return m_parts->size();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "engine/component_factory.h"
+#include "engine/serialization.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sol {
+class state;
+}
+
+namespace thrive {
+
+/**
+* @brief A decoded entity that can be instantiated many times
+*
+* Loading an entity from storage looks up every component's type by name.
+* A template does that once, keeping each component's storage together with
+* its resolved type and loader. EntityManager::instantiate() then creates
+* components straight from the template.
+*
+* Templates are immutable and cheap to copy, copies share their content.
+* A template keeps the loaders it resolved, so it must not be used after
+* its component types are unregistered.
+*/
+class EntityTemplate {
+
+public:
+
+    /**
+    * @brief One component of the template
+    */
+    struct Part {
+
+        /**
+        * @brief Creates the component
+        *
+        * @param position
+        *   If not null, replaces the stored "position" of components that
+        *   have one
+        */
+        std::unique_ptr<Component>
+        create(
+            const Ogre::Vector3* position
+        ) const;
+
+        /**
+        * @brief Whether the component's storage has a "position"
+        */
+        bool hasPosition;
+
+        /**
+        * @brief The component type's loader
+        */
+        ComponentFactory::ComponentLoader loader;
+
+        /**
+        * @brief The component's storage
+        */
+        StorageContainer storage;
+
+        /**
+        * @brief The component's type
+        */
+        ComponentTypeId typeId;
+
+    };
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - EntityTemplate(storage, componentFactory)
+    * - EntityTemplate::size
+    */
+    static void
+    luaBindings(
+        sol::state& lua
+    );
+
+    /**
+    * @brief Creates an empty template
+    */
+    EntityTemplate();
+
+    /**
+    * @brief Creates a template from a stored entity
+    *
+    * @param storage
+    *   The entity as stored by EntityManager::storeEntity()
+    * @param factory
+    *   The factory to resolve component types with
+    *
+    * @throws std::runtime_error if a component type is unknown to \a factory
+    */
+    EntityTemplate(
+        const StorageContainer& storage,
+        const ComponentFactory& factory
+    );
+
+    /**
+    * @brief The template's components
+    */
+    const std::vector<Part>&
+    parts() const;
+
+    /**
+    * @brief Number of components
+    */
+    size_t
+    size() const;
+
+private:
+
+    std::shared_ptr<const std::vector<Part>> m_parts;
+
+};
+
+}
@@ -0,0 +1,139 @@
+// Fuzz target for reading savegames
+//
+// Feeds arbitrary bytes to operator>> and StorageView. Malformed input must
+// only ever raise exceptions, never crash, hang or allocate without bounds.
+//
+// Built with libFuzzer when SAVEGAME_FUZZING is enabled:
+//
+//     FuzzSavegame corpus/
+//
+// Otherwise FuzzSavegame replays the files given as arguments, e.g. to
+// reproduce a crash, and can write a seed corpus of valid savegames:
+//
+//     FuzzSavegame --seeds corpus/
+//     FuzzSavegame crash-1234
+
+#include "engine/savegame_compression.h"
+#include "engine/serialization.h"
+#include "engine/tests/savegame_generator.h"
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+using namespace thrive;
+
+namespace {
+
+// Deeper views are skipped, decoding them is covered by decode()
+const unsigned int MAX_VIEW_DEPTH = 8;
+
+void
+walk(
+    const StorageView& view,
+    unsigned int depth
+) {
+    if (depth > MAX_VIEW_DEPTH) {
+        return;
+    }
+    for (const std::string& key : view.keys()) {
+        if (view.contains<StorageContainer>(key)) {
+            walk(view.view(key), depth + 1);
+        }
+        else if (view.contains<StorageList>(key)) {
+            for (const StorageView& element : view.list(key)) {
+                walk(element, depth + 1);
+            }
+        }
+        else {
+            view.get<std::string>(key);
+            view.get<Ogre::Vector3>(key);
+            view.get<Ogre::Quaternion>(key);
+        }
+    }
+}
+
+} // namespace
+
+
+extern "C" int
+LLVMFuzzerTestOneInput(
+    const uint8_t* data,
+    size_t size
+) {
+    std::string input(reinterpret_cast<const char*>(data), size);
+    try {
+        std::istringstream stream(input, std::ios_base::in | std::ios_base::binary);
+        StorageContainer storage;
+        stream >> storage;
+        // Whatever could be read must be writable again
+        std::ostringstream output(std::ios_base::out | std::ios_base::binary);
+        output << storage;
+    }
+    catch (const std::exception&) {
+    }
+    try {
+        StorageView view = StorageView::fromBuffer(input);
+        walk(view, 0);
+        view.decode();
+    }
+    catch (const std::exception&) {
+    }
+    return 0;
+}
+
+
+#ifndef THRIVE_LIBFUZZER
+
+namespace {
+
+int
+writeSeeds(
+    const std::string& directory
+) {
+    for (unsigned int componentCount : {1u, 10u, 100u}) {
+        std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+        stream << generateSavegame(componentCount, componentCount);
+        std::string encoded = stream.str();
+        std::string prefix = directory + "/seed_" + std::to_string(componentCount);
+        std::ofstream(prefix + ".bin", std::ofstream::binary) << encoded;
+        std::ofstream(prefix + ".thrz", std::ofstream::binary)
+            << SavegameCompression::compress(encoded);
+    }
+    return 0;
+}
+
+} // namespace
+
+
+int
+main(
+    int argc,
+    char** argv
+) {
+    if (argc == 3 and std::string(argv[1]) == "--seeds") {
+        return writeSeeds(argv[2]);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ifstream::binary);
+        if (not file) {
+            std::cerr << "Could not open " << argv[i] << std::endl;
+            return 1;
+        }
+        std::string input(
+            (std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>()
+        );
+        std::cout << argv[i] << std::endl;
+        LLVMFuzzerTestOneInput(
+            reinterpret_cast<const uint8_t*>(input.data()),
+            input.size()
+        );
+    }
+    return 0;
+}
+
+#endif
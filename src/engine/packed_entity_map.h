@@ -0,0 +1,219 @@
+#pragma once
+
+#include "engine/typedefs.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace thrive {
+
+/**
+* @brief A map from entity ids to values, stored as a sorted packed array
+*
+* The interface mirrors the parts of \c std::unordered_map that the engine
+* uses, but the entries are kept in one contiguous array ordered by entity
+* id. Iterating is a linear scan in a deterministic order, lookups are a
+* binary search.
+*
+* Inserting or erasing invalidates iterators and pointers to entries.
+*
+* @tparam Value
+*   The mapped type
+*/
+template<typename Value>
+class PackedEntityMap {
+
+public:
+
+    using value_type = std::pair<EntityId, Value>;
+
+    using Container = std::vector<value_type>;
+
+    using iterator = typename Container::iterator;
+
+    using const_iterator = typename Container::const_iterator;
+
+    iterator
+    begin() {
+        return m_items.begin();
+    }
+
+    const_iterator
+    begin() const {
+        return m_items.cbegin();
+    }
+
+    const_iterator
+    cbegin() const {
+        return m_items.cbegin();
+    }
+
+    iterator
+    end() {
+        return m_items.end();
+    }
+
+    const_iterator
+    end() const {
+        return m_items.cend();
+    }
+
+    const_iterator
+    cend() const {
+        return m_items.cend();
+    }
+
+    /**
+    * @brief Removes all entries
+    */
+    void
+    clear() {
+        m_items.clear();
+    }
+
+    /**
+    * @brief Returns 1 if \a entityId is in the map, 0 otherwise
+    */
+    size_t
+    count(
+        EntityId entityId
+    ) const {
+        return this->find(entityId) != m_items.cend() ? 1 : 0;
+    }
+
+    /**
+    * @brief Pointer to the first entry of the packed array
+    */
+    const value_type*
+    data() const {
+        return m_items.data();
+    }
+
+    /**
+    * @brief Whether the map is empty
+    */
+    bool
+    empty() const {
+        return m_items.empty();
+    }
+
+    /**
+    * @brief Removes an entry
+    *
+    * @return The number of removed entries (0 or 1)
+    */
+    size_t
+    erase(
+        EntityId entityId
+    ) {
+        auto iter = this->find(entityId);
+        if (iter == m_items.end()) {
+            return 0;
+        }
+        m_items.erase(iter);
+        return 1;
+    }
+
+    iterator
+    find(
+        EntityId entityId
+    ) {
+        auto iter = this->lowerBound(entityId);
+        if (iter != m_items.end() and iter->first == entityId) {
+            return iter;
+        }
+        return m_items.end();
+    }
+
+    const_iterator
+    find(
+        EntityId entityId
+    ) const {
+        auto iter = std::lower_bound(
+            m_items.cbegin(),
+            m_items.cend(),
+            entityId,
+            [](const value_type& item, EntityId id) {
+                return item.first < id;
+            }
+        );
+        if (iter != m_items.cend() and iter->first == entityId) {
+            return iter;
+        }
+        return m_items.cend();
+    }
+
+    /**
+    * @brief Inserts an entry if the entity id is not yet present
+    *
+    * @return
+    *   An iterator to the entry for the entity id and \c true if the entry
+    *   was inserted
+    */
+    std::pair<iterator, bool>
+    insert(
+        value_type item
+    ) {
+        auto iter = this->lowerBound(item.first);
+        if (iter != m_items.end() and iter->first == item.first) {
+            return std::make_pair(iter, false);
+        }
+        iter = m_items.insert(iter, std::move(item));
+        return std::make_pair(iter, true);
+    }
+
+    /**
+    * @brief Returns the value for an entity id, inserting it if necessary
+    */
+    Value&
+    operator[] (
+        EntityId entityId
+    ) {
+        return this->insert(std::make_pair(entityId, Value())).first->second;
+    }
+
+    /**
+    * @brief Reserves space for \a capacity entries
+    */
+    void
+    reserve(
+        size_t capacity
+    ) {
+        m_items.reserve(capacity);
+    }
+
+    /**
+    * @brief The number of entries
+    */
+    size_t
+    size() const {
+        return m_items.size();
+    }
+
+private:
+
+    iterator
+    lowerBound(
+        EntityId entityId
+    ) {
+        // Entity ids are mostly handed out in ascending order, so new
+        // entries usually belong at the end
+        if (m_items.empty() or m_items.back().first < entityId) {
+            return m_items.end();
+        }
+        return std::lower_bound(
+            m_items.begin(),
+            m_items.end(),
+            entityId,
+            [](const value_type& item, EntityId id) {
+                return item.first < id;
+            }
+        );
+    }
+
+    Container m_items;
+
+};
+
+}
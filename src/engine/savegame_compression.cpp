@@ -0,0 +1,400 @@
+#include "engine/savegame_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+
+const uint32_t SavegameCompression::DEFAULT_CHUNK_SIZE;
+
+const char SavegameCompression::MAGIC[4] = {'T', 'H', 'R', 'Z'};
+
+namespace {
+
+const uint16_t FRAME_VERSION = 1;
+
+// Protects against absurd allocations from corrupt headers
+const uint32_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+enum class Method : uint8_t {
+    Stored = 0,
+    Lz = 1
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// LZ block format
+//
+// A block is a series of sequences. Each sequence starts with a token whose
+// high nibble is the literal count and whose low nibble is the match length
+// minus MIN_MATCH. A nibble of 15 is continued by bytes that are added until
+// one is below 255. The literals follow, then the match's 16 bit offset
+// backwards into the output and the match length continuation. The last
+// sequence has literals only.
+////////////////////////////////////////////////////////////////////////////////
+
+const size_t MIN_MATCH = 4;
+
+// The last bytes of a block are always literals
+const size_t LAST_LITERALS = 5;
+
+// Matches may only start this far away from the end
+const size_t MATCH_START_LIMIT = 12;
+
+const size_t MAX_OFFSET = 65535;
+
+const unsigned int HASH_BITS = 14;
+
+uint32_t
+read32(
+    const char* data
+) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+
+uint32_t
+hashSequence(
+    uint32_t sequence
+) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+
+void
+writeLength(
+    std::string& output,
+    size_t length
+) {
+    while (length >= 255) {
+        output.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    output.push_back(static_cast<char>(length));
+}
+
+
+void
+writeSequence(
+    std::string& output,
+    const char* literals,
+    size_t literalCount,
+    size_t offset,
+    size_t matchLength
+) {
+    size_t matchCode = matchLength > 0 ? matchLength - MIN_MATCH : 0;
+    output.push_back(static_cast<char>(
+        (std::min<size_t>(literalCount, 15) << 4) |
+        std::min<size_t>(matchCode, 15)
+    ));
+    if (literalCount >= 15) {
+        writeLength(output, literalCount - 15);
+    }
+    output.append(literals, literalCount);
+    if (matchLength == 0) {
+        return;
+    }
+    output.push_back(static_cast<char>(offset & 0xFF));
+    output.push_back(static_cast<char>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(output, matchCode - 15);
+    }
+}
+
+
+void
+compressBlock(
+    const char* input,
+    size_t size,
+    std::string& output
+) {
+    size_t anchor = 0;
+    if (size >= MATCH_START_LIMIT) {
+        std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+        size_t matchLimit = size - LAST_LITERALS;
+        size_t position = 0;
+        // Skip faster through data that doesn't compress
+        size_t misses = 0;
+        while (position + MATCH_START_LIMIT <= size) {
+            uint32_t sequence = read32(input + position);
+            uint32_t& entry = table[hashSequence(sequence)];
+            size_t candidate = entry;
+            entry = static_cast<uint32_t>(position);
+            if (
+                candidate < position and
+                position - candidate <= MAX_OFFSET and
+                read32(input + candidate) == sequence
+            ) {
+                size_t length = MIN_MATCH;
+                while (
+                    position + length < matchLimit and
+                    input[candidate + length] == input[position + length]
+                ) {
+                    ++length;
+                }
+                writeSequence(
+                    output,
+                    input + anchor,
+                    position - anchor,
+                    position - candidate,
+                    length
+                );
+                position += length;
+                anchor = position;
+                misses = 0;
+            }
+            else {
+                misses += 1;
+                position += 1 + (misses >> 6);
+            }
+        }
+    }
+    writeSequence(output, input + anchor, size - anchor, 0, 0);
+}
+
+
+void
+decompressBlock(
+    const char* input,
+    size_t size,
+    size_t expectedSize,
+    std::string& output
+) {
+    const char* end = input + size;
+    size_t start = output.size();
+    auto readByte = [&input, end]() -> uint8_t {
+        if (input == end) {
+            throw std::runtime_error("Truncated compressed savegame chunk");
+        }
+        return static_cast<uint8_t>(*input++);
+    };
+    auto readLength = [&readByte](size_t length) {
+        if (length == 15) {
+            uint8_t byte;
+            do {
+                byte = readByte();
+                length += byte;
+            } while (byte == 255);
+        }
+        return length;
+    };
+    while (true) {
+        uint8_t token = readByte();
+        size_t literalCount = readLength(token >> 4);
+        if (
+            literalCount > static_cast<size_t>(end - input) or
+            output.size() - start + literalCount > expectedSize
+        ) {
+            throw std::runtime_error("Corrupt compressed savegame chunk");
+        }
+        output.append(input, literalCount);
+        input += literalCount;
+        if (input == end) {
+            break;
+        }
+        size_t offset = readByte();
+        offset |= static_cast<size_t>(readByte()) << 8;
+        size_t matchLength = readLength(token & 0x0F) + MIN_MATCH;
+        if (
+            offset == 0 or
+            offset > output.size() - start or
+            output.size() - start + matchLength > expectedSize
+        ) {
+            throw std::runtime_error("Corrupt compressed savegame chunk");
+        }
+        // Copied byte by byte, the match may overlap its own output
+        size_t from = output.size() - offset;
+        for (size_t i = 0; i < matchLength; ++i) {
+            output.push_back(output[from + i]);
+        }
+    }
+    if (output.size() - start != expectedSize) {
+        throw std::runtime_error("Corrupt compressed savegame chunk");
+    }
+}
+
+
+template<typename T>
+void
+writeRaw(
+    std::string& output,
+    T value
+) {
+    output.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+
+/**
+* @brief Decodes a frame after its magic bytes
+*
+* @param read
+*   Callable that fills a buffer of the given size or throws
+*/
+template<typename Read>
+std::string
+decompressFrame(
+    Read read
+) {
+    auto readRaw = [&read](auto& value) {
+        read(reinterpret_cast<char*>(&value), sizeof(value));
+    };
+    uint16_t version;
+    readRaw(version);
+    if (version != FRAME_VERSION) {
+        throw std::runtime_error(
+            "Unsupported compressed savegame version " + std::to_string(version)
+        );
+    }
+    uint32_t chunkSize;
+    uint64_t totalSize;
+    readRaw(chunkSize);
+    readRaw(totalSize);
+    if (chunkSize == 0 or chunkSize > MAX_CHUNK_SIZE) {
+        throw std::runtime_error("Corrupt compressed savegame header");
+    }
+    std::string output;
+    std::vector<char> stored;
+    while (output.size() < totalSize) {
+        size_t expectedSize = static_cast<size_t>(
+            std::min<uint64_t>(chunkSize, totalSize - output.size())
+        );
+        Method method;
+        uint32_t storedSize;
+        uint32_t crc;
+        readRaw(method);
+        readRaw(storedSize);
+        readRaw(crc);
+        // Chunks that don't shrink are stored
+        if (storedSize > expectedSize) {
+            throw std::runtime_error("Corrupt compressed savegame chunk");
+        }
+        stored.resize(storedSize);
+        read(stored.data(), storedSize);
+        size_t start = output.size();
+        switch (method) {
+            case Method::Stored:
+                if (storedSize != expectedSize) {
+                    throw std::runtime_error("Corrupt compressed savegame chunk");
+                }
+                output.append(stored.data(), storedSize);
+                break;
+            case Method::Lz:
+                decompressBlock(stored.data(), storedSize, expectedSize, output);
+                break;
+            default:
+                throw std::runtime_error("Unknown compression method in savegame");
+        }
+        if (SavegameCompression::crc32(output.data() + start, expectedSize) != crc) {
+            throw std::runtime_error("Checksum mismatch in compressed savegame");
+        }
+    }
+    return output;
+}
+
+} // namespace
+
+
+std::string
+SavegameCompression::compress(
+    const std::string& data,
+    uint32_t chunkSize
+) {
+    if (chunkSize == 0 or chunkSize > MAX_CHUNK_SIZE) {
+        throw std::invalid_argument("Invalid savegame chunk size");
+    }
+    std::string output(MAGIC, sizeof(MAGIC));
+    writeRaw(output, FRAME_VERSION);
+    writeRaw(output, chunkSize);
+    writeRaw<uint64_t>(output, data.size());
+    std::string block;
+    for (size_t offset = 0; offset < data.size(); offset += chunkSize) {
+        size_t size = std::min<size_t>(chunkSize, data.size() - offset);
+        const char* chunk = data.data() + offset;
+        block.clear();
+        compressBlock(chunk, size, block);
+        Method method = Method::Lz;
+        if (block.size() >= size) {
+            method = Method::Stored;
+            block.assign(chunk, size);
+        }
+        writeRaw(output, method);
+        writeRaw<uint32_t>(output, block.size());
+        writeRaw(output, crc32(chunk, size));
+        output.append(block);
+    }
+    return output;
+}
+
+
+uint32_t
+SavegameCompression::crc32(
+    const char* data,
+    size_t size
+) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table;
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+            }
+            table[i] = value;
+        }
+        return table;
+    }();
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+
+std::string
+SavegameCompression::decompress(
+    const char* data,
+    size_t size
+) {
+    if (not isCompressed(data, size)) {
+        throw std::runtime_error("Not a compressed savegame");
+    }
+    const char* position = data + sizeof(MAGIC);
+    const char* end = data + size;
+    return decompressFrame([&position, end](char* buffer, size_t count) {
+        if (count > static_cast<size_t>(end - position)) {
+            throw std::runtime_error("Truncated compressed savegame");
+        }
+        std::memcpy(buffer, position, count);
+        position += count;
+    });
+}
+
+
+std::string
+SavegameCompression::decompressAfterMagic(
+    std::istream& stream
+) {
+    return decompressFrame([&stream](char* buffer, size_t count) {
+        stream.read(buffer, count);
+        if (stream.fail()) {
+            throw std::runtime_error("Truncated compressed savegame");
+        }
+    });
+}
+
+
+bool
+SavegameCompression::isCompressed(
+    const char* data,
+    size_t size
+) {
+    return (
+        size >= sizeof(MAGIC) and
+        std::equal(MAGIC, MAGIC + sizeof(MAGIC), data)
+    );
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace thrive {
+
+/**
+* @brief Compressed, checksummed frame around encoded savegames
+*
+* Layout:
+* - Magic bytes, frame version, chunk size and the uncompressed size
+* - Chunks of at most chunk size uncompressed bytes, each made of the
+*   compression method, its stored size, the CRC-32 of its uncompressed
+*   bytes and the stored bytes
+*
+* Chunks are compressed with an LZ77 block format modeled after LZ4. A
+* chunk that doesn't shrink is stored as is.
+*
+* Decompression verifies every chunk, so corrupt files are rejected before
+* anything is restored from them.
+*/
+class SavegameCompression {
+
+public:
+
+    /**
+    * @brief Default uncompressed size of a chunk
+    */
+    static const uint32_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+    /**
+    * @brief Starts every compressed savegame
+    */
+    static const char MAGIC[4];
+
+    /**
+    * @brief Compresses data into a frame
+    *
+    * @param data
+    *   The data to compress
+    * @param chunkSize
+    *   The uncompressed size of a chunk
+    *
+    * @return
+    *   The complete frame
+    */
+    static std::string
+    compress(
+        const std::string& data,
+        uint32_t chunkSize = DEFAULT_CHUNK_SIZE
+    );
+
+    /**
+    * @brief CRC-32 as used by zlib
+    */
+    static uint32_t
+    crc32(
+        const char* data,
+        size_t size
+    );
+
+    /**
+    * @brief Decompresses a frame in memory
+    *
+    * @throws std::runtime_error if the frame is truncated or corrupt
+    */
+    static std::string
+    decompress(
+        const char* data,
+        size_t size
+    );
+
+    /**
+    * @brief Decompresses a frame from a stream whose magic bytes have
+    * already been read
+    *
+    * Reads exactly up to the end of the frame.
+    *
+    * @throws std::runtime_error if the frame is truncated or corrupt
+    */
+    static std::string
+    decompressAfterMagic(
+        std::istream& stream
+    );
+
+    /**
+    * @brief Whether \a data starts with a frame's magic bytes
+    */
+    static bool
+    isCompressed(
+        const char* data,
+        size_t size
+    );
+
+};
+
+}
@@ -0,0 +1,225 @@
+#include "engine/savegame_writer.h"
+
+#include "engine/savegame_compression.h"
+#include "engine/serialization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace thrive;
+
+namespace {
+
+// Size of the pieces the encoded savegame is written in, for progress
+// reporting
+const size_t WRITE_CHUNK_SIZE = 1 << 20;
+
+struct Job {
+
+    std::string filename;
+
+    StorageContainer savegame;
+
+};
+
+/**
+* @brief Flushes a file all the way to the disk
+*/
+bool
+syncFile(
+    std::FILE* file
+) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+
+struct SavegameWriter::Implementation {
+
+    void
+    run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_wakeUp.wait(lock, [this] {
+                return m_quit or not m_jobs.empty();
+            });
+            if (m_jobs.empty()) {
+                // m_quit is set, and everything is written
+                return;
+            }
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_writing = true;
+            m_progress = 0.0f;
+            lock.unlock();
+            Result result = this->writeFile(job);
+            lock.lock();
+            m_results.push_back(std::move(result));
+            m_writing = false;
+            m_progress = 1.0f;
+            m_idle.notify_all();
+        }
+    }
+
+    Result
+    writeFile(
+        const Job& job
+    ) {
+        Result result;
+        result.filename = job.filename;
+        result.succeeded = false;
+        std::string data;
+        try {
+            std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+            stream << job.savegame;
+            data = stream.str();
+            if (m_compress) {
+                data = SavegameCompression::compress(data);
+            }
+        }
+        catch (const std::exception& e) {
+            result.error = std::string("Could not encode savegame: ") + e.what();
+            return result;
+        }
+        std::string temporaryFile = job.filename + ".tmp";
+        std::FILE* file = std::fopen(temporaryFile.c_str(), "wb");
+        if (not file) {
+            result.error = "Could not open " + temporaryFile + " for writing";
+            return result;
+        }
+        bool written = true;
+        for (size_t offset = 0; offset < data.size(); offset += WRITE_CHUNK_SIZE) {
+            size_t size = std::min(WRITE_CHUNK_SIZE, data.size() - offset);
+            if (std::fwrite(data.data() + offset, 1, size, file) != size) {
+                written = false;
+                break;
+            }
+            m_progress = float(offset + size) / data.size();
+        }
+        written = syncFile(file) and written;
+        written = std::fclose(file) == 0 and written;
+        if (not written) {
+            result.error = "Could not write " + temporaryFile;
+            std::remove(temporaryFile.c_str());
+            return result;
+        }
+        boost::system::error_code error;
+        boost::filesystem::rename(temporaryFile, job.filename, error);
+        if (error) {
+            result.error = "Could not replace " + job.filename + ": " + error.message();
+            return result;
+        }
+        result.succeeded = true;
+        return result;
+    }
+
+    bool m_compress = true;
+
+    std::condition_variable m_idle;
+
+    std::deque<Job> m_jobs;
+
+    mutable std::mutex m_mutex;
+
+    std::atomic<float> m_progress {1.0f};
+
+    bool m_quit = false;
+
+    std::vector<Result> m_results;
+
+    std::thread m_thread;
+
+    std::condition_variable m_wakeUp;
+
+    // Whether a job has been taken from m_jobs but isn't finished yet
+    bool m_writing = false;
+
+};
+
+
+SavegameWriter::SavegameWriter(
+    bool compress
+) : m_impl(new Implementation())
+{
+    m_impl->m_compress = compress;
+    m_impl->m_thread = std::thread(&Implementation::run, m_impl.get());
+}
+
+
+SavegameWriter::~SavegameWriter() {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_quit = true;
+    }
+    m_impl->m_wakeUp.notify_all();
+    m_impl->m_thread.join();
+}
+
+
+bool
+SavegameWriter::busy() const {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    return m_impl->m_writing or not m_impl->m_jobs.empty();
+}
+
+
+float
+SavegameWriter::progress() const {
+    return m_impl->m_progress;
+}
+
+
+std::vector<SavegameWriter::Result>
+SavegameWriter::takeResults() {
+    std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+    std::vector<Result> results;
+    results.swap(m_impl->m_results);
+    return results;
+}
+
+
+void
+SavegameWriter::wait() {
+    std::unique_lock<std::mutex> lock(m_impl->m_mutex);
+    m_impl->m_idle.wait(lock, [this] {
+        return not m_impl->m_writing and m_impl->m_jobs.empty();
+    });
+}
+
+
+void
+SavegameWriter::write(
+    std::string filename,
+    StorageContainer savegame
+) {
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_mutex);
+        m_impl->m_jobs.push_back(Job{
+            std::move(filename),
+            std::move(savegame)
+        });
+    }
+    m_impl->m_wakeUp.notify_one();
+}
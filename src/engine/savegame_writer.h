@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace thrive {
+
+class StorageContainer;
+
+/**
+* @brief Encodes and writes savegames on a background thread
+*
+* The main thread only collects the savegame into a StorageContainer and
+* hands it over. The writer owns that snapshot from then on, so the game
+* can keep running while it is encoded and written.
+*
+* Savegames are compressed by default. Files are written to a temporary
+* file first, flushed to disk and then renamed, so a crash during saving
+* never destroys the previous savegame.
+*
+* Savegames are written in the order they were submitted.
+*/
+class SavegameWriter {
+
+public:
+
+    /**
+    * @brief Outcome of a finished write
+    */
+    struct Result {
+
+        /**
+        * @brief Error description if the write failed
+        */
+        std::string error;
+
+        /**
+        * @brief The written file
+        */
+        std::string filename;
+
+        /**
+        * @brief Whether the file was written completely
+        */
+        bool succeeded;
+
+    };
+
+    /**
+    * @brief Constructor
+    *
+    * Starts the background thread.
+    *
+    * @param compress
+    *   Whether to write savegames in a compressed frame, see
+    *   SavegameCompression
+    */
+    explicit SavegameWriter(
+        bool compress = true
+    );
+
+    /**
+    * @brief Destructor
+    *
+    * Finishes all submitted savegames before returning.
+    */
+    ~SavegameWriter();
+
+    /**
+    * @brief Whether any savegame is still waiting or being written
+    */
+    bool
+    busy() const;
+
+    /**
+    * @brief Progress of the savegame currently being written
+    *
+    * @return
+    *   A value between 0 and 1. 1 if nothing is being written.
+    */
+    float
+    progress() const;
+
+    /**
+    * @brief Returns the results of all writes finished since the last call
+    */
+    std::vector<Result>
+    takeResults();
+
+    /**
+    * @brief Blocks until all submitted savegames are written
+    */
+    void
+    wait();
+
+    /**
+    * @brief Submits a savegame for writing
+    *
+    * @param filename
+    *   The file to write. An existing file is replaced once the new one is
+    *   complete.
+    * @param savegame
+    *   The savegame. Taken over by the writer.
+    */
+    void
+    write(
+        std::string filename,
+        StorageContainer savegame
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
@@ -1,10 +1,27 @@
 #include "engine/serialization.h"
 
+#include "engine/savegame_compression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/container/small_vector.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/variant.hpp>
 #include <cfloat>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace thrive;
 
@@ -36,6 +53,361 @@ struct StoredValue {
     Variant value;
 };
 
+/**
+* @brief An interned key
+*
+* Interned keys live until the program exits. Keys of the same name are
+* usually the same pointer, except for keys read from a file before they
+* were interned (see FileKeys), so compare them with keyEquals().
+*/
+using Key = const std::string*;
+
+/**
+* @brief Whether two keys have the same name
+*/
+bool
+keyEquals(
+    Key lhs,
+    Key rhs
+) {
+    return lhs == rhs or *lhs == *rhs;
+}
+
+/**
+* @brief Orders keys by name
+*
+* Addresses change from run to run, so containers are sorted by name. That
+* way keys() and the encoded bytes only depend on the content.
+*/
+bool
+keyLess(
+    Key lhs,
+    Key rhs
+) {
+    return lhs != rhs and *lhs < *rhs;
+}
+
+/**
+* @brief Interns keys for all containers
+*
+* Only StorageContainer::set() interns keys. Keys read from files are only
+* looked up, see FileKeys, so that corrupt files can't grow the table. The
+* keys of Lua components aren't a fixed vocabulary (compound names, list
+* indices), so the table grows with whatever the game stores.
+*
+* Each thread caches the keys it has looked up, so that lookups of known
+* keys don't contend for the lock.
+*/
+class KeyTable {
+
+public:
+
+    /**
+    * @brief Looks up a key without interning it
+    *
+    * @return
+    *   The interned key or \c nullptr if \a name was never interned
+    */
+    static Key
+    find(
+        const std::string& name
+    ) {
+        auto& cache = KeyTable::cache();
+        auto iter = cache.find(name);
+        if (iter != cache.end()) {
+            return iter->second;
+        }
+        KeyTable& table = KeyTable::instance();
+        Key key = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(table.m_mutex);
+            auto nameIter = table.m_names.find(name);
+            if (nameIter == table.m_names.end()) {
+                // Not cached, the key may be interned later
+                return nullptr;
+            }
+            key = &*nameIter;
+        }
+        cache.emplace(name, key);
+        return key;
+    }
+
+    /**
+    * @brief Interns a key
+    */
+    static Key
+    intern(
+        const std::string& name
+    ) {
+        Key key = KeyTable::find(name);
+        if (key) {
+            return key;
+        }
+        KeyTable& table = KeyTable::instance();
+        {
+            std::lock_guard<std::mutex> lock(table.m_mutex);
+            key = &*table.m_names.insert(name).first;
+        }
+        KeyTable::cache().emplace(name, key);
+        return key;
+    }
+
+private:
+
+    static std::unordered_map<std::string, Key>&
+    cache() {
+        static thread_local std::unordered_map<std::string, Key> cache;
+        return cache;
+    }
+
+    static KeyTable&
+    instance() {
+        static KeyTable table;
+        return table;
+    }
+
+    std::mutex m_mutex;
+
+    // Node based, so interned keys never move
+    std::unordered_set<std::string> m_names;
+
+};
+
+/**
+* @brief Keys of a file that weren't interned when it was read
+*
+* Node based, so keys never move. Shared by the containers read from the
+* file.
+*/
+using LocalKeys = std::unordered_set<std::string>;
+
+/**
+* @brief Resolves the keys of one file
+*
+* Known keys resolve to their interned key. Unknown ones are kept in the
+* file's LocalKeys instead of being interned. A name always resolves to the
+* same key within one file, even if another thread interns it meanwhile.
+*/
+class FileKeys {
+
+public:
+
+    /**
+    * @brief Looks up a key without adding it
+    *
+    * @return
+    *   The key or \c nullptr if neither the file nor the KeyTable has it
+    */
+    Key
+    find(
+        const std::string& name
+    ) const {
+        if (m_localKeys) {
+            auto iter = m_localKeys->find(name);
+            if (iter != m_localKeys->end()) {
+                return &*iter;
+            }
+        }
+        return KeyTable::find(name);
+    }
+
+    /**
+    * @brief Looks up a key, adding it to the local keys if it's unknown
+    */
+    Key
+    resolve(
+        const std::string& name
+    ) {
+        Key key = this->find(name);
+        if (key) {
+            return key;
+        }
+        if (not m_localKeys) {
+            m_localKeys = std::make_shared<LocalKeys>();
+        }
+        return &*m_localKeys->insert(name).first;
+    }
+
+    /**
+    * @brief The keys that weren't interned, \c nullptr if there are none
+    */
+    std::shared_ptr<const LocalKeys>
+    localKeys() const {
+        return m_localKeys;
+    }
+
+    /**
+    * @brief Keys by their index in the key table of the binary format
+    */
+    std::vector<Key> indexed;
+
+private:
+
+    std::shared_ptr<LocalKeys> m_localKeys;
+
+};
+
+/**
+* @brief A container's entries, as a flat array sorted by key name
+*
+* Most containers only hold a few entries (vectors, component members), so
+* those are stored inline without allocating.
+*/
+class Content {
+
+public:
+
+    using Entry = std::pair<Key, StoredValue>;
+
+    using Entries = boost::container::small_vector<Entry, 4>;
+
+    Entries::const_iterator
+    begin() const {
+        return m_entries.begin();
+    }
+
+    void
+    clear() {
+        m_entries.clear();
+        m_localKeys.reset();
+    }
+
+    bool
+    empty() const {
+        return m_entries.empty();
+    }
+
+    Entries::const_iterator
+    end() const {
+        return m_entries.end();
+    }
+
+    const StoredValue*
+    find(
+        const std::string& name
+    ) const {
+        auto iter = std::lower_bound(
+            m_entries.begin(),
+            m_entries.end(),
+            name,
+            [](const Entry& entry, const std::string& name) {
+                return *entry.first < name;
+            }
+        );
+        if (iter == m_entries.end() or *iter->first != name) {
+            return nullptr;
+        }
+        return &iter->second;
+    }
+
+    /**
+    * @brief Adds entries in any order
+    *
+    * Call finishInsertion() before accessing the content again.
+    */
+    void
+    insertUnsorted(
+        Key key,
+        StoredValue value
+    ) {
+        m_entries.emplace_back(key, std::move(value));
+    }
+
+    /**
+    * @brief Sorts entries added with insertUnsorted()
+    *
+    * Of duplicate keys, the last one added wins.
+    */
+    void
+    finishInsertion() {
+        std::stable_sort(
+            m_entries.begin(),
+            m_entries.end(),
+            [](const Entry& lhs, const Entry& rhs) {
+                return keyLess(lhs.first, rhs.first);
+            }
+        );
+        // Keep the last of each run of equal keys
+        auto out = m_entries.begin();
+        for (auto iter = m_entries.begin(); iter != m_entries.end(); ++iter) {
+            auto next = iter + 1;
+            if (next != m_entries.end() and keyEquals(next->first, iter->first)) {
+                continue;
+            }
+            if (out != iter) {
+                *out = std::move(*iter);
+            }
+            ++out;
+        }
+        m_entries.erase(out, m_entries.end());
+    }
+
+    void
+    reserve(
+        size_t size
+    ) {
+        m_entries.reserve(size);
+    }
+
+    /**
+    * @brief Keeps the local keys of the file the entries were read from
+    */
+    void
+    setLocalKeys(
+        std::shared_ptr<const LocalKeys> localKeys
+    ) {
+        m_localKeys = std::move(localKeys);
+    }
+
+    /**
+    * @brief Sets an entry
+    *
+    * @param key
+    *   An interned key
+    */
+    void
+    set(
+        Key key,
+        StoredValue value
+    ) {
+        auto iter = this->lowerBound(key);
+        if (iter != m_entries.end() and keyEquals(iter->first, key)) {
+            // The entry may have been read before its key was interned
+            iter->first = key;
+            iter->second = std::move(value);
+        }
+        else {
+            m_entries.emplace(iter, key, std::move(value));
+        }
+    }
+
+    size_t
+    size() const {
+        return m_entries.size();
+    }
+
+private:
+
+    Entries::iterator
+    lowerBound(
+        Key key
+    ) {
+        return std::lower_bound(
+            m_entries.begin(),
+            m_entries.end(),
+            key,
+            [](const Entry& entry, Key key) {
+                return keyLess(entry.first, key);
+            }
+        );
+    }
+
+    Entries m_entries;
+
+    std::shared_ptr<const LocalKeys> m_localKeys;
+
+};
+
 /**
 * @brief Information about a storable type
 *
@@ -82,7 +454,7 @@ struct TypeInfo {
     */
     static StoredType
     convertToStoredType (
-        const Type& value
+        Type value
     ) {
         return value;
     }
@@ -107,7 +479,7 @@ struct IdToType {
         \
         static StoredType \
         convertToStoredType( \
-            const type& value \
+            type value \
         ); \
         \
     }; \
@@ -190,29 +562,8 @@ struct StorageContainer::Implementation {
     rawContains(
         const std::string& key
     ) const {
-        auto iter = m_content.find(key);
-        return (
-            iter != m_content.end() and
-            iter->second.typeId == TypeInfo<T>::Id
-        );
-    }
-
-    template<typename T>
-    typename TypeInfo<T>::StoredType
-    rawGet(
-        const std::string& key,
-        const typename TypeInfo<T>::StoredType& defaultValue = typename TypeInfo<T>::StoredType()
-    ) const {
-        auto iter = m_content.find(key);
-        if (iter == m_content.end()) {
-            return defaultValue;
-        }
-        else if (iter->second.typeId != TypeInfo<T>::Id){
-            return defaultValue;
-        }
-        else {
-            return boost::get<typename TypeInfo<T>::StoredType>(iter->second.value);
-        }
+        const StoredValue* value = m_content.find(key);
+        return value and value->typeId == TypeInfo<T>::Id;
     }
 
     template<typename T>
@@ -221,13 +572,16 @@ struct StorageContainer::Implementation {
         const std::string& key,
         typename TypeInfo<T>::StoredType value
     ) {
-        m_content[key] = StoredValue{
-            TypeInfo<T>::Id, 
-            std::move(value)
-        };
+        m_content.set(
+            KeyTable::intern(key),
+            StoredValue{
+                TypeInfo<T>::Id,
+                std::move(value)
+            }
+        );
     }
 
-    std::unordered_map<std::string, StoredValue> m_content;
+    Content m_content;
 
 };
 
@@ -247,11 +601,13 @@ struct StorageContainer::Implementation {
         const std::string& key, \
         const type& defaultValue \
     ) const { \
-        if (not this->contains<type>(key)) { \
+        const StoredValue* storedValue = m_impl->m_content.find(key); \
+        if (not storedValue or storedValue->typeId != TypeInfo<type>::Id) { \
             return defaultValue; \
         } \
-        auto storedValue = m_impl->rawGet<type>(key); \
-        return TypeInfo<type>::convertFromStoredType(storedValue); \
+        return TypeInfo<type>::convertFromStoredType( \
+            boost::get<TypeInfo<type>::StoredType>(storedValue->value) \
+        ); \
     } \
     \
     template <> \
@@ -260,8 +616,11 @@ struct StorageContainer::Implementation {
         const std::string& key, \
         type value \
     ) { \
-        auto storedValue = TypeInfo<type>::convertToStoredType(value); \
-        m_impl->rawSet<type>(key, std::move(storedValue)); \
+        this->detach(); \
+        m_impl->rawSet<type>( \
+            key, \
+            TypeInfo<type>::convertToStoredType(std::move(value)) \
+        ); \
     }
 
 GET_SET_CONTAINS(bool)
@@ -328,17 +687,30 @@ void StorageContainer::luaBindings(
     );
 }
 
+namespace {
+
+std::atomic<size_t> g_contentCopies {0};
+
+}
+
+
+std::shared_ptr<StorageContainer::Implementation>
+StorageContainer::emptyImplementation() {
+    static const auto empty = std::make_shared<Implementation>();
+    return empty;
+}
+
+
 StorageContainer::StorageContainer()
-  : m_impl(new Implementation())
+  : m_impl(emptyImplementation())
 {
 }
 
 
 StorageContainer::StorageContainer(
     const StorageContainer& other
-) : m_impl(new Implementation())
+) : m_impl(other.m_impl)
 {
-    *this = other;
 }
 
 
@@ -346,6 +718,7 @@ StorageContainer::StorageContainer(
     StorageContainer&& other
 ) : m_impl(std::move(other.m_impl))
 {
+    other.m_impl = emptyImplementation();
 }
 
 
@@ -356,9 +729,7 @@ StorageContainer&
 StorageContainer::operator = (
     const StorageContainer& other
 ) {
-    if (this != &other) {
-        m_impl->m_content = other.m_impl->m_content;
-    }
+    m_impl = other.m_impl;
     return *this;
 }
 
@@ -369,15 +740,88 @@ StorageContainer::operator = (
 ) {
     assert(this != &other);
     m_impl = std::move(other.m_impl);
+    other.m_impl = emptyImplementation();
     return *this;
 }
 
 
+namespace {
+
+struct ValueHasher : public boost::static_visitor<size_t> {
+
+    template<typename T>
+    size_t
+    operator () (
+        const T& value
+    ) const {
+        return boost::hash<T>()(value);
+    }
+
+    size_t
+    operator () (
+        const StorageContainer& storage
+    ) const {
+        return storage.contentHash();
+    }
+
+    size_t
+    operator () (
+        const StorageList& list
+    ) const {
+        size_t seed = list.size();
+        for (const StorageContainer& element : list) {
+            boost::hash_combine(seed, element.contentHash());
+        }
+        return seed;
+    }
+
+};
+
+} // namespace
+
+
+size_t
+StorageContainer::contentCopies() {
+    return g_contentCopies;
+}
+
+
+size_t
+StorageContainer::contentHash() const {
+    // Entries are ordered by key address, so their hashes are summed up
+    size_t hash = m_impl->m_content.size();
+    for (const auto& pair : m_impl->m_content) {
+        size_t entryHash = boost::hash<std::string>()(*pair.first);
+        boost::hash_combine(entryHash, pair.second.typeId);
+        boost::hash_combine(
+            entryHash,
+            boost::apply_visitor(ValueHasher(), pair.second.value)
+        );
+        hash += entryHash;
+    }
+    return hash;
+}
+
+
+void
+StorageContainer::detach() {
+    if (m_impl.use_count() == 1) {
+        return;
+    }
+    auto impl = std::make_shared<Implementation>();
+    if (not m_impl->m_content.empty()) {
+        impl->m_content = m_impl->m_content;
+        g_contentCopies += 1;
+    }
+    m_impl = std::move(impl);
+}
+
+
 bool
 StorageContainer::contains(
     const std::string& key
 ) const {
-    return m_impl->m_content.find(key) != m_impl->m_content.cend();
+    return m_impl->m_content.find(key) != nullptr;
 }
 
 
@@ -387,13 +831,13 @@ StorageContainer::luaGet(
     sol::object defaultValue,
     sol::this_state s
 ) const {
-    auto iter = m_impl->m_content.find(key);
-    if (iter == m_impl->m_content.end()) {
+    const StoredValue* value = m_impl->m_content.find(key);
+    if (not value) {
         return defaultValue;
     }
     else {
         sol::state_view lua(s);
-        sol::object obj = toLua(lua, iter->second);
+        sol::object obj = toLua(lua, *value);
         if (obj.valid()) {
             return obj;
         }
@@ -408,7 +852,7 @@ std::list<std::string>
 StorageContainer::keys() const {
     std::list<std::string> keys;
     for (const auto& pair : m_impl->m_content) {
-        keys.push_back(pair.first);
+        keys.push_back(*pair.first);
     }
     return keys;
 }
@@ -424,7 +868,7 @@ StorageContainer::keys() const {
     \
     typeName \
     TypeInfo<typeName>::convertToStoredType( \
-        const typeName& value \
+        typeName value \
     ) { \
         return value; \
     }
@@ -460,7 +904,7 @@ TypeInfo<Ogre::Degree>::convertFromStoredType(
 
 float
 TypeInfo<Ogre::Degree>::convertToStoredType(
-    const Ogre::Degree& value
+    Ogre::Degree value
 ) {
     return value.valueDegrees();
 }
@@ -483,7 +927,7 @@ TypeInfo<Ogre::Plane>::convertFromStoredType(
 
 StorageContainer
 TypeInfo<Ogre::Plane>::convertToStoredType(
-    const Ogre::Plane& value
+    Ogre::Plane value
 ) {
     StorageContainer storage;
     storage.set<Ogre::Vector3>("normal", value.normal);
@@ -512,7 +956,7 @@ TypeInfo<Ogre::Vector3>::convertFromStoredType(
 
 StorageContainer
 TypeInfo<Ogre::Vector3>::convertToStoredType(
-    const Ogre::Vector3& value
+    Ogre::Vector3 value
 ) {
     StorageContainer storage;
     storage.set<Ogre::Real>("x", value.x);
@@ -543,7 +987,7 @@ TypeInfo<Ogre::Quaternion>::convertFromStoredType(
 
 StorageContainer
 TypeInfo<Ogre::Quaternion>::convertToStoredType(
-    const Ogre::Quaternion& value
+    Ogre::Quaternion value
 ) {
     StorageContainer storage;
     storage.set<Ogre::Real>("w", value.w);
@@ -571,7 +1015,7 @@ TypeInfo<Ogre::ColourValue>::convertFromStoredType(
 
 uint32_t
 TypeInfo<Ogre::ColourValue>::convertToStoredType(
-    const Ogre::ColourValue& value
+    Ogre::ColourValue value
 ) {
     return value.getAsRGBA();
 }
@@ -607,7 +1051,7 @@ StorageList::StorageList(
 
 StorageList::StorageList(
     StorageList&& other
-) : std::vector<StorageContainer>(other)
+) : std::vector<StorageContainer>(std::move(other))
 {
 }
 
@@ -625,7 +1069,7 @@ StorageList&
 StorageList::operator = (
     StorageList&& other
 ) {
-    std::vector<StorageContainer>::operator=(other);
+    std::vector<StorageContainer>::operator=(std::move(other));
     return *this;
 }
 
@@ -651,330 +1095,844 @@ StorageList::get(
 // Serialization
 ////////////////////////////////////////////////////////////////////////////////
 
-namespace {
-
-template<typename T>
-struct TypeHandler {
-
-    static T
-    deserialize(
-        std::istream& stream
-    );
-
-    static void
-    serialize(
-        std::ostream& stream,
-        const T& value
-    );
-
-};
-
+namespace thrive {
 
-////////////////////////////////////////////////////////////////////////////////
-// Integrals
-////////////////////////////////////////////////////////////////////////////////
+/**
+* @brief Gives the serialization code access to a container's content
+*/
+class StorageSerializer {
 
-template<typename T>
-struct IntegralTypeHandler {
+public:
 
-    static T
-    deserialize(
-        std::istream& stream
+    static const Content&
+    content(
+        const StorageContainer& storage
     ) {
-        T value = 0;
-        stream.read(
-            reinterpret_cast<char*>(&value),
-            sizeof(T)
-        );
-        assert(not stream.fail());
-        return value;
+        return storage.m_impl->m_content;
     }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        T value
+    static Content&
+    content(
+        StorageContainer& storage
     ) {
-        stream.write(
-            reinterpret_cast<char*>(&value), 
-            sizeof(T)
-        );
+        storage.detach();
+        return storage.m_impl->m_content;
     }
+
 };
 
-#define INTEGRAL_TYPE_HANDLER(typeName) \
-    template<> struct TypeHandler<typeName> : public IntegralTypeHandler<typeName> {};
+}
 
-INTEGRAL_TYPE_HANDLER(int8_t)
-INTEGRAL_TYPE_HANDLER(int16_t)
-INTEGRAL_TYPE_HANDLER(int32_t)
-INTEGRAL_TYPE_HANDLER(int64_t)
-INTEGRAL_TYPE_HANDLER(uint8_t)
-INTEGRAL_TYPE_HANDLER(uint16_t)
-INTEGRAL_TYPE_HANDLER(uint32_t)
-INTEGRAL_TYPE_HANDLER(uint64_t)
+namespace {
 
+static_assert(
+    std::numeric_limits<float>::is_iec559 and sizeof(float) == 4,
+    "Binary savegames require 32 bit IEEE floats"
+);
 
-////////////////////////////////////////////////////////////////////////////////
-// Bool
-////////////////////////////////////////////////////////////////////////////////
+static_assert(
+    std::numeric_limits<double>::is_iec559 and sizeof(double) == 8,
+    "Binary savegames require 64 bit IEEE doubles"
+);
 
-template<>
-struct TypeHandler<bool> {
+// Starts every binary savegame. Legacy savegames start with their entry
+// count instead, which would have to exceed a billion to look like this.
+const char BINARY_MAGIC[4] = {'T', 'H', 'R', 'B'};
 
-    static bool
-    deserialize(
-        std::istream& stream
-    ) {
-        auto value = TypeHandler<uint8_t>::deserialize(stream);
-        return value > 0;
-    }
+const uint16_t BINARY_VERSION = 2;
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const bool& value
-    ) {
-        uint8_t encoded = value ? 1 : 0;
-        TypeHandler<uint8_t>::serialize(stream, encoded);
-    }
+// Magic, version and body size
+const size_t BINARY_HEADER_SIZE = sizeof(BINARY_MAGIC) + sizeof(uint16_t) + sizeof(uint64_t);
 
-};
+// Deepest nesting of containers and lists a reader accepts. Real savegames
+// stay far below, malformed ones must not exhaust the stack.
+const unsigned int MAX_NESTING_DEPTH = 128;
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Char
+// Binary format
 ////////////////////////////////////////////////////////////////////////////////
 
-template<>
-struct TypeHandler<char> {
-
-    static char
-    deserialize(
-        std::istream& stream
-    ) {
-        char value = 0;
-        stream.read(&value, 1);
-        assert(not stream.fail());
-        return value;
-    }
+/**
+* @brief Writes the binary savegame format
+*
+* Layout:
+* - Magic bytes, version and the size of the body
+* - Body: the key table, i.e. number of keys and each key as a string,
+*   followed by the root container's content
+*
+* A container's content is its entry count followed by the entries, each
+* made of the key's index in the key table, the type id and the value.
+* Vectors, quaternions and planes are written as raw floats instead of as
+* the containers they are stored as. Nested containers and lists are
+* prefixed with their size in bytes, so readers can skip them.
+*
+* Counts, lengths and key indices are variable length integers in 7 bit
+* groups, low group first. They are nearly always small, so most of them
+* take a single byte.
+*/
+class BinaryWriter : public boost::static_visitor<> {
+
+public:
 
-    static void
-    serialize(
+    void
+    write(
         std::ostream& stream,
-        const char& value
+        const StorageContainer& storage
     ) {
-        stream.write(&value, 1);
+        m_buffer.clear();
+        m_buffer.append(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        this->writeRaw(BINARY_VERSION);
+        size_t bodySizeOffset = m_buffer.size();
+        this->writeRaw<uint64_t>(0);
+        this->collectKeys(storage);
+        this->writeVarInt(m_keys.size());
+        for (Key key : m_keys) {
+            this->writeString(*key);
+        }
+        this->writeContent(storage);
+        this->patch<uint64_t>(
+            bodySizeOffset,
+            m_buffer.size() - BINARY_HEADER_SIZE
+        );
+        stream.write(m_buffer.data(), m_buffer.size());
     }
-};
-
 
-////////////////////////////////////////////////////////////////////////////////
-// String
-////////////////////////////////////////////////////////////////////////////////
+    template<typename T>
+    void
+    operator () (
+        const T& value
+    ) {
+        this->writeRaw(value);
+    }
 
-template<>
-struct TypeHandler<std::string> {
+    void
+    operator () (
+        const bool& value
+    ) {
+        this->writeRaw<uint8_t>(value ? 1 : 0);
+    }
 
-    static std::string
-    deserialize(
-        std::istream& stream
+    void
+    operator () (
+        const std::string& value
     ) {
-        uint64_t size = TypeHandler<uint64_t>::deserialize(stream);
-        std::vector<char> buffer(size, '\0');
-        stream.read(&buffer[0], size);
-        assert(not stream.fail());
-        return std::string(buffer.begin(), buffer.end());
+        this->writeString(value);
     }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const std::string& string
+    void
+    operator () (
+        const StorageContainer& storage
     ) {
-        uint64_t size = string.size();
-        TypeHandler<uint64_t>::serialize(stream, size);
-        stream.write(string.data(), size);
+        size_t start = this->beginSized();
+        this->writeContent(storage);
+        this->endSized(start);
     }
 
-};
+    void
+    operator () (
+        const StorageList& list
+    ) {
+        size_t start = this->beginSized();
+        this->writeVarInt(list.size());
+        for (const StorageContainer& element : list) {
+            (*this)(element);
+        }
+        this->endSized(start);
+    }
 
+private:
 
-////////////////////////////////////////////////////////////////////////////////
-// Float
-////////////////////////////////////////////////////////////////////////////////
+    size_t
+    beginSized() {
+        size_t start = m_buffer.size();
+        this->writeRaw<uint32_t>(0);
+        return start;
+    }
 
-template<>
-struct TypeHandler<float> {
+    void
+    collectKeys(
+        const StorageContainer& storage,
+        unsigned int depth = 0
+    ) {
+        // Readers would reject the savegame
+        if (depth > MAX_NESTING_DEPTH) {
+            throw std::runtime_error("Savegame nested too deeply");
+        }
+        for (const auto& pair : StorageSerializer::content(storage)) {
+            auto inserted = m_keyIndices.emplace(pair.first, m_keys.size());
+            if (inserted.second) {
+                m_keys.push_back(pair.first);
+            }
+            // Inlined compound types don't write their keys
+            if (pair.second.typeId == TypeInfo<StorageContainer>::Id) {
+                this->collectKeys(
+                    boost::get<StorageContainer>(pair.second.value),
+                    depth + 1
+                );
+            }
+            else if (pair.second.typeId == TypeInfo<StorageList>::Id) {
+                for (const auto& element : boost::get<StorageList>(pair.second.value)) {
+                    this->collectKeys(element, depth + 1);
+                }
+            }
+        }
+    }
 
-    static float
-    deserialize(
-        std::istream& stream
+    void
+    endSized(
+        size_t start
     ) {
-        std::string asString = TypeHandler<std::string>::deserialize(stream);
-        return boost::lexical_cast<float>(asString);
+        size_t size = m_buffer.size() - start - sizeof(uint32_t);
+        if (size > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error("Savegame container exceeds 4 GiB");
+        }
+        this->patch<uint32_t>(start, size);
     }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const float& value
+    template<typename T>
+    void
+    patch(
+        size_t offset,
+        T value
     ) {
-        std::string asString = boost::lexical_cast<std::string>(value);
-        TypeHandler<std::string>::serialize(stream, asString);
+        std::memcpy(&m_buffer[offset], &value, sizeof(T));
     }
 
-};
+    void
+    writeContent(
+        const StorageContainer& storage
+    ) {
+        const auto& content = StorageSerializer::content(storage);
+        this->writeVarInt(content.size());
+        for (const auto& pair : content) {
+            this->writeVarInt(m_keyIndices.at(pair.first));
+            this->writeRaw(pair.second.typeId);
+            this->writeValue(pair.second);
+        }
+    }
 
+    void
+    writeFloats(
+        std::initializer_list<float> values
+    ) {
+        for (float value : values) {
+            this->writeRaw(value);
+        }
+    }
 
-////////////////////////////////////////////////////////////////////////////////
-// Double
-////////////////////////////////////////////////////////////////////////////////
+    template<typename T>
+    void
+    writeRaw(
+        T value
+    ) {
+        m_buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
 
-template<>
-struct TypeHandler<double> {
+    void
+    writeString(
+        const std::string& string
+    ) {
+        this->writeVarInt(string.size());
+        m_buffer.append(string);
+    }
 
-    static double
-    deserialize(
-        std::istream& stream
+    void
+    writeValue(
+        const StoredValue& value
     ) {
-        std::string asString = TypeHandler<std::string>::deserialize(stream);
-        return boost::lexical_cast<double>(asString);
+        switch (value.typeId) {
+            case TypeInfo<Ogre::Plane>::Id:
+            {
+                auto plane = TypeInfo<Ogre::Plane>::convertFromStoredType(
+                    boost::get<StorageContainer>(value.value)
+                );
+                this->writeFloats({
+                    plane.normal.x, plane.normal.y, plane.normal.z, plane.d
+                });
+                break;
+            }
+            case TypeInfo<Ogre::Vector3>::Id:
+            {
+                auto vector = TypeInfo<Ogre::Vector3>::convertFromStoredType(
+                    boost::get<StorageContainer>(value.value)
+                );
+                this->writeFloats({vector.x, vector.y, vector.z});
+                break;
+            }
+            case TypeInfo<Ogre::Quaternion>::Id:
+            {
+                auto quaternion = TypeInfo<Ogre::Quaternion>::convertFromStoredType(
+                    boost::get<StorageContainer>(value.value)
+                );
+                this->writeFloats({
+                    quaternion.w, quaternion.x, quaternion.y, quaternion.z
+                });
+                break;
+            }
+            default:
+                boost::apply_visitor(*this, value.value);
+        }
     }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const double& value
+    void
+    writeVarInt(
+        uint64_t value
     ) {
-        std::string asString = boost::lexical_cast<std::string>(value);
-        TypeHandler<std::string>::serialize(stream, asString);
+        while (value >= 0x80) {
+            m_buffer.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        m_buffer.push_back(static_cast<char>(value));
     }
 
+    std::string m_buffer;
+
+    std::unordered_map<Key, uint64_t> m_keyIndices;
+
+    // In index order
+    std::vector<Key> m_keys;
+
 };
 
 
-////////////////////////////////////////////////////////////////////////////////
-// StorageContainer
-////////////////////////////////////////////////////////////////////////////////
+/**
+* @brief Bounds checked reading from encoded memory
+*/
+class ByteReader {
 
-template<>
-struct TypeHandler<StorageContainer> {
+public:
 
-    static StorageContainer
-    deserialize(
-        std::istream& stream
-    ) {
-        StorageContainer value;
-        stream >> value;
+    ByteReader(
+        const char* begin,
+        const char* end
+    ) : m_position(begin),
+        m_end(end)
+    {
+    }
+
+    bool
+    atEnd() const {
+        return m_position == m_end;
+    }
+
+    const char*
+    end() const {
+        return m_end;
+    }
+
+    const char*
+    position() const {
+        return m_position;
+    }
+
+    template<typename T>
+    T
+    readRaw() {
+        T value;
+        std::memcpy(&value, this->skip(sizeof(T)), sizeof(T));
         return value;
     }
 
+    std::string
+    readString() {
+        uint64_t size = this->readVarInt();
+        const char* data = this->skip(size);
+        return std::string(data, size);
+    }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const StorageContainer& value
+    uint64_t
+    readVarInt() {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            auto byte = this->readRaw<uint8_t>();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (not (byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Malformed integer in savegame");
+    }
+
+    /**
+    * @brief Reads a size prefixed block
+    *
+    * @return
+    *   A reader for the block's content
+    */
+    ByteReader
+    readSized() {
+        auto size = this->readRaw<uint32_t>();
+        const char* begin = this->skip(size);
+        return ByteReader(begin, begin + size);
+    }
+
+    /**
+    * @brief Advances past \a size bytes
+    *
+    * @return
+    *   The first skipped byte
+    */
+    const char*
+    skip(
+        uint64_t size
     ) {
-        stream << value;
+        if (size > static_cast<uint64_t>(m_end - m_position)) {
+            throw std::runtime_error("Unexpected end of savegame");
+        }
+        const char* begin = m_position;
+        m_position += size;
+        return begin;
     }
 
+    /**
+    * @brief Advances past a value of the given type
+    */
+    void
+    skipValue(
+        TypeId typeId
+    );
+
+private:
+
+    const char* m_position;
+
+    const char* m_end;
+
 };
 
 
-////////////////////////////////////////////////////////////////////////////////
-// StorageList
-////////////////////////////////////////////////////////////////////////////////
+void
+ByteReader::skipValue(
+    TypeId typeId
+) {
+    switch (typeId) {
+        case TypeInfo<bool>::Id:
+        case TypeInfo<char>::Id:
+        case TypeInfo<int8_t>::Id:
+        case TypeInfo<uint8_t>::Id:
+            this->skip(1);
+            break;
+        case TypeInfo<int16_t>::Id:
+        case TypeInfo<uint16_t>::Id:
+            this->skip(2);
+            break;
+        case TypeInfo<int32_t>::Id:
+        case TypeInfo<uint32_t>::Id:
+        case TypeInfo<float>::Id:
+        case TypeInfo<Ogre::Degree>::Id:
+        case TypeInfo<Ogre::ColourValue>::Id:
+            this->skip(4);
+            break;
+        case TypeInfo<int64_t>::Id:
+        case TypeInfo<uint64_t>::Id:
+        case TypeInfo<double>::Id:
+            this->skip(8);
+            break;
+        case TypeInfo<std::string>::Id:
+            this->skip(this->readVarInt());
+            break;
+        case TypeInfo<StorageContainer>::Id:
+        case TypeInfo<StorageList>::Id:
+            this->readSized();
+            break;
+        case TypeInfo<Ogre::Vector3>::Id:
+            this->skip(12);
+            break;
+        case TypeInfo<Ogre::Plane>::Id:
+        case TypeInfo<Ogre::Quaternion>::Id:
+            this->skip(16);
+            break;
+        default:
+            throw std::runtime_error(
+                "Unknown type id " + std::to_string(typeId) + " in savegame"
+            );
+    }
+}
 
-template<>
-struct TypeHandler<StorageList> {
 
-    static StorageList
-    deserialize(
-        std::istream& stream
+/**
+* @brief Decodes the binary savegame format written by BinaryWriter
+*/
+class BinaryReader {
+
+public:
+
+    BinaryReader(
+        ByteReader bytes,
+        const FileKeys& keys,
+        unsigned int depth = 0
+    ) : m_bytes(bytes),
+        m_depth(depth),
+        m_keys(keys)
+    {
+        if (depth > MAX_NESTING_DEPTH) {
+            throw std::runtime_error("Savegame nested too deeply");
+        }
+    }
+
+    /**
+    * @brief Reads and resolves the key table at the start of a body
+    */
+    static FileKeys
+    readKeys(
+        ByteReader& bytes
     ) {
-        StorageList list;
-        uint64_t size = TypeHandler<uint64_t>::deserialize(stream);
-        list.reserve(size);
-        for (size_t i=0; i < size; ++i) {
-            list.append(TypeHandler<StorageContainer>::deserialize(stream));
+        uint64_t keyCount = bytes.readVarInt();
+        FileKeys keys;
+        for (uint64_t i = 0; i < keyCount; ++i) {
+            keys.indexed.push_back(keys.resolve(bytes.readString()));
         }
-        return list;
+        return keys;
     }
 
+    /**
+    * @brief Checks the header and returns the body
+    *
+    * @param begin
+    *   Start of the header, including the magic bytes
+    * @param end
+    *   End of the available data
+    */
+    static ByteReader
+    readHeader(
+        const char* begin,
+        const char* end
+    ) {
+        ByteReader header(begin, end);
+        header.skip(sizeof(BINARY_MAGIC));
+        auto version = header.readRaw<uint16_t>();
+        if (version != BINARY_VERSION) {
+            throw std::runtime_error(
+                "Unsupported savegame version " + std::to_string(version)
+            );
+        }
+        auto bodySize = header.readRaw<uint64_t>();
+        const char* body = header.skip(bodySize);
+        return ByteReader(body, body + bodySize);
+    }
 
-    static void
-    serialize(
-        std::ostream& stream,
-        const StorageList& list
+    void
+    readContent(
+        StorageContainer& storage
     ) {
-        uint64_t size = list.size();
-        TypeHandler<uint64_t>::serialize(stream, size);
-        for (const auto& storageContainer : list) {
-            TypeHandler<StorageContainer>::serialize(stream, storageContainer);
+        auto& content = StorageSerializer::content(storage);
+        content.clear();
+        uint64_t size = m_bytes.readVarInt();
+        // Every entry takes at least three bytes
+        content.reserve(std::min<uint64_t>(
+            size,
+            (m_bytes.end() - m_bytes.position()) / 3
+        ));
+        for (uint64_t i = 0; i < size; ++i) {
+            Key key = this->readKey();
+            auto typeId = m_bytes.readRaw<TypeId>();
+            content.insertUnsorted(key, StoredValue {
+                typeId,
+                this->readValue(typeId)
+            });
+        }
+        content.finishInsertion();
+        content.setLocalKeys(m_keys.localKeys());
+    }
+
+    Key
+    readKey() {
+        uint64_t keyIndex = m_bytes.readVarInt();
+        if (keyIndex >= m_keys.indexed.size()) {
+            throw std::runtime_error("Invalid key index in savegame");
         }
+        return m_keys.indexed[keyIndex];
     }
 
+    Variant
+    readValue(
+        TypeId typeId
+    );
+
+private:
+
+    float
+    readFloat() {
+        return m_bytes.readRaw<float>();
+    }
+
+    ByteReader m_bytes;
+
+    unsigned int m_depth;
+
+    const FileKeys& m_keys;
+
 };
 
+#define BINARY_READ_CASE(typeName) \
+    case TypeInfo<typeName>::Id: \
+        return m_bytes.readRaw<typeName>()
 
-struct SerializationVisitor : public boost::static_visitor<> {
+Variant
+BinaryReader::readValue(
+    TypeId typeId
+) {
+    switch (typeId) {
+        case TypeInfo<bool>::Id:
+            return m_bytes.readRaw<uint8_t>() > 0;
+        BINARY_READ_CASE(char);
+        BINARY_READ_CASE(int8_t);
+        BINARY_READ_CASE(int16_t);
+        BINARY_READ_CASE(int32_t);
+        BINARY_READ_CASE(int64_t);
+        BINARY_READ_CASE(uint8_t);
+        BINARY_READ_CASE(uint16_t);
+        BINARY_READ_CASE(uint32_t);
+        BINARY_READ_CASE(uint64_t);
+        BINARY_READ_CASE(float);
+        BINARY_READ_CASE(double);
+        case TypeInfo<std::string>::Id:
+            return m_bytes.readString();
+        case TypeInfo<StorageContainer>::Id:
+        {
+            StorageContainer storage;
+            BinaryReader(
+                m_bytes.readSized(),
+                m_keys,
+                m_depth + 1
+            ).readContent(storage);
+            return storage;
+        }
+        case TypeInfo<StorageList>::Id:
+        {
+            BinaryReader elements(m_bytes.readSized(), m_keys, m_depth + 1);
+            uint64_t size = elements.m_bytes.readVarInt();
+            // Every element takes at least its size prefix
+            if (size > static_cast<uint64_t>(
+                elements.m_bytes.end() - elements.m_bytes.position()
+            ) / sizeof(uint32_t)) {
+                throw std::runtime_error("Unexpected end of savegame");
+            }
+            StorageList list;
+            list.resize(size);
+            for (StorageContainer& element : list) {
+                BinaryReader(
+                    elements.m_bytes.readSized(),
+                    m_keys,
+                    m_depth + 1
+                ).readContent(element);
+            }
+            return list;
+        }
+        // Compound types
+        case TypeInfo<Ogre::Degree>::Id:
+            return this->readFloat();
+        case TypeInfo<Ogre::Plane>::Id:
+        {
+            Ogre::Plane plane;
+            plane.normal.x = this->readFloat();
+            plane.normal.y = this->readFloat();
+            plane.normal.z = this->readFloat();
+            plane.d = this->readFloat();
+            return TypeInfo<Ogre::Plane>::convertToStoredType(plane);
+        }
+        case TypeInfo<Ogre::Vector3>::Id:
+        {
+            float x = this->readFloat();
+            float y = this->readFloat();
+            float z = this->readFloat();
+            return TypeInfo<Ogre::Vector3>::convertToStoredType(
+                Ogre::Vector3(x, y, z)
+            );
+        }
+        case TypeInfo<Ogre::Quaternion>::Id:
+        {
+            float w = this->readFloat();
+            float x = this->readFloat();
+            float y = this->readFloat();
+            float z = this->readFloat();
+            return TypeInfo<Ogre::Quaternion>::convertToStoredType(
+                Ogre::Quaternion(w, x, y, z)
+            );
+        }
+        case TypeInfo<Ogre::ColourValue>::Id:
+            return m_bytes.readRaw<uint32_t>();
+        default:
+            throw std::runtime_error(
+                "Unknown type id " + std::to_string(typeId) + " in savegame"
+            );
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Legacy format
+////////////////////////////////////////////////////////////////////////////////
 
-    SerializationVisitor(
-        std::ostream& stream
+/**
+* @brief Reads savegames written before the binary format
+*
+* Strings and counts are 64 bit, floating point numbers are stored as text
+* and keys are repeated in every container.
+*/
+class LegacyReader {
+
+public:
+
+    LegacyReader(
+        std::istream& stream
     ) : m_stream(stream)
     {
     }
 
-    template<typename T>
+    /**
+    * @brief Reads a container's entries after its entry count
+    */
     void
-    operator () (
-        const T& value
-    ) const {
-        TypeHandler<T>::serialize(m_stream, value);
+    readContent(
+        StorageContainer& storage,
+        uint64_t size
+    ) {
+        if (m_depth > MAX_NESTING_DEPTH) {
+            throw std::runtime_error("Savegame nested too deeply");
+        }
+        auto& content = StorageSerializer::content(storage);
+        content.clear();
+        for (uint64_t i = 0; i < size; ++i) {
+            Key key = m_keys.resolve(this->readString());
+            auto typeId = this->readRaw<TypeId>();
+            content.insertUnsorted(key, StoredValue {
+                typeId,
+                this->readValue(typeId)
+            });
+        }
+        content.finishInsertion();
+        content.setLocalKeys(m_keys.localKeys());
     }
 
-    std::ostream& m_stream;
+private:
+
+    template<typename T>
+    T
+    readLexical() {
+        return boost::lexical_cast<T>(this->readString());
+    }
+
+    template<typename T>
+    T
+    readRaw() {
+        T value = 0;
+        m_stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (m_stream.fail()) {
+            throw std::runtime_error("Unexpected end of savegame");
+        }
+        return value;
+    }
+
+    std::string
+    readString() {
+        auto size = this->readRaw<uint64_t>();
+        std::string string;
+        // Grow with the data actually read, a corrupt size must not
+        // allocate gigabytes up front
+        char buffer[4096];
+        while (size > 0) {
+            auto chunk = static_cast<size_t>(std::min<uint64_t>(size, sizeof(buffer)));
+            m_stream.read(buffer, chunk);
+            if (m_stream.fail()) {
+                throw std::runtime_error("Unexpected end of savegame");
+            }
+            string.append(buffer, chunk);
+            size -= chunk;
+        }
+        return string;
+    }
+
+    Variant
+    readValue(
+        TypeId typeId
+    );
+
+    // Nesting depth of the container being read
+    unsigned int m_depth = 0;
+
+    FileKeys m_keys;
+
+    std::istream& m_stream;
+
 };
 
-#define DESERIALIZE_CASE(typeName) \
+#define LEGACY_READ_CASE(typeName) \
     case TypeInfo<typeName>::Id: \
-        return TypeHandler<TypeInfo<typeName>::StoredType>::deserialize(stream)
+        return this->readRaw<typeName>()
 
-static Variant
-deserialize(
-    TypeId typeId,
-    std::istream& stream
+Variant
+LegacyReader::readValue(
+    TypeId typeId
 ) {
     switch (typeId) {
-        DESERIALIZE_CASE(bool);
-        DESERIALIZE_CASE(char);
-        DESERIALIZE_CASE(int8_t);
-        DESERIALIZE_CASE(int16_t);
-        DESERIALIZE_CASE(int32_t);
-        DESERIALIZE_CASE(int64_t);
-        DESERIALIZE_CASE(uint8_t);
-        DESERIALIZE_CASE(uint16_t);
-        DESERIALIZE_CASE(uint32_t);
-        DESERIALIZE_CASE(uint64_t);
-        DESERIALIZE_CASE(float);
-        DESERIALIZE_CASE(double);
-        DESERIALIZE_CASE(std::string);
-        DESERIALIZE_CASE(StorageContainer);
-        DESERIALIZE_CASE(StorageList);
-        // Compound types
-        DESERIALIZE_CASE(Ogre::Degree);
-        DESERIALIZE_CASE(Ogre::Plane);
-        DESERIALIZE_CASE(Ogre::Vector3);
-        DESERIALIZE_CASE(Ogre::Quaternion);
-        DESERIALIZE_CASE(Ogre::ColourValue);
+        case TypeInfo<bool>::Id:
+            return this->readRaw<uint8_t>() > 0;
+        LEGACY_READ_CASE(char);
+        LEGACY_READ_CASE(int8_t);
+        LEGACY_READ_CASE(int16_t);
+        LEGACY_READ_CASE(int32_t);
+        LEGACY_READ_CASE(int64_t);
+        LEGACY_READ_CASE(uint8_t);
+        LEGACY_READ_CASE(uint16_t);
+        LEGACY_READ_CASE(uint32_t);
+        LEGACY_READ_CASE(uint64_t);
+        case TypeInfo<float>::Id:
+        case TypeInfo<Ogre::Degree>::Id:
+            return this->readLexical<float>();
+        case TypeInfo<double>::Id:
+            return this->readLexical<double>();
+        case TypeInfo<std::string>::Id:
+            return this->readString();
+        case TypeInfo<StorageContainer>::Id:
+        case TypeInfo<Ogre::Plane>::Id:
+        case TypeInfo<Ogre::Vector3>::Id:
+        case TypeInfo<Ogre::Quaternion>::Id:
+        {
+            StorageContainer storage;
+            ++m_depth;
+            this->readContent(storage, this->readRaw<uint64_t>());
+            --m_depth;
+            return storage;
+        }
+        case TypeInfo<StorageList>::Id:
+        {
+            StorageList list;
+            auto size = this->readRaw<uint64_t>();
+            ++m_depth;
+            for (uint64_t i = 0; i < size; ++i) {
+                StorageContainer element;
+                this->readContent(element, this->readRaw<uint64_t>());
+                list.append(std::move(element));
+            }
+            --m_depth;
+            return list;
+        }
+        case TypeInfo<Ogre::ColourValue>::Id:
+            return this->readRaw<uint32_t>();
         default:
-            assert(false && "Unknown type id. Did you add a new STORABLE_TYPE, but forgot the DESERIALIZE_CASE?");
+            throw std::runtime_error(
+                "Unknown type id " + std::to_string(typeId) + " in savegame"
+            );
     }
-    return Variant(); // Should never be reached, but mingw complains without it
 }
 
 
+/**
+* @brief Decodes a complete binary savegame, header included
+*/
+void
+readBinary(
+    const char* begin,
+    const char* end,
+    StorageContainer& storage
+) {
+    ByteReader body = BinaryReader::readHeader(begin, end);
+    auto keys = BinaryReader::readKeys(body);
+    BinaryReader(body, keys).readContent(storage);
+}
+
 } // namespace
 
 std::ostream&
@@ -982,14 +1940,8 @@ thrive::operator << (
     std::ostream& stream,
     const StorageContainer& storage
 ) {
-    SerializationVisitor visitor(stream);
-    const auto& content = storage.m_impl->m_content;
-    TypeHandler<uint64_t>::serialize(stream, content.size());
-    for (const auto& pair : content) {
-        TypeHandler<std::string>::serialize(stream, pair.first);    
-        TypeHandler<TypeId>::serialize(stream, pair.second.typeId);    
-        boost::apply_visitor(visitor, pair.second.value);
-    }
+    BinaryWriter writer;
+    writer.write(stream, storage);
     return stream;
 }
 
@@ -999,20 +1951,418 @@ thrive::operator >> (
     std::istream& stream,
     StorageContainer& storage
 ) {
-    uint64_t size = TypeHandler<uint64_t>::deserialize(stream);
-    storage.m_impl->m_content.clear();
-    for (size_t i = 0; i < size; ++i) {
-        std::string key = TypeHandler<std::string>::deserialize(stream);
-        TypeId typeId = TypeHandler<TypeId>::deserialize(stream);
-        storage.m_impl->m_content[key] = StoredValue {
-            typeId,
-            deserialize(typeId, stream)
-        };
+    // Legacy savegames begin with their 64 bit entry count, so the first
+    // bytes are either a magic or the low half of that count
+    char header[BINARY_HEADER_SIZE];
+    stream.read(header, sizeof(BINARY_MAGIC));
+    if (stream.fail()) {
+        throw std::runtime_error("Unexpected end of savegame");
+    }
+    if (SavegameCompression::isCompressed(header, sizeof(BINARY_MAGIC))) {
+        std::string data = SavegameCompression::decompressAfterMagic(stream);
+        readBinary(data.data(), data.data() + data.size(), storage);
+    }
+    else if (std::equal(header, header + sizeof(BINARY_MAGIC), BINARY_MAGIC)) {
+        stream.read(
+            header + sizeof(BINARY_MAGIC),
+            BINARY_HEADER_SIZE - sizeof(BINARY_MAGIC)
+        );
+        if (stream.fail()) {
+            throw std::runtime_error("Unexpected end of savegame");
+        }
+        uint64_t bodySize;
+        std::memcpy(&bodySize, header + BINARY_HEADER_SIZE - sizeof(bodySize), sizeof(bodySize));
+        std::string data(header, BINARY_HEADER_SIZE);
+        char buffer[4096];
+        while (data.size() < BINARY_HEADER_SIZE + bodySize) {
+            auto chunk = static_cast<size_t>(std::min<uint64_t>(
+                BINARY_HEADER_SIZE + bodySize - data.size(),
+                sizeof(buffer)
+            ));
+            stream.read(buffer, chunk);
+            if (stream.fail()) {
+                throw std::runtime_error("Unexpected end of savegame");
+            }
+            data.append(buffer, chunk);
+        }
+        readBinary(data.data(), data.data() + data.size(), storage);
+    }
+    else {
+        stream.read(header + sizeof(BINARY_MAGIC), sizeof(BINARY_MAGIC));
+        if (stream.fail()) {
+            throw std::runtime_error("Unexpected end of savegame");
+        }
+        uint64_t size;
+        std::memcpy(&size, header, sizeof(size));
+        LegacyReader reader(stream);
+        reader.readContent(storage, size);
     }
     return stream;
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// StorageView
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct ViewEntry {
+
+    // The encoded value
+    const char* begin;
+
+    const char* end;
+
+    Key key;
+
+    TypeId typeId;
+
+};
+
+} // namespace
+
+
+/**
+* @brief The encoded data shared by all views into one savegame
+*/
+struct StorageView::Source {
+
+    // Holds the data if it isn't mapped from a file
+    std::string buffer;
+
+    FileKeys keys;
+
+    boost::interprocess::mapped_region region;
+
+};
+
+
+struct StorageView::Implementation {
+
+    Implementation() = default;
+
+    Implementation(
+        std::shared_ptr<const Source> source,
+        ByteReader content
+    ) : m_begin(content.position()),
+        m_end(content.end()),
+        m_source(std::move(source))
+    {
+        uint64_t size = content.readVarInt();
+        for (uint64_t i = 0; i < size; ++i) {
+            ViewEntry entry;
+            uint64_t keyIndex = content.readVarInt();
+            if (keyIndex >= m_source->keys.indexed.size()) {
+                throw std::runtime_error("Invalid key index in savegame");
+            }
+            entry.key = m_source->keys.indexed[keyIndex];
+            entry.typeId = content.readRaw<TypeId>();
+            entry.begin = content.position();
+            content.skipValue(entry.typeId);
+            entry.end = content.position();
+            m_entries.push_back(entry);
+        }
+        std::sort(
+            m_entries.begin(),
+            m_entries.end(),
+            [](const ViewEntry& lhs, const ViewEntry& rhs) {
+                return keyLess(lhs.key, rhs.key);
+            }
+        );
+    }
+
+    Variant
+    decode(
+        const ViewEntry& entry
+    ) const {
+        BinaryReader reader(
+            ByteReader(entry.begin, entry.end),
+            m_source->keys
+        );
+        return reader.readValue(entry.typeId);
+    }
+
+    const ViewEntry*
+    find(
+        const std::string& key
+    ) const {
+        auto iter = std::lower_bound(
+            m_entries.begin(),
+            m_entries.end(),
+            key,
+            [](const ViewEntry& entry, const std::string& key) {
+                return *entry.key < key;
+            }
+        );
+        if (iter == m_entries.end() or *iter->key != key) {
+            return nullptr;
+        }
+        return &*iter;
+    }
+
+    template<typename T>
+    bool
+    rawContains(
+        const std::string& key
+    ) const {
+        const ViewEntry* entry = this->find(key);
+        return entry and entry->typeId == TypeInfo<T>::Id;
+    }
+
+    // The container's encoded content
+    const char* m_begin = nullptr;
+
+    const char* m_end = nullptr;
+
+    // Sorted by key index
+    std::vector<ViewEntry> m_entries;
+
+    std::shared_ptr<const Source> m_source;
+
+};
+
+#define VIEW_GET_CONTAINS(type) \
+    \
+    template<> \
+    bool \
+    StorageView::contains<type>( \
+        const std::string& key \
+    ) const { \
+        return m_impl->rawContains<type>(key); \
+    } \
+    \
+    template<> \
+    type \
+    StorageView::get<type>( \
+        const std::string& key, \
+        const type& defaultValue \
+    ) const { \
+        const ViewEntry* entry = m_impl->find(key); \
+        if (not entry or entry->typeId != TypeInfo<type>::Id) { \
+            return defaultValue; \
+        } \
+        Variant storedValue = m_impl->decode(*entry); \
+        return TypeInfo<type>::convertFromStoredType( \
+            boost::get<TypeInfo<type>::StoredType>(storedValue) \
+        ); \
+    }
+
+VIEW_GET_CONTAINS(bool)
+VIEW_GET_CONTAINS(char)
+VIEW_GET_CONTAINS(int8_t)
+VIEW_GET_CONTAINS(int16_t)
+VIEW_GET_CONTAINS(int32_t)
+VIEW_GET_CONTAINS(int64_t)
+VIEW_GET_CONTAINS(uint8_t)
+VIEW_GET_CONTAINS(uint16_t)
+VIEW_GET_CONTAINS(uint32_t)
+VIEW_GET_CONTAINS(uint64_t)
+VIEW_GET_CONTAINS(float)
+VIEW_GET_CONTAINS(double)
+VIEW_GET_CONTAINS(std::string)
+VIEW_GET_CONTAINS(StorageContainer)
+VIEW_GET_CONTAINS(StorageList)
+// Compound types
+VIEW_GET_CONTAINS(Ogre::Degree)
+VIEW_GET_CONTAINS(Ogre::Plane)
+VIEW_GET_CONTAINS(Ogre::Vector3)
+VIEW_GET_CONTAINS(Ogre::Quaternion)
+VIEW_GET_CONTAINS(Ogre::ColourValue)
+
+
+void
+StorageView::luaBindings(
+    sol::state &lua
+){
+    lua.new_usertype<StorageView>("StorageView",
+
+        sol::constructors<sol::types<>>(),
+
+        "open", &StorageView::open,
+
+        "contains", static_cast<bool(StorageView::*)(
+            const std::string&) const>(
+                (&StorageView::contains)),
+
+        "decode", &StorageView::decode,
+
+        "get", sol::overload([](StorageView &self, const std::string &key,
+                sol::this_state s)
+            {
+                return self.luaGet(key, sol::nil, s);
+
+            }, &StorageView::luaGet),
+
+        "view", &StorageView::view
+    );
+}
+
+
+StorageView
+StorageView::fromBuffer(
+    std::string data
+) {
+    auto source = std::make_shared<Source>();
+    source->buffer = std::move(data);
+    const char* begin = source->buffer.data();
+    const char* end = begin + source->buffer.size();
+    return fromSource(std::move(source), begin, end);
+}
+
 
+StorageView
+StorageView::open(
+    const std::string& filename
+) {
+    namespace ip = boost::interprocess;
+    if (boost::filesystem::file_size(filename) == 0) {
+        throw std::runtime_error("Savegame " + filename + " is empty");
+    }
+    auto source = std::make_shared<Source>();
+    ip::file_mapping mapping(filename.c_str(), ip::read_only);
+    source->region = ip::mapped_region(mapping, ip::read_only);
+    const char* begin = static_cast<const char*>(source->region.get_address());
+    const char* end = begin + source->region.get_size();
+    return fromSource(std::move(source), begin, end);
+}
 
 
+StorageView
+StorageView::fromSource(
+    std::shared_ptr<Source> source,
+    const char* begin,
+    const char* end
+) {
+    if (SavegameCompression::isCompressed(begin, end - begin)) {
+        return fromBuffer(SavegameCompression::decompress(begin, end - begin));
+    }
+    bool isBinary = (
+        static_cast<size_t>(end - begin) >= sizeof(BINARY_MAGIC) and
+        std::equal(begin, begin + sizeof(BINARY_MAGIC), BINARY_MAGIC)
+    );
+    if (not isBinary) {
+        // Older savegames have no sizes to skip by, decode them completely
+        // and view the binary encoding instead
+        std::istringstream input(
+            std::string(begin, end),
+            std::ios_base::in | std::ios_base::binary
+        );
+        StorageContainer storage;
+        input >> storage;
+        std::ostringstream output(std::ios_base::out | std::ios_base::binary);
+        output << storage;
+        return fromBuffer(output.str());
+    }
+    ByteReader body = BinaryReader::readHeader(begin, end);
+    source->keys = BinaryReader::readKeys(body);
+    return StorageView(std::make_shared<Implementation>(
+        std::move(source),
+        body
+    ));
+}
+
+
+StorageView::StorageView()
+  : m_impl(std::make_shared<Implementation>())
+{
+}
+
+
+StorageView::StorageView(
+    std::shared_ptr<const Implementation> impl
+) : m_impl(std::move(impl))
+{
+}
+
+
+bool
+StorageView::contains(
+    const std::string& key
+) const {
+    return m_impl->find(key) != nullptr;
+}
+
+
+StorageContainer
+StorageView::decode() const {
+    StorageContainer storage;
+    if (m_impl->m_source) {
+        BinaryReader reader(
+            ByteReader(m_impl->m_begin, m_impl->m_end),
+            m_impl->m_source->keys
+        );
+        reader.readContent(storage);
+    }
+    return storage;
+}
+
+
+std::list<std::string>
+StorageView::keys() const {
+    std::list<std::string> keys;
+    for (const ViewEntry& entry : m_impl->m_entries) {
+        keys.push_back(*entry.key);
+    }
+    return keys;
+}
+
+
+std::vector<StorageView>
+StorageView::list(
+    const std::string& key
+) const {
+    std::vector<StorageView> elements;
+    const ViewEntry* entry = m_impl->find(key);
+    if (not entry or entry->typeId != TypeInfo<StorageList>::Id) {
+        return elements;
+    }
+    ByteReader list = ByteReader(entry->begin, entry->end).readSized();
+    uint64_t size = list.readVarInt();
+    for (uint64_t i = 0; i < size; ++i) {
+        elements.push_back(StorageView(std::make_shared<Implementation>(
+            m_impl->m_source,
+            list.readSized()
+        )));
+    }
+    return elements;
+}
+
+
+sol::object
+StorageView::luaGet(
+    const std::string& key,
+    sol::object defaultValue,
+    sol::this_state s
+) const {
+    const ViewEntry* entry = m_impl->find(key);
+    if (not entry) {
+        return defaultValue;
+    }
+    sol::state_view lua(s);
+    sol::object obj = toLua(lua, StoredValue{
+        entry->typeId,
+        m_impl->decode(*entry)
+    });
+    if (obj.valid()) {
+        return obj;
+    }
+    else {
+        return defaultValue;
+    }
+}
+
+
+StorageView
+StorageView::view(
+    const std::string& key
+) const {
+    const ViewEntry* entry = m_impl->find(key);
+    if (not entry or entry->typeId != TypeInfo<StorageContainer>::Id) {
+        return StorageView();
+    }
+    return StorageView(std::make_shared<Implementation>(
+        m_impl->m_source,
+        ByteReader(entry->begin, entry->end).readSized()
+    ));
+}
@@ -8,6 +8,8 @@
 #include <OgrePlane.h>
 #include <OgreQuaternion.h>
 #include <OgreVector3.h>
+#include <list>
+#include <memory>
 #include <string>
 #include <map>
 #include <vector>
@@ -32,6 +34,10 @@ namespace thrive {
 
 /**
 * @brief A key-value storage for serialization
+*
+* Copies share their content until one of them is modified (copy-on-write),
+* so containers can be passed around and returned by value freely. Moved-from
+* containers are empty.
 */
 class StorageContainer {
 
@@ -55,6 +61,8 @@ public:
     /**
     * @brief Copy-constructor
     *
+    * Shares the content of \a other until either is modified.
+    *
     * @param other
     */
     StorageContainer(
@@ -64,6 +72,8 @@ public:
     /**
     * @brief Move-constructor
     *
+    * Takes over the content of \a other, which is left empty.
+    *
     * @param other
     */
     StorageContainer(
@@ -116,6 +126,15 @@ public:
         return false;
     }
 
+    /**
+    * @brief Number of times any container's content was actually copied
+    *
+    * Counts copy-on-write detaches of non-empty content. Meant for tests and
+    * profiling.
+    */
+    static size_t
+    contentCopies();
+
     /**
     * @brief Checks for a key
     *
@@ -147,6 +166,16 @@ public:
         const std::string& key
     ) const;
 
+    /**
+    * @brief Hash of the content
+    *
+    * Containers with equal keys and values have equal hashes, regardless of
+    * the order the values were set in. The hash is only meant to be compared
+    * within one run.
+    */
+    size_t
+    contentHash() const;
+
     /**
     * @brief Retrieves a value from the container
     *
@@ -223,13 +252,33 @@ public:
 
 private:
 
+    friend class StorageSerializer;
+
     struct Implementation;
-    std::unique_ptr<Implementation> m_impl;
+
+    /**
+    * @brief The implementation shared by all empty containers
+    */
+    static std::shared_ptr<Implementation>
+    emptyImplementation();
+
+    /**
+    * @brief Gives this container its own copy of the content before it is
+    * modified
+    */
+    void
+    detach();
+
+    std::shared_ptr<Implementation> m_impl;
 };
 
 /**
 * @brief Output stream operator for StorageContainer
 *
+* Writes the binary savegame format. Floating point numbers are stored as
+* their raw IEEE bits, vectors and quaternions inline and every key only once
+* per stream.
+*
 * @param stream
 * @param storage
 *
@@ -244,6 +293,10 @@ operator << (
 /**
 * @brief Input stream operator for StorageContainer
 *
+* Reads both the binary format and the format of older savegames.
+*
+* @throws std::runtime_error if the data uses an unknown version or type
+*
 * @param stream
 * @param storage
 *
@@ -347,6 +400,168 @@ public:
 
 };
 
+/**
+* @brief Read only view into an encoded savegame
+*
+* Unlike operator>>, a view doesn't decode the whole tree up front. Opening
+* a view only indexes the keys and offsets of one container. Values are
+* decoded when get() touches them, nested containers and lists are indexed
+* when view() or list() opens them.
+*
+* Files are memory mapped. Compressed savegames are decompressed into
+* memory and savegames in the format used before the binary one are
+* decoded completely when opened. Views are meant for reading parts of a
+* file, like the metadata of saved creations. To decode a whole file, use
+* operator>>, which doesn't index it first.
+*
+* Views are cheap to copy and keep the underlying data alive.
+*/
+class StorageView {
+
+public:
+
+    /**
+    * @brief Lua bindings
+    *
+    * - StorageView::open
+    * - StorageView::contains
+    * - StorageView::decode
+    * - StorageView::get
+    * - StorageView::view
+    *
+    */
+    static void luaBindings(sol::state &lua);
+
+    /**
+    * @brief Views encoded data in memory
+    *
+    * @param data
+    *   Data written by operator<<
+    */
+    static StorageView
+    fromBuffer(
+        std::string data
+    );
+
+    /**
+    * @brief Views a savegame file
+    *
+    * @param filename
+    *   The file to map
+    *
+    * @throws std::runtime_error if the file can't be mapped or is corrupt
+    */
+    static StorageView
+    open(
+        const std::string& filename
+    );
+
+    /**
+    * @brief Constructs an empty view
+    */
+    StorageView();
+
+    /**
+    * @brief Checks for a key
+    */
+    bool
+    contains(
+        const std::string& key
+    ) const;
+
+    /**
+    * @brief Checks for a key together with type
+    *
+    * @see StorageContainer::contains
+    */
+    template<typename T>
+    bool
+    contains(
+        const std::string& key
+    ) const;
+
+    /**
+    * @brief Decodes the viewed container completely
+    */
+    StorageContainer
+    decode() const;
+
+    /**
+    * @brief Decodes a single value
+    *
+    * @see StorageContainer::get
+    */
+    template<typename T>
+    T
+    get(
+        const std::string& key,
+        const T& defaultValue = T()
+    ) const;
+
+    /**
+    * @brief Returns a list of all keys in the viewed container
+    */
+    std::list<std::string>
+    keys() const;
+
+    /**
+    * @brief Views the elements of a list
+    *
+    * @param key
+    *   The list's key
+    *
+    * @return
+    *   One view per element, empty if there is no list under \a key
+    */
+    std::vector<StorageView>
+    list(
+        const std::string& key
+    ) const;
+
+    /**
+    * @brief Lua version of StorageView::get
+    */
+    sol::object luaGet(
+        const std::string& key,
+        sol::object defaultValue,
+        sol::this_state s
+    ) const;
+
+    /**
+    * @brief Views a nested container
+    *
+    * @param key
+    *   The container's key
+    *
+    * @return
+    *   The nested view, empty if there is no container under \a key
+    */
+    StorageView
+    view(
+        const std::string& key
+    ) const;
+
+private:
+
+    struct Implementation;
+
+    struct Source;
+
+    static StorageView
+    fromSource(
+        std::shared_ptr<Source> source,
+        const char* begin,
+        const char* end
+    );
+
+    StorageView(
+        std::shared_ptr<const Implementation> impl
+    );
+
+    std::shared_ptr<const Implementation> m_impl;
+
+};
+
 /**
 * @brief Macro for declaring a new storable type
 *
@@ -373,7 +588,20 @@ public:
     StorageContainer::set<typeName>( \
         const std::string& key, \
         typeName value \
-    );
+    ); \
+    \
+    template<> \
+    bool \
+    StorageView::contains<typeName>( \
+        const std::string& key \
+    ) const; \
+    \
+    template<> \
+    typeName \
+    StorageView::get<typeName>( \
+        const std::string& key, \
+        const typeName& defaultValue \
+    ) const;
 
 // Native types
 STORABLE_TYPE(bool)
@@ -39,6 +39,10 @@ struct System::Implementation {
 
     std::string m_name = "Unknown-System";
 
+    std::vector<ComponentTypeId> m_reads;
+
+    std::vector<ComponentTypeId> m_writes;
+
 
 };
 
@@ -64,6 +68,22 @@ System::deactivate() {
 }
 
 
+void
+System::declareRead(
+    ComponentTypeId typeId
+) {
+    m_impl->m_reads.push_back(typeId);
+}
+
+
+void
+System::declareWrite(
+    ComponentTypeId typeId
+) {
+    m_impl->m_writes.push_back(typeId);
+}
+
+
 bool
 System::enabled() const {
     return m_impl->m_enabled;
@@ -86,6 +106,24 @@ System::gameState() const {
 }
 
 
+bool
+System::hasDeclaredAccess() const {
+    return not m_impl->m_reads.empty() or not m_impl->m_writes.empty();
+}
+
+
+const std::vector<ComponentTypeId>&
+System::readComponents() const {
+    return m_impl->m_reads;
+}
+
+
+const std::vector<ComponentTypeId>&
+System::writtenComponents() const {
+    return m_impl->m_writes;
+}
+
+
 void
 System::init(
     GameStateData* gameState
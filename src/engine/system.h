@@ -1,7 +1,11 @@
 
 #pragma once
 
+#include "engine/typedefs.h"
+
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace sol {
 class state;
@@ -68,6 +72,27 @@ public:
     virtual void
     deactivate();
 
+    /**
+    * @brief Whether this system declared the components it accesses
+    *
+    * Only systems with declared access may run in parallel to other
+    * systems, see SystemScheduler.
+    */
+    bool
+    hasDeclaredAccess() const;
+
+    /**
+    * @brief The component types this system only reads
+    */
+    const std::vector<ComponentTypeId>&
+    readComponents() const;
+
+    /**
+    * @brief The component types this system modifies
+    */
+    const std::vector<ComponentTypeId>&
+    writtenComponents() const;
+
     /**
     * @brief Whether this system is enabled
     *
@@ -175,6 +200,35 @@ public:
         int logicTime
     ) = 0;
 
+protected:
+
+    /**
+    * @brief Declares that update() reads components of a type
+    *
+    * Call this (and declareWrite()) in the constructor of systems whose
+    * update() is safe to run in parallel to other systems. Such an update()
+    * may only touch the declared component types, may queue removals but
+    * must not add components or entities.
+    *
+    * @param typeId
+    *   The component type
+    */
+    void
+    declareRead(
+        ComponentTypeId typeId
+    );
+
+    /**
+    * @brief Declares that update() modifies components of a type
+    *
+    * @param typeId
+    *   The component type
+    */
+    void
+    declareWrite(
+        ComponentTypeId typeId
+    );
+
 private:
 
     struct Implementation;
@@ -0,0 +1,165 @@
+#include "engine/system_scheduler.h"
+
+#include "engine/system.h"
+#include "engine/thread_pool.h"
+#include "scripting/luajit.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+using namespace thrive;
+
+
+void
+SystemScheduler::luaBindings(
+    sol::state &lua
+){
+    lua.new_usertype<SystemScheduler>("SystemScheduler",
+
+        sol::constructors<sol::types<>>(),
+
+        "addSystem", &SystemScheduler::addSystem,
+        "stageCount", &SystemScheduler::stageCount,
+        "update", &SystemScheduler::update
+    );
+}
+
+
+namespace {
+
+bool
+contains(
+    const std::vector<ComponentTypeId>& types,
+    ComponentTypeId typeId
+) {
+    return std::find(types.begin(), types.end(), typeId) != types.end();
+}
+
+
+bool
+conflicts(
+    const System& first,
+    const System& second
+) {
+    for (ComponentTypeId typeId : first.writtenComponents()) {
+        if (contains(second.readComponents(), typeId) or
+            contains(second.writtenComponents(), typeId)
+        ) {
+            return true;
+        }
+    }
+    for (ComponentTypeId typeId : second.writtenComponents()) {
+        if (contains(first.readComponents(), typeId)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+
+struct SystemScheduler::Implementation {
+
+    Implementation(
+        ThreadPool& threadPool
+    ) : m_threadPool(threadPool)
+    {
+    }
+
+    bool
+    fitsIntoLastStage(
+        const System& system
+    ) const {
+        if (m_stages.empty() or not system.hasDeclaredAccess()) {
+            return false;
+        }
+        const std::vector<System*>& stage = m_stages.back();
+        for (System* other : stage) {
+            if (not other->hasDeclaredAccess() or conflicts(system, *other)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void
+    updateStage(
+        const std::vector<System*>& stage,
+        int renderTime,
+        int logicTime
+    ) {
+        m_tasks.clear();
+        for (System* system : stage) {
+            m_tasks.emplace_back([system, renderTime, logicTime] {
+                system->update(renderTime, logicTime);
+            });
+        }
+        m_threadPool.run(m_tasks);
+    }
+
+    std::vector<std::vector<System*>> m_stages;
+
+    std::vector<ThreadPool::Task> m_tasks;
+
+    ThreadPool& m_threadPool;
+
+};
+
+
+SystemScheduler::SystemScheduler()
+  : m_impl(new Implementation(ThreadPool::global()))
+{
+}
+
+
+SystemScheduler::SystemScheduler(
+    ThreadPool& threadPool
+) : m_impl(new Implementation(threadPool))
+{
+}
+
+
+SystemScheduler::~SystemScheduler() {}
+
+
+void
+SystemScheduler::addSystem(
+    System* system
+) {
+    if (not system) {
+        throw std::runtime_error("SystemScheduler::addSystem expects a system");
+    }
+    if (m_impl->fitsIntoLastStage(*system)) {
+        m_impl->m_stages.back().push_back(system);
+    }
+    else {
+        m_impl->m_stages.push_back({system});
+    }
+}
+
+
+size_t
+SystemScheduler::stageCount() const {
+    return m_impl->m_stages.size();
+}
+
+
+const std::vector<System*>&
+SystemScheduler::stage(
+    size_t index
+) const {
+    return m_impl->m_stages.at(index);
+}
+
+
+void
+SystemScheduler::update(
+    int renderTime,
+    int logicTime
+) {
+    for (const auto& stage : m_impl->m_stages) {
+        m_impl->updateStage(stage, renderTime, logicTime);
+    }
+}
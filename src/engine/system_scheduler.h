@@ -0,0 +1,120 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+namespace sol {
+class state;
+}
+
+namespace thrive {
+
+class System;
+class ThreadPool;
+
+/**
+* @brief Updates a sequence of C++ systems, in parallel where possible
+*
+* Systems are grouped into stages in the order they were added. A system
+* joins the current stage if it declared its component access (see
+* System::declareRead()) and its access doesn't conflict with any other
+* system in the stage. Two systems conflict if one of them writes a
+* component type the other one reads or writes. Systems that didn't
+* declare their access get a stage of their own.
+*
+* The systems of a stage are updated in parallel on a ThreadPool; stages
+* run one after another. A stage with a single system is updated on the
+* calling thread.
+*/
+class SystemScheduler {
+
+public:
+
+    /**
+    * @brief Lua bindings
+    *
+    * Exposes:
+    * - SystemScheduler::new
+    * - SystemScheduler::addSystem
+    * - SystemScheduler::stageCount
+    * - SystemScheduler::update
+    *
+    */
+    static void
+    luaBindings(sol::state &lua);
+
+    /**
+    * @brief Constructor
+    *
+    * Uses ThreadPool::global()
+    */
+    SystemScheduler();
+
+    /**
+    * @brief Constructor
+    *
+    * @param threadPool
+    *   The pool to run parallel stages on. Must outlive the scheduler.
+    */
+    explicit SystemScheduler(
+        ThreadPool& threadPool
+    );
+
+    /**
+    * @brief Destructor
+    */
+    ~SystemScheduler();
+
+    /**
+    * @brief Appends a system
+    *
+    * @param system
+    *   The system to add. Not owned, must outlive the scheduler.
+    */
+    void
+    addSystem(
+        System* system
+    );
+
+    /**
+    * @brief The number of stages the systems are grouped into
+    */
+    size_t
+    stageCount() const;
+
+    /**
+    * @brief The systems of a stage, in the order they were added
+    *
+    * @param index
+    *   The stage's index, less than stageCount()
+    *
+    * @throws std::out_of_range
+    *   If there is no such stage
+    */
+    const std::vector<System*>&
+    stage(
+        size_t index
+    ) const;
+
+    /**
+    * @brief Updates all systems, stage by stage
+    *
+    * @param renderTime
+    *   Passed on to System::update()
+    * @param logicTime
+    *   Passed on to System::update()
+    */
+    void
+    update(
+        int renderTime,
+        int logicTime
+    );
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
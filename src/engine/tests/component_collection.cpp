@@ -0,0 +1,91 @@
+#include "engine/component_collection.h"
+
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+using MapComponent = TestComponent<20>;
+using DenseComponent = TestComponent<21>;
+
+static void
+testCollection(
+    ComponentTypeId typeId
+) {
+    EntityManager entityManager;
+    auto& collection = entityManager.getComponentCollection(typeId);
+    std::vector<EntityId> entities;
+    for (int i = 0; i < 100; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entities.push_back(entityId);
+        if (typeId == MapComponent::TYPE_ID) {
+            entityManager.addComponent(entityId, make_unique<MapComponent>());
+        }
+        else {
+            entityManager.addComponent(entityId, make_unique<DenseComponent>());
+        }
+    }
+    EXPECT_EQ(100u, collection.size());
+    // Remove every other entity
+    for (size_t i = 0; i < entities.size(); i += 2) {
+        entityManager.removeComponent(entities[i], typeId);
+    }
+    entityManager.processRemovals();
+    EXPECT_EQ(50u, collection.size());
+    for (size_t i = 0; i < entities.size(); ++i) {
+        Component* component = collection.get(entities[i]);
+        if (i % 2 == 0) {
+            EXPECT_EQ(nullptr, component);
+        }
+        else {
+            ASSERT_NE(nullptr, component);
+            EXPECT_EQ(entities[i], component->owner());
+        }
+    }
+    // Packed arrays must stay consistent after swap-and-pop
+    for (size_t i = 0; i < collection.size(); ++i) {
+        EXPECT_EQ(collection.entities()[i], collection.components()[i]->owner());
+        EXPECT_EQ(collection.components()[i].get(), collection.get(collection.entities()[i]));
+    }
+}
+
+
+TEST(ComponentCollection, MapStorage) {
+    EXPECT_EQ(
+        ComponentCollection::Storage::Map,
+        ComponentCollection::defaultStorage(MapComponent::TYPE_ID)
+    );
+    testCollection(MapComponent::TYPE_ID);
+}
+
+
+TEST(ComponentCollection, DenseStorage) {
+    ComponentCollection::setDefaultStorage(
+        DenseComponent::TYPE_ID,
+        ComponentCollection::Storage::Dense
+    );
+    EntityManager entityManager;
+    EXPECT_EQ(
+        ComponentCollection::Storage::Dense,
+        entityManager.getComponentCollection(DenseComponent::TYPE_ID).storage()
+    );
+    testCollection(DenseComponent::TYPE_ID);
+}
+
+
+TEST(ComponentCollection, Overwrite) {
+    ComponentCollection::setDefaultStorage(
+        DenseComponent::TYPE_ID,
+        ComponentCollection::Storage::Dense
+    );
+    EntityManager entityManager;
+    auto& collection = entityManager.getComponentCollection(DenseComponent::TYPE_ID);
+    EntityId entityId = entityManager.generateNewId();
+    entityManager.addComponent(entityId, make_unique<DenseComponent>());
+    auto second = entityManager.addComponent(entityId, make_unique<DenseComponent>());
+    EXPECT_EQ(1u, collection.size());
+    EXPECT_EQ(second, collection.get(entityId));
+}
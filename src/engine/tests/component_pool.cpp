@@ -0,0 +1,74 @@
+#include "engine/component_pool.h"
+
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+#include <set>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+class PooledComponent : public TestComponent<30> {
+    COMPONENT_POOL_ALLOCATION
+
+public:
+
+    double m_payload[5] = {};
+
+};
+
+class DerivedPooledComponent : public PooledComponent {
+
+public:
+
+    double m_morePayload[8] = {};
+
+};
+
+} // namespace
+
+
+TEST(ComponentPool, RecyclesBlocks) {
+    ComponentPool pool;
+    void* first = pool.allocate(40);
+    EXPECT_LE(40u, pool.blockSize());
+    EXPECT_EQ(0u, pool.blockSize() % alignof(std::max_align_t));
+    pool.deallocate(first, 40);
+    EXPECT_EQ(0u, pool.usedBlocks());
+    // Freed blocks are handed out again
+    EXPECT_EQ(first, pool.allocate(40));
+    // Other sizes bypass the pool
+    void* other = pool.allocate(100);
+    EXPECT_EQ(1u, pool.usedBlocks());
+    pool.deallocate(other, 100);
+    pool.deallocate(first, 40);
+}
+
+
+TEST(ComponentPool, ComponentAllocation) {
+    ComponentPool& pool = PooledComponent::COMPONENT_POOL();
+    std::set<void*> addresses;
+    {
+        std::vector<std::unique_ptr<Component>> components;
+        for (int i = 0; i < 100; ++i) {
+            components.push_back(make_unique<PooledComponent>());
+            addresses.insert(components.back().get());
+        }
+        EXPECT_EQ(100u, pool.usedBlocks());
+        // Derived classes of other sizes don't use the pool
+        components.push_back(make_unique<DerivedPooledComponent>());
+        EXPECT_EQ(100u, pool.usedBlocks());
+    }
+    EXPECT_EQ(0u, pool.usedBlocks());
+    size_t capacity = pool.capacity();
+    // Recreating reuses the same memory
+    std::vector<std::unique_ptr<Component>> components;
+    for (int i = 0; i < 100; ++i) {
+        components.push_back(make_unique<PooledComponent>());
+        EXPECT_EQ(1u, addresses.count(components.back().get()));
+    }
+    EXPECT_EQ(capacity, pool.capacity());
+}
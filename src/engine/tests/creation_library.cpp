@@ -0,0 +1,127 @@
+#include "engine/creation_library.h"
+
+#include "engine/serialization.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace thrive;
+namespace fs = boost::filesystem;
+
+namespace {
+
+std::string
+writeCreation(
+    const fs::path& directory,
+    const std::string& name,
+    const std::string& speciesName,
+    int organelleCount
+) {
+    StorageList organelles;
+    for (int i = 0; i < organelleCount; ++i) {
+        StorageContainer organelle;
+        organelle.set<int32_t>("q", i);
+        organelles.append(std::move(organelle));
+    }
+    StorageContainer microbe;
+    microbe.set<std::string>("typename", "MicrobeComponent");
+    microbe.set("speciesName", speciesName);
+    microbe.set("organelles", std::move(organelles));
+    StorageList components;
+    components.append(StorageContainer());
+    components.append(std::move(microbe));
+    StorageContainer creation;
+    creation.set("components", std::move(components));
+    creation.set<std::string>("thriveversion", "0.3.0");
+    std::string file = (directory / (name + ".microbe")).string();
+    std::ofstream stream(file, std::ofstream::trunc | std::ofstream::binary);
+    stream << creation;
+    return file;
+}
+
+}
+
+
+TEST(CreationLibrary, Query) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    writeCreation(directory, "b", "Beta", 3);
+    std::string fileA = writeCreation(directory, "a", "Alpha", 1);
+    writeCreation(directory, "c", "Gamma", 0);
+    std::ofstream((directory / "a.png").string()) << "png";
+    std::ofstream((directory / "notes.txt").string()) << "not a creation";
+    CreationLibrary library(directory.string(), "microbe");
+    ASSERT_EQ(3u, library.size());
+    auto entries = library.query(0, 2);
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ("a", entries[0].name);
+    EXPECT_EQ(fileA, entries[0].file);
+    EXPECT_EQ("Alpha", entries[0].speciesName);
+    EXPECT_EQ(1u, entries[0].organelleCount);
+    EXPECT_EQ("0.3.0", entries[0].thriveVersion);
+    EXPECT_EQ((directory / "a.png").string(), entries[0].thumbnail);
+    EXPECT_EQ(fs::file_size(fileA), entries[0].size);
+    EXPECT_EQ("b", entries[1].name);
+    EXPECT_EQ(3u, entries[1].organelleCount);
+    EXPECT_TRUE(entries[1].thumbnail.empty());
+    entries = library.query(2, 2);
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("Gamma", entries[0].speciesName);
+    EXPECT_TRUE(library.query(3, 2).empty());
+    fs::remove_all(directory);
+    fs::remove(directory.string() + ".index");
+}
+
+
+TEST(CreationLibrary, ReusesIndex) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    std::string file = writeCreation(directory, "a", "Alpha", 2);
+    {
+        CreationLibrary library(directory.string(), "microbe");
+        ASSERT_EQ(1u, library.size());
+    }
+    ASSERT_TRUE(fs::exists(directory.string() + ".index"));
+    // Unparseable, but with the indexed size and modification time
+    std::time_t modified = fs::last_write_time(file);
+    uintmax_t size = fs::file_size(file);
+    std::ofstream(file, std::ofstream::trunc) << std::string(size, 'x');
+    fs::last_write_time(file, modified);
+    CreationLibrary library(directory.string(), "microbe");
+    auto entries = library.query(0, 10);
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("Alpha", entries[0].speciesName);
+    EXPECT_EQ(2u, entries[0].organelleCount);
+    fs::remove_all(directory);
+    fs::remove(directory.string() + ".index");
+}
+
+
+TEST(CreationLibrary, UpdateAndRefresh) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    std::string fileA = writeCreation(directory, "a", "Alpha", 1);
+    CreationLibrary library(directory.string(), "microbe");
+    ASSERT_EQ(1u, library.size());
+    // Overwritten in place
+    writeCreation(directory, "a", "Alpha", 4);
+    std::string fileB = writeCreation(directory, "b", "Beta", 2);
+    library.update(fileA);
+    library.update(fileB);
+    auto entries = library.query(0, 10);
+    ASSERT_EQ(2u, entries.size());
+    EXPECT_EQ(4u, entries[0].organelleCount);
+    EXPECT_EQ("Beta", entries[1].speciesName);
+    fs::remove(fileA);
+    library.refresh();
+    entries = library.query(0, 10);
+    ASSERT_EQ(1u, entries.size());
+    EXPECT_EQ("b", entries[0].name);
+    // The index follows the directory
+    CreationLibrary reopened(directory.string(), "microbe");
+    ASSERT_EQ(1u, reopened.size());
+    EXPECT_EQ("Beta", reopened.query(0, 1)[0].speciesName);
+    fs::remove_all(directory);
+    fs::remove(directory.string() + ".index");
+}
@@ -0,0 +1,72 @@
+#include "engine/entity_command_buffer.h"
+
+#include "engine/entity_filter.h"
+#include "engine/entity_manager.h"
+#include "engine/tests/test_component.h"
+#include "engine/thread_pool.h"
+#include "util/make_unique.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+
+TEST(EntityCommandBuffer, Playback) {
+    EntityManager entityManager;
+    EntityId existing = entityManager.generateNewId();
+    entityManager.addComponent(existing, make_unique<TestComponent<0>>());
+    EntityCommandBuffer commands;
+    EXPECT_TRUE(commands.empty());
+    auto created = commands.createEntity();
+    commands.addComponent(created, make_unique<TestComponent<0>>());
+    commands.addComponent(existing, make_unique<TestComponent<1>>());
+    commands.removeComponent(existing, TestComponent<0>::TYPE_ID);
+    EXPECT_FALSE(commands.empty());
+    // Nothing happens before playback
+    EXPECT_EQ(nullptr, entityManager.getComponent(existing, TestComponent<1>::TYPE_ID));
+    std::vector<EntityId> createdIds = commands.playback(entityManager);
+    EXPECT_TRUE(commands.empty());
+    ASSERT_EQ(1u, createdIds.size());
+    auto component = entityManager.getComponent(createdIds[0], TestComponent<0>::TYPE_ID);
+    ASSERT_NE(nullptr, component);
+    EXPECT_EQ(createdIds[0], component->owner());
+    EXPECT_NE(nullptr, entityManager.getComponent(existing, TestComponent<1>::TYPE_ID));
+    entityManager.processRemovals();
+    EXPECT_EQ(nullptr, entityManager.getComponent(existing, TestComponent<0>::TYPE_ID));
+}
+
+
+TEST(EntityCommandBuffer, DeterministicParallelPlayback) {
+    using TestFilter = EntityFilter<TestComponent<0>>;
+    // Each source entity spawns a child. The children's ids must not depend
+    // on the thread scheduling.
+    auto spawn = [](size_t threadCount) {
+        EntityManager entityManager;
+        std::vector<EntityId> sources;
+        for (int i = 0; i < 100; ++i) {
+            EntityId entityId = entityManager.generateNewId();
+            entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+            sources.push_back(entityId);
+        }
+        TestFilter filter;
+        filter.setEntityManager(&entityManager);
+        ThreadPool threadPool(threadCount);
+        filter.parallelForEachDeferred(threadPool, [](const TestFilter::EntityMap::value_type&, EntityCommandBuffer& commands) {
+            auto child = commands.createEntity();
+            commands.addComponent(child, make_unique<TestComponent<1>>());
+        }, 3);
+        filter.setEntityManager(nullptr);
+        std::vector<EntityId> children;
+        for (EntityId entityId : entityManager.entities()) {
+            if (entityManager.getComponent(entityId, TestComponent<1>::TYPE_ID)) {
+                children.push_back(entityId);
+            }
+        }
+        std::sort(children.begin(), children.end());
+        return children;
+    };
+    std::vector<EntityId> sequential = spawn(0);
+    EXPECT_EQ(100u, sequential.size());
+    EXPECT_EQ(sequential, spawn(4));
+}
@@ -212,3 +212,70 @@ TEST(EntityFilter, Record) {
 }
 
 
+
+TEST(EntityFilter, SortedContiguous) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>,
+        Optional<TestComponent<1>>
+    >;
+    std::vector<EntityId> entities;
+    for (int i = 0; i < 10; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entities.push_back(entityId);
+        entityManager.addComponent(
+            entityId,
+            make_unique<TestComponent<0>>()
+        );
+    }
+    TestFilter filter;
+    filter.setEntityManager(&entityManager);
+    // Remove an entity from the middle, then re-add it. The optional
+    // component keeps the entity alive in between.
+    entityManager.addComponent(
+        entities[4],
+        make_unique<TestComponent<1>>()
+    );
+    entityManager.removeComponent(entities[4], TestComponent<0>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_EQ(9u, filter.entities().size());
+    entityManager.addComponent(
+        entities[4],
+        make_unique<TestComponent<0>>()
+    );
+    ASSERT_EQ(10u, filter.entities().size());
+    // Iteration is ordered by entity id over one packed range
+    const auto* first = &*filter.begin();
+    size_t index = 0;
+    for (const auto& value : filter) {
+        EXPECT_EQ(entities[index], value.first);
+        EXPECT_EQ(first + index, &value);
+        ++index;
+    }
+    filter.setEntityManager(nullptr);
+}
+
+
+TEST(EntityFilter, ParallelForEach) {
+    EntityManager entityManager;
+    using TestFilter = EntityFilter<
+        TestComponent<0>
+    >;
+    for (int i = 0; i < 1000; ++i) {
+        entityManager.addComponent(
+            entityManager.generateNewId(),
+            make_unique<TestComponent<0>>()
+        );
+    }
+    TestFilter filter;
+    filter.setEntityManager(&entityManager);
+    ThreadPool threadPool(3);
+    std::vector<int> visits(filter.entities().size(), 0);
+    const auto* first = filter.entities().data();
+    filter.parallelForEach(threadPool, [&visits, first](const TestFilter::EntityMap::value_type& value) {
+        // Every entry is visited exactly once
+        visits[&value - first] += 1;
+    }, 7);
+    EXPECT_EQ(std::vector<int>(visits.size(), 1), visits);
+    filter.setEntityManager(nullptr);
+}
@@ -0,0 +1,361 @@
+#include "engine/entity_manager.h"
+
+#include "engine/component_factory.h"
+#include "engine/serialization.h"
+#include "engine/tests/test_component.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+TEST(EntityManager, Exists) {
+    EntityManager entityManager;
+    EXPECT_FALSE(entityManager.exists(NULL_ENTITY));
+    EntityId entityId = entityManager.generateNewId();
+    EXPECT_NE(NULL_ENTITY, entityId);
+    // No components yet
+    EXPECT_TRUE(entityManager.isValid(entityId));
+    EXPECT_FALSE(entityManager.exists(entityId));
+    entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+    EXPECT_TRUE(entityManager.exists(entityId));
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entityId));
+    EXPECT_FALSE(entityManager.isValid(entityId));
+}
+
+
+TEST(EntityManager, RecyclesSlots) {
+    EntityManager entityManager;
+    EntityId first = entityManager.generateNewId();
+    entityManager.addComponent(first, make_unique<TestComponent<0>>());
+    entityManager.removeComponent(first, TestComponent<0>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(first));
+    // Removed entities can't be brought back
+    EXPECT_THROW(
+        entityManager.addComponent(first, make_unique<TestComponent<0>>()),
+        std::runtime_error
+    );
+    // The freed slot is reused with a new generation
+    EntityId second = entityManager.generateNewId();
+    EXPECT_EQ(entityIndex(first), entityIndex(second));
+    EXPECT_NE(first, second);
+    entityManager.addComponent(second, make_unique<TestComponent<0>>());
+    EXPECT_TRUE(entityManager.exists(second));
+    EXPECT_FALSE(entityManager.exists(first));
+    EXPECT_EQ(nullptr, entityManager.getComponent(first, TestComponent<0>::TYPE_ID));
+    // Stale ids can't touch the new entity
+    EXPECT_THROW(
+        entityManager.addComponent(first, make_unique<TestComponent<1>>()),
+        std::runtime_error
+    );
+}
+
+
+TEST(EntityManager, NamedIdSurvivesUntilRemoved) {
+    EntityManager entityManager;
+    EntityId named = entityManager.getNamedId("named");
+    EXPECT_EQ(named, entityManager.getNamedId("named"));
+    entityManager.addComponent(named, make_unique<TestComponent<0>>());
+    EXPECT_EQ(named, entityManager.getNamedId("named"));
+    entityManager.removeEntity(named);
+    entityManager.processRemovals();
+    EntityId renamed = entityManager.getNamedId("named");
+    EXPECT_NE(named, renamed);
+    EXPECT_TRUE(entityManager.isValid(renamed));
+}
+
+
+TEST(EntityManager, BatchedRemovals) {
+    EntityManager entityManager;
+    std::vector<EntityId> entities;
+    for (int i = 0; i < 10; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+        if (i % 2 == 0) {
+            entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+        }
+        entities.push_back(entityId);
+    }
+    // Children go with their parent
+    entityManager.addChild(entities[1], entities[0]);
+    for (int i = 0; i < 10; i += 2) {
+        entityManager.removeComponent(entities[i], TestComponent<0>::TYPE_ID);
+        // Duplicate requests are harmless
+        entityManager.removeComponent(entities[i], TestComponent<0>::TYPE_ID);
+    }
+    entityManager.removeEntity(entities[0]);
+    entityManager.removeEntity(entities[9]);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entities[0]));
+    EXPECT_FALSE(entityManager.exists(entities[1]));
+    EXPECT_FALSE(entityManager.exists(entities[9]));
+    for (int i = 2; i < 9; ++i) {
+        EXPECT_TRUE(entityManager.exists(entities[i]));
+        bool hasFirst = entityManager.getComponent(
+            entities[i],
+            TestComponent<0>::TYPE_ID
+        ) != nullptr;
+        EXPECT_EQ(i % 2 == 1, hasFirst);
+    }
+    // Removing the last component removes the entity
+    entityManager.removeComponent(entities[2], TestComponent<1>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.exists(entities[2]));
+}
+
+
+TEST(EntityManager, ComponentSignature) {
+    EntityManager entityManager;
+    ComponentSignature both;
+    both.set(entityManager.componentBit(TestComponent<0>::TYPE_ID));
+    both.set(entityManager.componentBit(TestComponent<1>::TYPE_ID));
+    EntityId entityId = entityManager.generateNewId();
+    EXPECT_TRUE(entityManager.componentSignature(entityId).none());
+    entityManager.addComponent(entityId, make_unique<TestComponent<0>>());
+    EXPECT_FALSE(entityManager.hasComponents(entityId, both));
+    entityManager.addComponent(entityId, make_unique<TestComponent<1>>());
+    EXPECT_TRUE(entityManager.hasComponents(entityId, both));
+    entityManager.removeComponent(entityId, TestComponent<1>::TYPE_ID);
+    entityManager.processRemovals();
+    EXPECT_FALSE(entityManager.hasComponents(entityId, both));
+    EXPECT_TRUE(entityManager.componentSignature(entityId).test(
+        entityManager.componentBit(TestComponent<0>::TYPE_ID)
+    ));
+    entityManager.removeEntity(entityId);
+    entityManager.processRemovals();
+    EXPECT_TRUE(entityManager.componentSignature(entityId).none());
+}
+
+
+namespace {
+
+template<int ID>
+class ValueComponent : public Component {
+
+public:
+
+    static ComponentTypeId TYPE_ID;
+
+    static const std::string&
+    TYPE_NAME() {
+        static std::string string = "ValueComponent" + std::to_string(ID);
+        return string;
+    }
+
+    ComponentTypeId
+    typeId() const override {
+        return TYPE_ID;
+    }
+
+    std::string
+    typeName() const override {
+        return TYPE_NAME();
+    }
+
+    void
+    load(
+        const StorageContainer& storage
+    ) override {
+        Component::load(storage);
+        value = storage.get<int32_t>("value");
+    }
+
+    StorageContainer
+    storage() const override {
+        StorageContainer storage = Component::storage();
+        storage.set<int32_t>("value", value);
+        return storage;
+    }
+
+    int32_t value = 0;
+
+};
+
+template<int ID>
+ComponentTypeId ValueComponent<ID>::TYPE_ID = NULL_COMPONENT_TYPE;
+
+/**
+* @brief Registers ValueComponent<ID> with \a factory only, like a Lua
+* component type
+*/
+template<int ID>
+void
+registerLocally(
+    ComponentFactory& factory
+) {
+    ValueComponent<ID>::TYPE_ID = factory.registerComponentType(
+        ValueComponent<ID>::TYPE_NAME(),
+        [](const StorageContainer& storage) {
+            std::unique_ptr<Component> component = make_unique<ValueComponent<ID>>();
+            component->load(storage);
+            return component;
+        }
+    );
+}
+
+/**
+* @brief Registers ValueComponent<ID> for all factories
+*/
+template<int ID>
+void
+registerGlobally() {
+    static ComponentTypeId typeId =
+        ComponentFactory::registerGlobalComponentType<ValueComponent<ID>>();
+    ValueComponent<ID>::TYPE_ID = typeId;
+}
+
+/**
+* @brief Registers ValueComponent<ID> for all factories as thread safe
+*/
+template<int ID>
+void
+registerThreadSafe() {
+    static ComponentTypeId typeId =
+        ComponentFactory::registerThreadSafeComponentType<ValueComponent<ID>>(
+            ComponentCollection::Storage::Dense
+        );
+    ValueComponent<ID>::TYPE_ID = typeId;
+}
+
+template<int ID>
+void
+addValueComponent(
+    EntityManager& entityManager,
+    EntityId entityId,
+    int32_t value
+) {
+    auto component = make_unique<ValueComponent<ID>>();
+    component->setOwner(entityId);
+    component->value = value;
+    entityManager.addComponent(entityId, std::move(component));
+}
+
+} // namespace
+
+
+TEST(EntityManager, Delta) {
+    ComponentFactory factory;
+    registerLocally<0>(factory);
+    EntityManager entityManager;
+    std::vector<EntityId> entities;
+    for (int i = 0; i < 10; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        addValueComponent<0>(entityManager, entityId, i);
+        entities.push_back(entityId);
+    }
+    EXPECT_THROW(entityManager.delta(factory), std::logic_error);
+    StorageContainer snapshot = entityManager.snapshot(factory);
+    // Nothing changed yet
+    StorageContainer delta = entityManager.delta(factory);
+    EXPECT_TRUE(delta.get<StorageContainer>("collections").keys().empty());
+    EXPECT_TRUE(delta.get<StorageList>("removedComponents").empty());
+    // Change one, remove one, add one
+    entityManager.getComponent<ValueComponent<0>>(entities[3])->value = 33;
+    entityManager.removeEntity(entities[5]);
+    entityManager.processRemovals();
+    EntityId added = entityManager.generateNewId();
+    addValueComponent<0>(entityManager, added, 100);
+    delta = entityManager.delta(factory);
+    StorageList changed = delta.get<StorageContainer>("collections").get<StorageList>(
+        ValueComponent<0>::TYPE_NAME()
+    );
+    EXPECT_EQ(2u, changed.size());
+    EXPECT_EQ(1u, delta.get<StorageList>("removedComponents").size());
+    // Restoring snapshot plus delta gives the current state
+    EntityManager restored;
+    restored.restore(EntityManager::applyDelta(snapshot, delta), factory);
+    for (size_t i = 0; i < entities.size(); ++i) {
+        auto restoredComponent = restored.getComponent<ValueComponent<0>>(entities[i]);
+        if (i == 5) {
+            EXPECT_EQ(nullptr, restoredComponent);
+            continue;
+        }
+        ASSERT_NE(nullptr, restoredComponent);
+        EXPECT_EQ(i == 3 ? 33 : int32_t(i), restoredComponent->value);
+    }
+    ASSERT_NE(nullptr, restored.getComponent<ValueComponent<0>>(added));
+    EXPECT_EQ(100, restored.getComponent<ValueComponent<0>>(added)->value);
+}
+
+
+TEST(EntityManager, StorageAndRestore) {
+    ComponentFactory factory;
+    registerLocally<0>(factory);
+    registerThreadSafe<1>();
+    registerGlobally<2>();
+    EXPECT_FALSE(factory.isThreadSafeType(ValueComponent<0>::TYPE_NAME()));
+    EXPECT_TRUE(factory.isThreadSafeType(ValueComponent<1>::TYPE_NAME()));
+    // Registering globally doesn't imply thread safety
+    EXPECT_FALSE(factory.isThreadSafeType(ValueComponent<2>::TYPE_NAME()));
+    EntityManager entityManager;
+    std::vector<EntityId> entities;
+    for (int i = 0; i < 1000; ++i) {
+        EntityId entityId = entityManager.generateNewId();
+        addValueComponent<0>(entityManager, entityId, i);
+        addValueComponent<1>(entityManager, entityId, 2 * i);
+        if (i % 2 == 0) {
+            addValueComponent<2>(entityManager, entityId, 3 * i);
+        }
+        entities.push_back(entityId);
+    }
+    entityManager.setVolatile(entities[7], true);
+    StorageContainer storage = entityManager.storage(factory);
+    EntityManager restored;
+    restored.restore(storage, factory);
+    for (int i = 0; i < 1000; ++i) {
+        EntityId entityId = entities[i];
+        if (i == 7) {
+            EXPECT_FALSE(restored.exists(entityId));
+            continue;
+        }
+        ASSERT_NE(nullptr, restored.getComponent<ValueComponent<0>>(entityId));
+        EXPECT_EQ(i, restored.getComponent<ValueComponent<0>>(entityId)->value);
+        ASSERT_NE(nullptr, restored.getComponent<ValueComponent<1>>(entityId));
+        EXPECT_EQ(2 * i, restored.getComponent<ValueComponent<1>>(entityId)->value);
+        auto third = restored.getComponent<ValueComponent<2>>(entityId);
+        if (i % 2 == 0) {
+            ASSERT_NE(nullptr, third);
+            EXPECT_EQ(3 * i, third->value);
+        }
+        else {
+            EXPECT_EQ(nullptr, third);
+        }
+    }
+}
+
+
+TEST(EntityManager, RestoreSkipsComponentsWithoutEntity) {
+    ComponentFactory factory;
+    registerGlobally<3>();
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    addValueComponent<3>(entityManager, entityId, 1);
+    StorageContainer storage = entityManager.storage(factory);
+    StorageContainer collections = storage.get<StorageContainer>("collections");
+    StorageList components = collections.get<StorageList>(ValueComponent<3>::TYPE_NAME());
+    StorageContainer orphan = components.get(1);
+    orphan.set<EntityId>("owner", NULL_ENTITY);
+    orphan.set<int32_t>("value", 2);
+    components.append(orphan);
+    collections.set(ValueComponent<3>::TYPE_NAME(), components);
+    storage.set("collections", collections);
+    EntityManager restored;
+    restored.restore(storage, factory);
+    ASSERT_NE(nullptr, restored.getComponent<ValueComponent<3>>(entityId));
+    EXPECT_EQ(1, restored.getComponent<ValueComponent<3>>(entityId)->value);
+    EXPECT_EQ(1u, restored.entities().size());
+}
+
+
+TEST(EntityManager, RestoreRejectsSlotsBeyondIndexRange) {
+    ComponentFactory factory;
+    EntityManager entityManager;
+    StorageContainer storage = entityManager.storage(factory);
+    // Saves from before generational ids with more than 2^22 entities
+    storage.set<EntityId>("currentId", ENTITY_INDEX_MASK + 2);
+    EntityManager restored;
+    EXPECT_THROW(restored.restore(storage, factory), std::runtime_error);
+}
@@ -0,0 +1,161 @@
+#include "engine/entity_template.h"
+
+#include "engine/component_factory.h"
+#include "engine/entity_manager.h"
+#include "engine/serialization.h"
+#include "util/make_unique.h"
+
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+namespace {
+
+/**
+* @brief Component with a value, and a position if \a PLACED
+*/
+template<bool PLACED>
+class TemplateComponent : public Component {
+
+public:
+
+    static ComponentTypeId TYPE_ID;
+
+    static const std::string&
+    TYPE_NAME() {
+        static std::string string = PLACED ? "PlacedComponent" : "UnplacedComponent";
+        return string;
+    }
+
+    ComponentTypeId
+    typeId() const override {
+        return TYPE_ID;
+    }
+
+    std::string
+    typeName() const override {
+        return TYPE_NAME();
+    }
+
+    void
+    load(
+        const StorageContainer& storage
+    ) override {
+        Component::load(storage);
+        position = storage.get<Ogre::Vector3>("position", Ogre::Vector3::ZERO);
+        value = storage.get<int32_t>("value");
+    }
+
+    StorageContainer
+    storage() const override {
+        StorageContainer storage = Component::storage();
+        if (PLACED) {
+            storage.set<Ogre::Vector3>("position", position);
+        }
+        storage.set<int32_t>("value", value);
+        return storage;
+    }
+
+    Ogre::Vector3 position = Ogre::Vector3::ZERO;
+
+    int32_t value = 0;
+
+};
+
+template<bool PLACED>
+ComponentTypeId TemplateComponent<PLACED>::TYPE_ID = NULL_COMPONENT_TYPE;
+
+using Placed = TemplateComponent<true>;
+
+using Unplaced = TemplateComponent<false>;
+
+template<typename C>
+void
+registerType(
+    ComponentFactory& factory
+) {
+    C::TYPE_ID = factory.registerComponentType(
+        C::TYPE_NAME(),
+        [](const StorageContainer& storage) {
+            std::unique_ptr<Component> component = make_unique<C>();
+            component->load(storage);
+            return component;
+        }
+    );
+}
+
+/**
+* @brief Stores an entity with a placed and an unplaced component
+*/
+StorageContainer
+storedEntity() {
+    EntityManager entityManager;
+    EntityId entityId = entityManager.generateNewId();
+    auto placed = make_unique<Placed>();
+    placed->position = Ogre::Vector3(1, 2, 3);
+    placed->value = 7;
+    entityManager.addComponent(entityId, std::move(placed));
+    auto unplaced = make_unique<Unplaced>();
+    unplaced->value = 8;
+    entityManager.addComponent(entityId, std::move(unplaced));
+    return entityManager.storeEntity(entityId);
+}
+
+} // namespace
+
+
+TEST(EntityTemplate, Instantiate) {
+    ComponentFactory factory;
+    registerType<Placed>(factory);
+    registerType<Unplaced>(factory);
+    EntityTemplate entityTemplate(storedEntity(), factory);
+    EXPECT_EQ(2u, entityTemplate.size());
+    EntityManager entityManager;
+    EntityId entityId = entityManager.instantiate(entityTemplate);
+    auto placed = entityManager.getComponent<Placed>(entityId);
+    ASSERT_NE(nullptr, placed);
+    EXPECT_EQ(entityId, placed->owner());
+    EXPECT_EQ(Ogre::Vector3(1, 2, 3), placed->position);
+    EXPECT_EQ(7, placed->value);
+    ASSERT_NE(nullptr, entityManager.getComponent<Unplaced>(entityId));
+    EXPECT_EQ(8, entityManager.getComponent<Unplaced>(entityId)->value);
+    // Copies share the template
+    EntityTemplate copy = entityTemplate;
+    EXPECT_EQ(&entityTemplate.parts(), &copy.parts());
+}
+
+
+TEST(EntityTemplate, InstantiateAtPositions) {
+    ComponentFactory factory;
+    registerType<Placed>(factory);
+    registerType<Unplaced>(factory);
+    EntityTemplate entityTemplate(storedEntity(), factory);
+    EntityManager entityManager;
+    std::vector<Ogre::Vector3> positions;
+    for (int i = 0; i < 100; ++i) {
+        positions.emplace_back(i, -i, 0);
+    }
+    auto entityIds = entityManager.instantiate(entityTemplate, positions);
+    ASSERT_EQ(positions.size(), entityIds.size());
+    auto signature = entityManager.componentSignature(entityIds[0]);
+    for (size_t i = 0; i < entityIds.size(); ++i) {
+        EntityId entityId = entityIds[i];
+        EXPECT_TRUE(entityManager.exists(entityId));
+        EXPECT_EQ(signature, entityManager.componentSignature(entityId));
+        auto placed = entityManager.getComponent<Placed>(entityId);
+        ASSERT_NE(nullptr, placed);
+        EXPECT_EQ(positions[i], placed->position);
+        EXPECT_EQ(7, placed->value);
+        EXPECT_EQ(8, entityManager.getComponent<Unplaced>(entityId)->value);
+    }
+    // The template itself is unchanged
+    EntityId entityId = entityManager.instantiate(entityTemplate);
+    EXPECT_EQ(Ogre::Vector3(1, 2, 3), entityManager.getComponent<Placed>(entityId)->position);
+}
+
+
+TEST(EntityTemplate, UnknownType) {
+    ComponentFactory factory;
+    registerType<Placed>(factory);
+    EXPECT_THROW(EntityTemplate(storedEntity(), factory), std::runtime_error);
+}
@@ -0,0 +1,91 @@
+#include "engine/savegame_compression.h"
+
+#include "engine/serialization.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <sstream>
+
+using namespace thrive;
+
+
+static std::string
+testData() {
+    // Repetitive text with some noise, roughly like an encoded savegame
+    std::mt19937 rng(42);
+    std::string data;
+    for (int i = 0; i < 5000; ++i) {
+        data += "OgreSceneNodeComponent";
+        data.push_back(static_cast<char>(rng()));
+        data += std::to_string(i);
+    }
+    return data;
+}
+
+
+TEST(SavegameCompression, RoundTrip) {
+    std::vector<std::string> inputs = {
+        "",
+        "a",
+        "abcabcabcabcabcabcabcabc",
+        testData()
+    };
+    std::mt19937 rng(1);
+    std::string noise;
+    for (int i = 0; i < 10000; ++i) {
+        noise.push_back(static_cast<char>(rng()));
+    }
+    inputs.push_back(noise);
+    for (const std::string& input : inputs) {
+        std::string frame = SavegameCompression::compress(input, 4096);
+        EXPECT_TRUE(SavegameCompression::isCompressed(frame.data(), frame.size()));
+        EXPECT_EQ(input, SavegameCompression::decompress(frame.data(), frame.size()));
+    }
+}
+
+
+TEST(SavegameCompression, Shrinks) {
+    std::string data = testData();
+    std::string frame = SavegameCompression::compress(data);
+    EXPECT_LT(frame.size(), data.size() / 2);
+}
+
+
+TEST(SavegameCompression, Crc32) {
+    std::string check = "123456789";
+    EXPECT_EQ(0xCBF43926u, SavegameCompression::crc32(check.data(), check.size()));
+}
+
+
+TEST(SavegameCompression, DetectsCorruption) {
+    std::string frame = SavegameCompression::compress(testData(), 4096);
+    // Every single flipped byte after the header must be rejected
+    for (size_t i = 32; i < frame.size(); i += 97) {
+        std::string corrupt = frame;
+        corrupt[i] ^= 0x10;
+        EXPECT_THROW(
+            SavegameCompression::decompress(corrupt.data(), corrupt.size()),
+            std::runtime_error
+        ) << "Byte " << i;
+    }
+    std::string truncated = frame.substr(0, frame.size() - 1);
+    EXPECT_THROW(
+        SavegameCompression::decompress(truncated.data(), truncated.size()),
+        std::runtime_error
+    );
+}
+
+
+TEST(SavegameCompression, StorageContainer) {
+    StorageContainer savegame;
+    savegame.set<std::string>("thriveversion", "0.3.3");
+    std::ostringstream output(std::ios_base::out | std::ios_base::binary);
+    output << savegame;
+    std::string frame = SavegameCompression::compress(output.str());
+    std::istringstream input(frame, std::ios_base::in | std::ios_base::binary);
+    StorageContainer loaded;
+    input >> loaded;
+    EXPECT_EQ("0.3.3", loaded.get<std::string>("thriveversion"));
+    StorageView view = StorageView::fromBuffer(frame);
+    EXPECT_EQ("0.3.3", view.get<std::string>("thriveversion"));
+}
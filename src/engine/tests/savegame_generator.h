@@ -0,0 +1,68 @@
+#pragma once
+
+#include "engine/serialization.h"
+
+#include <random>
+#include <string>
+
+/**
+* @brief Builds a synthetic savegame shaped like EntityManager::storage()
+*
+* Components are spread over a handful of collections and hold the usual
+* mix of vectors, quaternions, strings and nested lists.
+*
+* @param componentCount
+*   Total number of components
+* @param seed
+*   Seed for the values, the same seed gives the same savegame
+*/
+inline thrive::StorageContainer
+generateSavegame(
+    unsigned int componentCount,
+    unsigned int seed = 0
+) {
+    using namespace thrive;
+    static const char* const TYPE_NAMES[] = {
+        "AgentEmitterComponent",
+        "MicrobeComponent",
+        "OgreSceneNodeComponent",
+        "RigidBodyComponent",
+        "SoundSourceComponent"
+    };
+    const unsigned int typeCount = sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> real(-1000.0f, 1000.0f);
+    std::vector<StorageList> components(typeCount);
+    for (unsigned int i = 0; i < componentCount; ++i) {
+        StorageContainer component;
+        component.set<uint32_t>("owner", i / 3 + 1);
+        component.set("position", Ogre::Vector3(real(rng), real(rng), real(rng)));
+        component.set("orientation", Ogre::Quaternion(
+            real(rng), real(rng), real(rng), real(rng)
+        ));
+        component.set("velocity", Ogre::Vector3(real(rng), real(rng), 0.0f));
+        component.set<float>("mass", real(rng));
+        component.set<bool>("volatile", rng() % 2 == 0);
+        component.set<std::string>("name", "entity_" + std::to_string(rng() % 10000));
+        StorageList children;
+        for (unsigned int j = rng() % 8; j > 0; --j) {
+            StorageContainer child;
+            child.set<int32_t>("q", static_cast<int32_t>(rng() % 20) - 10);
+            child.set<int32_t>("r", static_cast<int32_t>(rng() % 20) - 10);
+            child.set<std::string>("internalName", "mitochondrion");
+            child.set<double>("health", real(rng));
+            children.append(std::move(child));
+        }
+        component.set("organelles", std::move(children));
+        components[i % typeCount].append(std::move(component));
+    }
+    StorageContainer collections;
+    for (unsigned int i = 0; i < typeCount; ++i) {
+        collections.set(TYPE_NAMES[i], std::move(components[i]));
+    }
+    StorageContainer savegame;
+    savegame.set<uint32_t>("currentId", componentCount / 3 + 1);
+    savegame.set("collections", std::move(collections));
+    savegame.set<std::string>("thriveversion", "0.3.0");
+    return savegame;
+}
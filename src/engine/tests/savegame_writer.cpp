@@ -0,0 +1,56 @@
+#include "engine/savegame_writer.h"
+
+#include "engine/serialization.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+
+using namespace thrive;
+namespace fs = boost::filesystem;
+
+
+TEST(SavegameWriter, WritesInBackground) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(directory);
+    std::string filename = (directory / "test.sav").string();
+    {
+        SavegameWriter writer;
+        for (int i = 0; i < 3; ++i) {
+            StorageContainer savegame;
+            savegame.set<int32_t>("counter", i);
+            writer.write(filename, std::move(savegame));
+        }
+        writer.wait();
+        EXPECT_FALSE(writer.busy());
+        EXPECT_FLOAT_EQ(1.0f, writer.progress());
+        auto results = writer.takeResults();
+        ASSERT_EQ(3u, results.size());
+        for (const auto& result : results) {
+            EXPECT_TRUE(result.succeeded) << result.error;
+            EXPECT_EQ(filename, result.filename);
+        }
+        EXPECT_TRUE(writer.takeResults().empty());
+    }
+    // The last savegame wins and no temporary file is left behind
+    StorageContainer loaded;
+    std::ifstream stream(filename, std::ifstream::binary);
+    stream >> loaded;
+    EXPECT_EQ(2, loaded.get<int32_t>("counter"));
+    EXPECT_FALSE(fs::exists(filename + ".tmp"));
+    fs::remove_all(directory);
+}
+
+
+TEST(SavegameWriter, ReportsFailure) {
+    fs::path directory = fs::temp_directory_path() / fs::unique_path();
+    std::string filename = (directory / "missing" / "test.sav").string();
+    SavegameWriter writer;
+    writer.write(filename, StorageContainer());
+    writer.wait();
+    auto results = writer.takeResults();
+    ASSERT_EQ(1u, results.size());
+    EXPECT_FALSE(results[0].succeeded);
+    EXPECT_FALSE(results[0].error.empty());
+    EXPECT_FALSE(fs::exists(filename));
+}
@@ -1,6 +1,12 @@
 #include "engine/serialization.h"
 
+#include "engine/savegame_compression.h"
+#include "engine/tests/savegame_generator.h"
+
+#include <boost/filesystem.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <random>
 
 using namespace thrive;
 
@@ -109,3 +115,436 @@ TEST(Serialization, Vector3) {
 
 
 
+
+
+TEST(Serialization, Quaternion) {
+    Ogre::Quaternion quaternion(0.5f, -0.5f, 0.25f, 1.0f);
+    testSerialization(quaternion);
+}
+
+
+TEST(Serialization, StorageList) {
+    StorageList list;
+    for (int i = 0; i < 3; ++i) {
+        StorageContainer element;
+        element.set<int32_t>("index", i);
+        element.set<Ogre::Vector3>("position", Ogre::Vector3(i, 0, 0));
+        list.append(element);
+    }
+    StorageList listCopy = copy(list);
+    ASSERT_EQ(3u, listCopy.size());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(i, listCopy[i].get<int32_t>("index"));
+        EXPECT_EQ(Ogre::Vector3(i, 0, 0), listCopy[i].get<Ogre::Vector3>("position"));
+    }
+}
+
+
+TEST(Serialization, KeysAreWrittenOnce) {
+    StorageList list;
+    for (int i = 0; i < 100; ++i) {
+        StorageContainer element;
+        element.set<std::string>("typename", "OgreSceneNodeComponent");
+        list.append(element);
+    }
+    StorageContainer container;
+    container.set("components", list);
+    std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+    stream << container;
+    std::string data = stream.str();
+    size_t occurrences = 0;
+    for (
+        size_t pos = data.find("typename");
+        pos != std::string::npos;
+        pos = data.find("typename", pos + 1)
+    ) {
+        occurrences += 1;
+    }
+    EXPECT_EQ(1u, occurrences);
+}
+
+
+TEST(StorageContainer, CopiesShareContent) {
+    StorageContainer original;
+    original.set<int32_t>("value", 1);
+    size_t copies = StorageContainer::contentCopies();
+    StorageContainer copy = original;
+    StorageContainer assigned;
+    assigned = original;
+    EXPECT_EQ(1, copy.get<int32_t>("value"));
+    EXPECT_EQ(1, assigned.get<int32_t>("value"));
+    EXPECT_EQ(copies, StorageContainer::contentCopies());
+    // Modifying a copy leaves the others alone
+    copy.set<int32_t>("value", 2);
+    EXPECT_EQ(copies + 1, StorageContainer::contentCopies());
+    EXPECT_EQ(2, copy.get<int32_t>("value"));
+    EXPECT_EQ(1, original.get<int32_t>("value"));
+    EXPECT_EQ(1, assigned.get<int32_t>("value"));
+}
+
+
+TEST(StorageContainer, MovesDontCopy) {
+    size_t copies = StorageContainer::contentCopies();
+    StorageContainer original;
+    original.set<std::string>("name", "cell");
+    StorageContainer moved(std::move(original));
+    EXPECT_EQ("cell", moved.get<std::string>("name"));
+    EXPECT_TRUE(original.keys().empty());
+    // A moved-from container is still usable
+    original.set<int32_t>("value", 1);
+    EXPECT_EQ(1, original.get<int32_t>("value"));
+    EXPECT_FALSE(moved.contains("value"));
+    StorageList list;
+    list.append(std::move(moved));
+    list.append(original);
+    const StorageContainer* data = list.data();
+    StorageList movedList(std::move(list));
+    EXPECT_EQ(data, movedList.data());
+    StorageContainer container;
+    container.set("list", std::move(movedList));
+    StorageList stored = container.get<StorageList>("list");
+    ASSERT_EQ(2u, stored.size());
+    EXPECT_EQ("cell", stored[0].get<std::string>("name"));
+    EXPECT_EQ(copies, StorageContainer::contentCopies());
+}
+
+
+TEST(StorageContainer, RoundTripDoesntCopy) {
+    StorageList list;
+    for (int i = 0; i < 10; ++i) {
+        StorageContainer element;
+        element.set<int32_t>("index", i);
+        list.append(element);
+    }
+    StorageContainer container;
+    container.set("list", list);
+    size_t copies = StorageContainer::contentCopies();
+    std::ostringstream outputStream(std::ios_base::out | std::ios_base::binary);
+    outputStream << container;
+    StorageContainer loaded;
+    std::istringstream inputStream(
+        outputStream.str(),
+        std::ios_base::in | std::ios_base::binary
+    );
+    inputStream >> loaded;
+    EXPECT_EQ(10u, loaded.get<StorageList>("list").size());
+    EXPECT_EQ(copies, StorageContainer::contentCopies());
+}
+
+
+TEST(StorageContainer, ManyKeys) {
+    StorageContainer container;
+    for (int i = 0; i < 100; ++i) {
+        container.set<int32_t>("key" + std::to_string(i), i);
+    }
+    // Overwriting keeps a single entry, even with a different type
+    container.set<int32_t>("key10", -10);
+    container.set<std::string>("key20", "twenty");
+    EXPECT_EQ(100u, container.keys().size());
+    EXPECT_EQ(-10, container.get<int32_t>("key10"));
+    EXPECT_FALSE(container.contains<int32_t>("key20"));
+    EXPECT_EQ("twenty", container.get<std::string>("key20"));
+    EXPECT_FALSE(container.contains("key100"));
+    StorageContainer loaded = copy(container);
+    EXPECT_EQ(100u, loaded.keys().size());
+    for (int i = 30; i < 100; ++i) {
+        EXPECT_EQ(i, loaded.get<int32_t>("key" + std::to_string(i)));
+    }
+    EXPECT_EQ("twenty", loaded.get<std::string>("key20"));
+}
+
+
+TEST(Serialization, LegacyFormat) {
+    // Hand written savegame in the format used before the binary one
+    std::ostringstream legacy(std::ios_base::out | std::ios_base::binary);
+    auto writeInt = [&legacy](uint64_t value, size_t size) {
+        legacy.write(reinterpret_cast<const char*>(&value), size);
+    };
+    auto writeString = [&](const std::string& string) {
+        writeInt(string.size(), 8);
+        legacy.write(string.data(), string.size());
+    };
+    writeInt(3, 8);
+    writeString("float");
+    writeInt(176, 2);
+    writeString("3.1415");
+    writeString("int");
+    writeInt(80, 2);
+    writeInt(2001, 4);
+    writeString("vector");
+    writeInt(304, 2);
+    writeInt(3, 8);
+    for (const char* axis : {"x", "y", "z"}) {
+        writeString(axis);
+        writeInt(176, 2);
+        writeString("2");
+    }
+    StorageContainer container;
+    std::istringstream stream(
+        legacy.str(),
+        std::ios_base::in | std::ios_base::binary
+    );
+    stream >> container;
+    EXPECT_FLOAT_EQ(3.1415f, container.get<float>("float"));
+    EXPECT_EQ(2001, container.get<int32_t>("int"));
+    EXPECT_EQ(Ogre::Vector3(2, 2, 2), container.get<Ogre::Vector3>("vector"));
+}
+
+
+static std::string
+encode(
+    const StorageContainer& storage
+) {
+    std::ostringstream stream(std::ios_base::out | std::ios_base::binary);
+    stream << storage;
+    return stream.str();
+}
+
+
+TEST(StorageView, Access) {
+    StorageList entities;
+    for (int i = 0; i < 3; ++i) {
+        StorageContainer entity;
+        entity.set<int32_t>("entityId", i);
+        entities.append(entity);
+    }
+    StorageContainer state;
+    state.set<Ogre::Quaternion>("orientation", Ogre::Quaternion(0, 1, 0, 0));
+    state.set("entities", entities);
+    StorageContainer savegame;
+    savegame.set<std::string>("thriveversion", "0.3.3");
+    savegame.set("state", state);
+
+    StorageView view = StorageView::fromBuffer(encode(savegame));
+    EXPECT_TRUE(view.contains("state"));
+    EXPECT_TRUE(view.contains<StorageContainer>("state"));
+    EXPECT_FALSE(view.contains<std::string>("state"));
+    EXPECT_EQ("0.3.3", view.get<std::string>("thriveversion"));
+    EXPECT_EQ(7, view.get<int32_t>("missing", 7));
+    StorageView stateView = view.view("state");
+    EXPECT_EQ(Ogre::Quaternion(0, 1, 0, 0), stateView.get<Ogre::Quaternion>("orientation"));
+    auto entityViews = stateView.list("entities");
+    ASSERT_EQ(3u, entityViews.size());
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(i, entityViews[i].get<int32_t>("entityId"));
+    }
+    StorageList entitiesCopy = stateView.get<StorageList>("entities");
+    EXPECT_EQ(3u, entitiesCopy.size());
+    StorageContainer decoded = view.decode();
+    EXPECT_EQ("0.3.3", decoded.get<std::string>("thriveversion"));
+    EXPECT_TRUE(view.view("thriveversion").keys().empty());
+}
+
+
+TEST(StorageView, DecodesOnlyWhatIsTouched) {
+    StorageContainer broken;
+    broken.set<std::string>("marker", "XXXXXXXX");
+    StorageContainer savegame;
+    savegame.set<std::string>("thriveversion", "0.3.3");
+    savegame.set("broken", broken);
+    std::string data = encode(savegame);
+    // Make the string's length point past the end of its container
+    size_t marker = data.find("XXXXXXXX");
+    ASSERT_NE(std::string::npos, marker);
+    data[marker - 1] = 0x7F;
+
+    StorageView view = StorageView::fromBuffer(data);
+    EXPECT_EQ("0.3.3", view.get<std::string>("thriveversion"));
+    EXPECT_THROW(view.view("broken"), std::runtime_error);
+    StorageContainer storage;
+    std::istringstream stream(data, std::ios_base::in | std::ios_base::binary);
+    EXPECT_THROW(stream >> storage, std::runtime_error);
+}
+
+
+TEST(StorageView, OpenFile) {
+    namespace fs = boost::filesystem;
+    fs::path path = fs::temp_directory_path() / fs::unique_path();
+    StorageContainer savegame;
+    savegame.set<Ogre::Vector3>("position", Ogre::Vector3(1, 2, 3));
+    {
+        std::ofstream stream(path.string(), std::ofstream::binary);
+        stream << savegame;
+    }
+    {
+        StorageView view = StorageView::open(path.string());
+        EXPECT_EQ(Ogre::Vector3(1, 2, 3), view.get<Ogre::Vector3>("position"));
+    }
+    fs::remove(path);
+}
+
+
+static std::string
+binarySavegame(
+    const std::string& body
+) {
+    std::string savegame("THRB");
+    uint16_t version = 2;
+    uint64_t bodySize = body.size();
+    savegame.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    savegame.append(reinterpret_cast<const char*>(&bodySize), sizeof(bodySize));
+    return savegame + body;
+}
+
+
+static void
+decodeAll(
+    const std::string& data
+) {
+    StorageContainer storage;
+    std::istringstream stream(data, std::ios_base::in | std::ios_base::binary);
+    stream >> storage;
+    StorageView::fromBuffer(data).decode();
+}
+
+
+TEST(Serialization, TruncatedInput) {
+    std::string encoded = encode(generateSavegame(20));
+    for (const std::string& data : {encoded, SavegameCompression::compress(encoded)}) {
+        ASSERT_NO_THROW(decodeAll(data));
+        for (size_t size = 0; size < data.size(); ++size) {
+            std::string truncated = data.substr(0, size);
+            StorageContainer storage;
+            std::istringstream stream(truncated, std::ios_base::in | std::ios_base::binary);
+            EXPECT_THROW(stream >> storage, std::runtime_error) << size;
+            EXPECT_THROW(StorageView::fromBuffer(truncated), std::runtime_error) << size;
+        }
+    }
+}
+
+
+TEST(Serialization, CorruptedInput) {
+    std::string encoded = encode(generateSavegame(20));
+    std::mt19937 rng(1);
+    for (int i = 0; i < 2000; ++i) {
+        std::string data = encoded;
+        for (unsigned int changes = rng() % 4 + 1; changes > 0; --changes) {
+            data[rng() % data.size()] = static_cast<char>(rng());
+        }
+        // Must either decode or throw
+        try {
+            decodeAll(data);
+        }
+        catch (const std::exception&) {
+        }
+    }
+}
+
+
+TEST(Serialization, DeepNesting) {
+    auto nestedBinary = [](unsigned int depth) {
+        std::string content(1, '\0');
+        for (unsigned int i = 0; i < depth; ++i) {
+            uint16_t typeId = 224;
+            uint32_t size = content.size();
+            std::string outer("\x01\x00", 2);
+            outer.append(reinterpret_cast<const char*>(&typeId), sizeof(typeId));
+            outer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+            content = outer + content;
+        }
+        return binarySavegame(std::string("\x01\x01" "c", 3) + content);
+    };
+    auto nestedLegacy = [](unsigned int depth) {
+        std::string data;
+        auto writeInt = [&data](uint64_t value, size_t size) {
+            data.append(reinterpret_cast<const char*>(&value), size);
+        };
+        for (unsigned int i = 0; i < depth; ++i) {
+            writeInt(1, 8);
+            writeInt(1, 8);
+            data += "c";
+            writeInt(224, 2);
+        }
+        writeInt(0, 8);
+        return data;
+    };
+    EXPECT_NO_THROW(decodeAll(nestedBinary(100)));
+    EXPECT_NO_THROW(decodeAll(nestedLegacy(100)));
+    EXPECT_THROW(decodeAll(nestedBinary(1000)), std::runtime_error);
+    EXPECT_THROW(decodeAll(nestedLegacy(1000)), std::runtime_error);
+    // Nothing is written that couldn't be read
+    StorageContainer nested;
+    for (int i = 0; i < 200; ++i) {
+        StorageContainer outer;
+        outer.set("c", std::move(nested));
+        nested = std::move(outer);
+    }
+    EXPECT_THROW(encode(nested), std::runtime_error);
+}
+
+
+TEST(Serialization, HugeListSize) {
+    uint16_t typeId = 240;
+    uint32_t size = 5;
+    std::string body("\x01\x01" "l" "\x01\x00", 5);
+    body.append(reinterpret_cast<const char*>(&typeId), sizeof(typeId));
+    body.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    // 2^34 elements
+    body.append("\x80\x80\x80\x80\x40", 5);
+    std::string data = binarySavegame(body);
+    StorageContainer storage;
+    std::istringstream stream(data, std::ios_base::in | std::ios_base::binary);
+    EXPECT_THROW(stream >> storage, std::runtime_error);
+    StorageView view = StorageView::fromBuffer(data);
+    EXPECT_THROW(view.get<StorageList>("l"), std::runtime_error);
+}
+
+
+TEST(Serialization, FileKeysArentInterned) {
+    // A key that's never set anywhere, mapped to an empty container
+    const std::string key = "keyOnlyInFile";
+    uint16_t typeId = 224;
+    uint32_t size = 1;
+    std::string body("\x01", 1);
+    body += static_cast<char>(key.size());
+    body += key;
+    body.append("\x01\x00", 2);
+    body.append(reinterpret_cast<const char*>(&typeId), sizeof(typeId));
+    body.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    body.append(1, '\0');
+    std::string data = binarySavegame(body);
+    StorageContainer storage;
+    std::istringstream stream(data, std::ios_base::in | std::ios_base::binary);
+    stream >> storage;
+    EXPECT_TRUE(storage.contains<StorageContainer>(key));
+    StorageView view = StorageView::fromBuffer(data);
+    EXPECT_TRUE(view.contains<StorageContainer>(key));
+    EXPECT_EQ(std::list<std::string>{key}, view.keys());
+    // Setting the key replaces the entry read from the file
+    storage.set<int32_t>(key, 5);
+    EXPECT_EQ(5, storage.get<int32_t>(key));
+    EXPECT_EQ(1u, storage.keys().size());
+    // Files read after interning use the interned key
+    StorageContainer reread;
+    std::istringstream restream(data, std::ios_base::in | std::ios_base::binary);
+    restream >> reread;
+    reread.set<int32_t>(key, 6);
+    EXPECT_EQ(6, reread.get<int32_t>(key));
+    EXPECT_EQ(1u, reread.keys().size());
+}
+
+
+TEST(Serialization, KeysAreInNameOrder) {
+    // Interned in reverse order, so their addresses are too
+    StorageContainer first;
+    first.set<int32_t>("orderZ", 1);
+    first.set<int32_t>("orderM", 2);
+    first.set<int32_t>("orderA", 3);
+    StorageContainer second;
+    second.set<int32_t>("orderA", 3);
+    second.set<int32_t>("orderZ", 1);
+    second.set<int32_t>("orderM", 2);
+    const std::list<std::string> keys = {"orderA", "orderM", "orderZ"};
+    EXPECT_EQ(keys, first.keys());
+    EXPECT_EQ(keys, second.keys());
+    std::ostringstream firstStream(std::ios_base::out | std::ios_base::binary);
+    firstStream << first;
+    std::ostringstream secondStream(std::ios_base::out | std::ios_base::binary);
+    secondStream << second;
+    EXPECT_EQ(firstStream.str(), secondStream.str());
+    StorageContainer loaded;
+    std::istringstream inputStream(firstStream.str(), std::ios_base::in | std::ios_base::binary);
+    inputStream >> loaded;
+    EXPECT_EQ(keys, loaded.keys());
+    EXPECT_EQ(keys, StorageView::fromBuffer(firstStream.str()).keys());
+}
@@ -0,0 +1,101 @@
+#include "engine/system_scheduler.h"
+
+#include "engine/system.h"
+#include "engine/thread_pool.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+
+using namespace thrive;
+
+namespace {
+
+class TestSystem : public System {
+
+public:
+
+    TestSystem(
+        std::vector<ComponentTypeId> reads,
+        std::vector<ComponentTypeId> writes
+    ) {
+        for (ComponentTypeId typeId : reads) {
+            this->declareRead(typeId);
+        }
+        for (ComponentTypeId typeId : writes) {
+            this->declareWrite(typeId);
+        }
+    }
+
+    void
+    update(
+        int renderTime,
+        int
+    ) override {
+        m_updates += renderTime;
+    }
+
+    std::atomic<int> m_updates {0};
+
+};
+
+} // namespace
+
+
+TEST(ThreadPool, RunsAllTasks) {
+    ThreadPool pool(3);
+    std::atomic<int> counter {0};
+    std::vector<ThreadPool::Task> tasks;
+    for (int i = 0; i < 100; ++i) {
+        tasks.emplace_back([&counter, &pool] {
+            // Nested batches must not dead lock
+            std::vector<ThreadPool::Task> nested(2, [&counter] {
+                counter += 1;
+            });
+            pool.run(nested);
+        });
+    }
+    pool.run(tasks);
+    EXPECT_EQ(200, counter);
+}
+
+
+TEST(ThreadPool, PropagatesExceptions) {
+    ThreadPool pool(2);
+    std::vector<ThreadPool::Task> tasks(4, [] {});
+    tasks[2] = [] {
+        throw std::runtime_error("Task failed");
+    };
+    EXPECT_THROW(pool.run(tasks), std::runtime_error);
+}
+
+
+TEST(SystemScheduler, Stages) {
+    ThreadPool pool(2);
+    SystemScheduler scheduler(pool);
+    TestSystem first({1}, {2});
+    TestSystem second({1}, {3});
+    // Writes what the first reads
+    TestSystem third({}, {1});
+    // No declared access
+    TestSystem fourth({}, {});
+    TestSystem fifth({4}, {});
+    scheduler.addSystem(&first);
+    scheduler.addSystem(&second);
+    EXPECT_EQ(1u, scheduler.stageCount());
+    scheduler.addSystem(&third);
+    EXPECT_EQ(2u, scheduler.stageCount());
+    scheduler.addSystem(&fourth);
+    scheduler.addSystem(&fifth);
+    EXPECT_EQ(4u, scheduler.stageCount());
+    EXPECT_EQ((std::vector<System*>{&first, &second}), scheduler.stage(0));
+    EXPECT_EQ((std::vector<System*>{&third}), scheduler.stage(1));
+    EXPECT_EQ((std::vector<System*>{&fourth}), scheduler.stage(2));
+    EXPECT_EQ((std::vector<System*>{&fifth}), scheduler.stage(3));
+    EXPECT_THROW(scheduler.stage(4), std::out_of_range);
+    scheduler.update(5, 5);
+    scheduler.update(5, 5);
+    for (TestSystem* system : {&first, &second, &third, &fourth, &fifth}) {
+        EXPECT_EQ(10, system->m_updates);
+    }
+}
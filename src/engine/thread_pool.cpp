@@ -0,0 +1,251 @@
+#include "engine/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+using namespace thrive;
+
+namespace {
+
+/**
+* @brief Completion state of one call to ThreadPool::run()
+*/
+struct Batch {
+
+    std::condition_variable finished;
+
+    std::exception_ptr error;
+
+    std::mutex mutex;
+
+    size_t remaining = 0;
+
+};
+
+struct Job {
+
+    ThreadPool::Task* task;
+
+    Batch* batch;
+
+};
+
+struct WorkerQueue {
+
+    std::deque<Job> jobs;
+
+    std::mutex mutex;
+
+};
+
+} // namespace
+
+
+struct ThreadPool::Implementation {
+
+    Implementation(
+        size_t threadCount
+    ) : m_queues(threadCount)
+    {
+        for (auto& queue : m_queues) {
+            queue.reset(new WorkerQueue());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            m_threads.emplace_back([this, i] {
+                this->workerLoop(i);
+            });
+        }
+    }
+
+    ~Implementation() {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    static void
+    execute(
+        const Job& job
+    ) {
+        std::exception_ptr error;
+        try {
+            (*job.task)();
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        Batch& batch = *job.batch;
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (error and not batch.error) {
+            batch.error = error;
+        }
+        batch.remaining -= 1;
+        if (batch.remaining == 0) {
+            batch.finished.notify_all();
+        }
+    }
+
+    bool
+    popOwn(
+        size_t index,
+        Job& job
+    ) {
+        WorkerQueue& queue = *m_queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) {
+            return false;
+        }
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+        m_pending -= 1;
+        return true;
+    }
+
+    bool
+    steal(
+        size_t first,
+        Job& job
+    ) {
+        for (size_t i = 0; i < m_queues.size(); ++i) {
+            WorkerQueue& queue = *m_queues[(first + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (not queue.jobs.empty()) {
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                m_pending -= 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void
+    workerLoop(
+        size_t index
+    ) {
+        s_workerIndex = index;
+        s_workerPool = this;
+        Job job;
+        while (true) {
+            if (this->popOwn(index, job) or this->steal(index + 1, job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            if (m_pending > 0) {
+                // Jobs are about to be queued or taken by another thread
+                lock.unlock();
+                std::this_thread::yield();
+                continue;
+            }
+            if (m_stop) {
+                return;
+            }
+            m_wake.wait(lock, [this] {
+                return m_stop or m_pending > 0;
+            });
+        }
+    }
+
+    std::condition_variable m_wake;
+
+    std::mutex m_wakeMutex;
+
+    // Number of queued, not yet started jobs
+    std::atomic<size_t> m_pending {0};
+
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    bool m_stop = false;
+
+    std::vector<std::thread> m_threads;
+
+    static thread_local size_t s_workerIndex;
+
+    static thread_local Implementation* s_workerPool;
+
+};
+
+thread_local size_t ThreadPool::Implementation::s_workerIndex = 0;
+
+thread_local ThreadPool::Implementation* ThreadPool::Implementation::s_workerPool = nullptr;
+
+
+ThreadPool&
+ThreadPool::global() {
+    static ThreadPool pool(
+        std::max(std::thread::hardware_concurrency(), 1u) - 1
+    );
+    return pool;
+}
+
+
+ThreadPool::ThreadPool(
+    size_t threadCount
+) : m_impl(new Implementation(threadCount))
+{
+}
+
+
+ThreadPool::~ThreadPool() {}
+
+
+void
+ThreadPool::run(
+    std::vector<Task>& tasks
+) {
+    if (tasks.empty()) {
+        return;
+    }
+    if (m_impl->m_threads.empty() or tasks.size() == 1) {
+        for (Task& task : tasks) {
+            task();
+        }
+        return;
+    }
+    Batch batch;
+    batch.remaining = tasks.size();
+    // Workers queue nested batches locally, other threads spread them
+    bool isWorker = Implementation::s_workerPool == m_impl.get();
+    size_t queueCount = m_impl->m_queues.size();
+    size_t first = isWorker ? Implementation::s_workerIndex : 0;
+    {
+        std::lock_guard<std::mutex> lock(m_impl->m_wakeMutex);
+        m_impl->m_pending += tasks.size();
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        size_t queueIndex = isWorker ? first : (first + i) % queueCount;
+        WorkerQueue& queue = *m_impl->m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(Job{&tasks[i], &batch});
+    }
+    m_impl->m_wake.notify_all();
+    // Help out until no queued work is left
+    Job job;
+    while (m_impl->steal(first, job)) {
+        Implementation::execute(job);
+    }
+    std::unique_lock<std::mutex> lock(batch.mutex);
+    batch.finished.wait(lock, [&batch] {
+        return batch.remaining == 0;
+    });
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+
+size_t
+ThreadPool::threadCount() const {
+    return m_impl->m_threads.size();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+/**
+* @brief A fixed set of worker threads with work stealing
+*
+* Each worker has its own task queue. Workers take tasks from the back of
+* their own queue and steal from the front of other queues once theirs is
+* empty. The thread submitting a batch of tasks helps executing them while
+* it waits, so nested batches don't dead lock.
+*/
+class ThreadPool {
+
+public:
+
+    using Task = std::function<void()>;
+
+    /**
+    * @brief The pool shared by the engine
+    *
+    * Has one worker less than the machine has hardware threads, because
+    * the calling thread participates in run().
+    */
+    static ThreadPool&
+    global();
+
+    /**
+    * @brief Constructor
+    *
+    * @param threadCount
+    *   The number of worker threads. With 0, all tasks are executed on the
+    *   calling thread.
+    */
+    explicit ThreadPool(
+        size_t threadCount
+    );
+
+    /**
+    * @brief Destructor
+    *
+    * Joins all workers. Tasks still queued are executed first.
+    */
+    ~ThreadPool();
+
+    /**
+    * @brief Executes a batch of tasks and waits for all of them
+    *
+    * @param tasks
+    *   The tasks to execute. The order of execution is unspecified.
+    *
+    * @throws
+    *   The first exception thrown by any of the tasks, after all tasks have
+    *   finished
+    */
+    void
+    run(
+        std::vector<Task>& tasks
+    );
+
+    /**
+    * @brief The number of worker threads
+    */
+    size_t
+    threadCount() const;
+
+private:
+
+    struct Implementation;
+    std::unique_ptr<Implementation> m_impl;
+
+};
+
+}
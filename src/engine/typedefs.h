@@ -26,4 +26,48 @@ namespace thrive {
 
     static const ComponentTypeId NULL_COMPONENT_TYPE = 0;
 
+    /**
+    * @brief Number of low bits of an EntityId that hold the slot index
+    *
+    * The remaining high bits hold the slot's generation, which is increased
+    * whenever the slot is recycled for a new entity.
+    */
+    static const unsigned int ENTITY_INDEX_BITS = 22;
+
+    static const EntityId ENTITY_INDEX_MASK = (EntityId(1) << ENTITY_INDEX_BITS) - 1;
+
+    static const EntityId ENTITY_GENERATION_MASK = ~EntityId(0) >> ENTITY_INDEX_BITS;
+
+    /**
+    * @brief The slot index part of an entity id
+    */
+    inline EntityId
+    entityIndex(
+        EntityId entityId
+    ) {
+        return entityId & ENTITY_INDEX_MASK;
+    }
+
+    /**
+    * @brief The generation part of an entity id
+    */
+    inline EntityId
+    entityGeneration(
+        EntityId entityId
+    ) {
+        return entityId >> ENTITY_INDEX_BITS;
+    }
+
+    /**
+    * @brief Combines slot index and generation into an entity id
+    */
+    inline EntityId
+    makeEntityId(
+        EntityId index,
+        EntityId generation
+    ) {
+        return ((generation & ENTITY_GENERATION_MASK) << ENTITY_INDEX_BITS) |
+            (index & ENTITY_INDEX_MASK);
+    }
+
 }
@@ -11,7 +11,7 @@
 
 using namespace thrive;
 
-REGISTER_COMPONENT(TimedLifeComponent)
+REGISTER_COMPONENT_THREAD_SAFE(TimedLifeComponent, Dense)
 
 void TimedLifeComponent::luaBindings(
     sol::state &lua
@@ -73,6 +73,7 @@ struct TimedLifeSystem::Implementation {
 TimedLifeSystem::TimedLifeSystem()
   : m_impl(new Implementation())
 {
+    this->declareWrite(TimedLifeComponent::TYPE_ID);
 }
 
 
@@ -108,7 +108,7 @@ AgentCloudComponent::getPotency() {
 
 }
 
-REGISTER_COMPONENT(AgentCloudComponent)
+REGISTER_COMPONENT_THREAD_SAFE(AgentCloudComponent, Dense)
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -143,6 +143,8 @@ struct AgentCloudSystem::Implementation {
 AgentCloudSystem::AgentCloudSystem()
   : m_impl(new Implementation())
 {
+    this->declareWrite(AgentCloudComponent::TYPE_ID);
+    this->declareWrite(OgreSceneNodeComponent::TYPE_ID);
 }
 
 AgentCloudSystem::~AgentCloudSystem() {
@@ -24,7 +24,7 @@
 
 using namespace thrive;
 
-REGISTER_COMPONENT(CompoundComponent)
+REGISTER_COMPONENT_THREAD_SAFE(CompoundComponent, Dense)
 
 void CompoundComponent::luaBindings(
     sol::state &lua
@@ -94,6 +94,8 @@ struct CompoundMovementSystem::Implementation {
 CompoundMovementSystem::CompoundMovementSystem()
   : m_impl(new Implementation())
 {
+    this->declareRead(CompoundComponent::TYPE_ID);
+    this->declareWrite(RigidBodyComponent::TYPE_ID);
 }
 
 
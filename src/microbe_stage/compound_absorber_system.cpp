@@ -157,7 +157,7 @@ CompoundAbsorberComponent::storage() const {
     return storage;
 }
 
-REGISTER_COMPONENT(CompoundAbsorberComponent)
+REGISTER_COMPONENT_THREAD_SAFE(CompoundAbsorberComponent, Dense)
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -241,6 +241,8 @@ CompoundAbsorberSystem::update(int, int) {
     }
 
     // For all entities that have a membrane and are able to absorb stuff do...
+    // This stays sequential: absorbers take from shared cloud cells, so the
+    // result depends on their order, and agent effects call into Lua.
     for (auto& value : m_impl->m_absorbers)
     {
         //EntityId entity = value.first;
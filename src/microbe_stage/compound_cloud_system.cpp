@@ -10,6 +10,7 @@
 #include "engine/game_state.h"
 #include "engine/player_data.h"
 #include "engine/serialization.h"
+#include "engine/thread_pool.h"
 #include "game.h"
 #include "ogre/scene_node_system.h"
 #include "scripting/luajit.h"
@@ -26,6 +27,8 @@
 #include <OgreRoot.h>
 #include <OgreSubMesh.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string.h>
 #include <cstdio>
 
@@ -33,6 +36,18 @@
 
 using namespace thrive;
 
+// Rows per diffusion task
+static const int DIFFUSION_BAND_ROWS = 30;
+
+// Number of grid cells in a world space offset
+static int
+gridCells(
+    int offset,
+    float gridSize
+) {
+    return static_cast<int>(std::round(offset / gridSize));
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // CompoundCloudComponent
 ////////////////////////////////////////////////////////////////////////////////
@@ -80,8 +95,9 @@ CompoundCloudComponent::load(
     offsetY = storage.get<int>("offsetY", 0);
     gridSize = storage.get<float>("gridSize", 0.0);
 
-    density.resize(width, std::vector<float>(height, 0));
-    oldDens.resize(width, std::vector<float>(height, 0));
+    density = FluidField(width, height);
+    oldDens = FluidField(width, height);
+    tiles = FluidTiles(width, height);
 }
 
 StorageContainer
@@ -104,7 +120,10 @@ CompoundCloudComponent::addCloud(float dens, int x, int y) {
     if ((x-offsetX)/gridSize+width/2 >= 0 && (x-offsetX)/gridSize+width/2 < width &&
         (y-offsetY)/gridSize+height/2 >= 0 && (y-offsetY)/gridSize+height/2 < height)
     {
-        density[(x-offsetX)/gridSize+width/2][(y-offsetY)/gridSize+height/2] += dens;
+        int gridX = (x-offsetX)/gridSize+width/2;
+        int gridY = (y-offsetY)/gridSize+height/2;
+        density(gridX, gridY) += dens;
+        tiles.markChanged(density.bufferX(gridX), density.bufferY(gridY));
     }
 }
 
@@ -113,9 +132,10 @@ CompoundCloudComponent::takeCompound(int x, int y, float rate) {
 
     if (x >= 0 && x < width && y >= 0 && y < height)
     {
-        int amountToGive = static_cast<int>(density[x][y])*rate;
-        density[x][y] -= amountToGive;
-        if (density[x][y] < 1) density[x][y] = 0;
+        int amountToGive = static_cast<int>(density(x, y))*rate;
+        density(x, y) -= amountToGive;
+        if (density(x, y) < 1) density(x, y) = 0;
+        tiles.markChanged(density.bufferX(x), density.bufferY(y));
 
         return amountToGive;
     }
@@ -129,7 +149,7 @@ CompoundCloudComponent::amountAvailable(int x, int y, float rate) {
 
     if (x >= 0 && x < width && y >= 0 && y < height)
     {
-        int amountToGive = static_cast<int>(density[x][y])*rate;
+        int amountToGive = static_cast<int>(density(x, y))*rate;
 
         return amountToGive;
     }
@@ -165,6 +185,223 @@ struct CompoundCloudSystem::Implementation {
     > m_compounds = {true};
 
     Ogre::SceneManager* m_sceneManager = nullptr;
+
+    // Where each cell of the velocity field moves its content
+    AdvectionPlan m_advectionPlan;
+
+    const FluidKernels& m_kernels = FluidKernels::best();
+
+    // A compound cloud drawn by its own pass
+    struct CloudPass {
+        EntityId m_entityId = NULL_ENTITY;
+        CompoundCloudComponent* m_cloud = nullptr;
+        // Whether the cloud was assigned since the last upload
+        bool m_cloudChanged = true;
+        // The origin of the cloud's buffer at the last upload
+        int m_originX = 0;
+        int m_originY = 0;
+        Ogre::Pass* m_pass = nullptr;
+        // The texture's content, to convert only changed tiles
+        std::vector<uint8_t> m_texels;
+        Ogre::TexturePtr m_texture;
+    };
+
+    std::vector<CloudPass> m_passes;
+
+    // Zero density for passes without a cloud
+    FluidField m_emptyRow;
+
+    void
+    addCloud(
+        EntityId entityId,
+        CompoundCloudComponent* compoundCloud,
+        int width,
+        int height
+    ) {
+        for (CloudPass& cloudPass : m_passes) {
+            if (not cloudPass.m_cloud) {
+                setCloud(cloudPass, entityId, compoundCloud);
+                return;
+            }
+        }
+        m_passes.push_back(createPass(width, height));
+        setCloud(m_passes.back(), entityId, compoundCloud);
+    }
+
+    CloudPass
+    createPass(
+        int width,
+        int height
+    ) {
+        CloudPass cloudPass;
+        // Modifies the material to draw this cloud in addition to the others.
+        Ogre::MaterialPtr materialPtr = Ogre::MaterialManager::getSingleton().getByName(
+            "CompoundClouds", "General");
+
+        cloudPass.m_pass = materialPtr->getTechnique(0)->createPass();
+        cloudPass.m_pass->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
+        cloudPass.m_pass->setVertexProgram("CompoundCloud_VS");
+        cloudPass.m_pass->setFragmentProgram("CompoundCloud_PS");
+
+        // Only changed regions are written, so the content has to persist.
+        cloudPass.m_texture = Ogre::TextureManager::getSingleton().createManual(
+            "CompoundClouds" + std::to_string(m_passes.size()),
+            "General", Ogre::TEX_TYPE_2D, width, height,
+            0, Ogre::PF_BYTE_BGRA, Ogre::TU_DYNAMIC_WRITE_ONLY);
+        cloudPass.m_pass->createTextureUnitState()->setTexture(cloudPass.m_texture);
+        cloudPass.m_texels.assign(4 * width * height, 0);
+
+        Ogre::TexturePtr texturePtr = Ogre::TextureManager::getSingleton().load(
+            "PerlinNoise.jpg", "General");
+        cloudPass.m_pass->createTextureUnitState()->setTexture(texturePtr);
+        return cloudPass;
+    }
+
+    void
+    removeCloud(
+        EntityId entityId
+    ) {
+        for (CloudPass& cloudPass : m_passes) {
+            if (cloudPass.m_entityId == entityId) {
+                // The pass uploads zeros until it's reused
+                setCloud(cloudPass, NULL_ENTITY, nullptr);
+                return;
+            }
+        }
+    }
+
+    void
+    setCloud(
+        CloudPass& cloudPass,
+        EntityId entityId,
+        CompoundCloudComponent* compoundCloud
+    ) {
+        cloudPass.m_entityId = entityId;
+        cloudPass.m_cloud = compoundCloud;
+        cloudPass.m_cloudChanged = true;
+        // The colour is written once, uploads only change the densities
+        Ogre::ColourValue colour = compoundCloud ?
+            compoundCloud->color : Ogre::ColourValue(0, 0, 0, 0);
+        for (size_t i = 0; i < cloudPass.m_texels.size(); i += 4) {
+            cloudPass.m_texels[i] = static_cast<uint8_t>(colour.b);
+            cloudPass.m_texels[i + 1] = static_cast<uint8_t>(colour.g);
+            cloudPass.m_texels[i + 2] = static_cast<uint8_t>(colour.r);
+        }
+    }
+
+    /**
+    * @brief Writes the densities of buffer columns [firstX, lastX) of one
+    * row into the alpha of their texels
+    *
+    * @param shift
+    *   Grid column minus buffer column
+    */
+    static void
+    writeDensities(
+        const float* densityRow,
+        int firstX,
+        int lastX,
+        int shift,
+        uint8_t* texelRow
+    ) {
+        uint8_t* alpha = texelRow + 4 * (firstX + shift) + 3;
+        for (int x = firstX; x < lastX; ++x) {
+            int intensity = static_cast<int>(densityRow[x]);
+            *alpha = std::max(0, std::min(intensity, 255));
+            alpha += 4;
+        }
+    }
+
+    void
+    upload(
+        CloudPass& cloudPass,
+        int width,
+        int height
+    ) {
+        const int tileSize = FluidTiles::TILE_SIZE;
+        const int columns = (width + tileSize - 1) / tileSize;
+        const int rows = (height + tileSize - 1) / tileSize;
+        CompoundCloudComponent* compoundCloud = cloudPass.m_cloud;
+        int originX = compoundCloud ? compoundCloud->density.originX() : cloudPass.m_originX;
+        int originY = compoundCloud ? compoundCloud->density.originY() : cloudPass.m_originY;
+        // The texture is in grid order, when the grid moved every texel did
+        bool moved = originX != cloudPass.m_originX or originY != cloudPass.m_originY;
+        cloudPass.m_originX = originX;
+        cloudPass.m_originY = originY;
+        // Changed tiles and their bounds, in buffer coordinates
+        std::vector<uint8_t> changed(columns * rows, cloudPass.m_cloudChanged or moved);
+        if (compoundCloud) {
+            for (int row = 0; row < rows; ++row) {
+                for (int column = 0; column < columns; ++column) {
+                    changed[row * columns + column] |=
+                        compoundCloud->tiles.changed(column, row);
+                }
+            }
+            compoundCloud->tiles.clearChanges();
+        }
+        cloudPass.m_cloudChanged = false;
+        int left = columns, right = -1, bottom = rows, top = -1;
+        for (int row = 0; row < rows; ++row) {
+            for (int column = 0; column < columns; ++column) {
+                if (changed[row * columns + column]) {
+                    left = std::min(left, column);
+                    right = std::max(right, column);
+                    bottom = std::min(bottom, row);
+                    top = std::max(top, row);
+                }
+            }
+        }
+        if (right < 0) {
+            return;
+        }
+        // Converts runs of changed tiles, row by row. The texels are blue,
+        // green, red and the density. The bounds of the converted texels
+        // are tracked in grid coordinates.
+        int minX = width, maxX = 0, minY = height, maxY = 0;
+        for (int row = bottom; row <= top; ++row) {
+            for (int y = row * tileSize; y < std::min((row + 1) * tileSize, height); ++y) {
+                const float* densityRow = compoundCloud ?
+                    compoundCloud->density.row(y) :
+                    m_emptyRow.row(0);
+                int gridY = y >= originY ? y - originY : y - originY + height;
+                minY = std::min(minY, gridY);
+                maxY = std::max(maxY, gridY + 1);
+                // The texture's rows go downwards, the grid's upwards.
+                uint8_t* texels = cloudPass.m_texels.data() + 4 * width * (height - gridY - 1);
+                int column = left;
+                while (column <= right) {
+                    if (not changed[row * columns + column]) {
+                        ++column;
+                        continue;
+                    }
+                    int firstX = column * tileSize;
+                    while (column <= right and changed[row * columns + column]) {
+                        ++column;
+                    }
+                    int lastX = std::min(column * tileSize, width);
+                    // Buffer columns before the origin wrap to the end of
+                    // the grid
+                    if (firstX < originX) {
+                        int end = std::min(lastX, originX);
+                        writeDensities(densityRow, firstX, end, width - originX, texels);
+                        minX = std::min(minX, firstX + width - originX);
+                        maxX = std::max(maxX, end + width - originX);
+                    }
+                    if (lastX > originX) {
+                        int begin = std::max(firstX, originX);
+                        writeDensities(densityRow, begin, lastX, -originX, texels);
+                        minX = std::min(minX, begin - originX);
+                        maxX = std::max(maxX, lastX - originX);
+                    }
+                }
+            }
+        }
+        // Uploads the bounds of the converted texels. Unchanged texels in
+        // there are still current in m_texels.
+        Ogre::Box box(minX, height - maxY, maxX, height - minY);
+        Ogre::PixelBox texels(width, height, 1, Ogre::PF_BYTE_BGRA, cloudPass.m_texels.data());
+        cloudPass.m_texture->getBuffer()->blitFromMemory(texels.getSubVolume(box), box);
+    }
 };
 
 
@@ -177,11 +414,13 @@ CompoundCloudSystem::CompoundCloudSystem()
     offsetX(0),
     offsetY(0),
     gridSize(2),
-    xVelocity(width, std::vector<float>(height, 0)),
-    yVelocity(width, std::vector<float>(height, 0))
+    xVelocity(width, height),
+    yVelocity(width, height)
 {
     // Use the curl of a Perlin noise field to create a turbulent velocity field.
     CreateVelocityField();
+    m_impl->m_advectionPlan = AdvectionPlan(xVelocity, yVelocity);
+    m_impl->m_emptyRow = FluidField(width, 1);
 }
 
 CompoundCloudSystem::~CompoundCloudSystem() {
@@ -246,6 +485,11 @@ CompoundCloudSystem::update(int renderTime, int) {
         compoundCloudsPlane->getParentSceneNode()->setPosition(offsetX, offsetY, -1.0);
     }
 
+    // Free the passes of removed compound clouds.
+    for (EntityId entityId : m_impl->m_compounds.removedEntities()) {
+        m_impl->removeCloud(entityId);
+    }
+
     // For all newly created entities, initialize their parameters.
     for (auto& value : m_impl->m_compounds.addedEntities()) {
         CompoundCloudComponent* compoundCloud = std::get<0>(value.second);
@@ -257,54 +501,18 @@ CompoundCloudSystem::update(int renderTime, int) {
         compoundCloud->offsetY = offsetY;
         compoundCloud->gridSize = gridSize;
 
-        compoundCloud->density.resize(width, std::vector<float>(height, 0));
-        compoundCloud->oldDens.resize(width, std::vector<float>(height, 0));
-
-        // Modifies the material to draw this compound cloud in addition to the others.
-        Ogre::MaterialPtr materialPtr = Ogre::MaterialManager::getSingleton().getByName(
-            "CompoundClouds", "General");
-
-        Ogre::Pass* pass = materialPtr->getTechnique(0)->createPass();
-
-        pass->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
-        pass->setVertexProgram("CompoundCloud_VS");
-        pass->setFragmentProgram("CompoundCloud_PS");
-
-        Ogre::TexturePtr texturePtr = Ogre::TextureManager::getSingleton().createManual(
-            CompoundRegistry::getCompoundInternalName(compoundCloud->m_compoundId),
-            "General", Ogre::TEX_TYPE_2D, width, height,
-            0, Ogre::PF_BYTE_BGRA, Ogre::TU_DYNAMIC_WRITE_ONLY_DISCARDABLE);
-
-        Ogre::HardwarePixelBufferSharedPtr cloud;
-        cloud = texturePtr->getBuffer();
-        cloud->lock(Ogre::HardwareBuffer::HBL_DISCARD);
-        const Ogre::PixelBox& pixelBox = cloud->getCurrentLock();
-
-        uint8_t* pDest = static_cast<uint8_t*>(pixelBox.data);
-
-        // Fill in some pixel data. This will give a semi-transparent blue,
-        // but this is of course dependent on the chosen pixel format.
-        for (int i = 0; i < width; i++)
-        {
-            for(int j = 0; j < height; j++)
-            {
-                // Set the colors in Blue, Green, Red, Alpha format.
-                *pDest++ = compoundCloud->color.b;
-                *pDest++ = compoundCloud->color.g;
-                *pDest++ = compoundCloud->color.r;
-                *pDest++ = 0;
-            }
-            pDest += pixelBox.getRowSkip() * Ogre::PixelUtil::getNumElemBytes(pixelBox.format);
-        }
-        // Unlock the pixel buffer
-        cloud->unlock();
-        pass->createTextureUnitState()->setTexture(texturePtr);
+        compoundCloud->density = FluidField(width, height);
+        compoundCloud->oldDens = FluidField(width, height);
+        compoundCloud->tiles = FluidTiles(width, height);
 
-        texturePtr = Ogre::TextureManager::getSingleton().load("PerlinNoise.jpg", "General");
-        pass->createTextureUnitState()->setTexture(texturePtr);
+        // Starts out scrolled like the other clouds.
+        int cellsX = gridCells(offsetX, gridSize);
+        int cellsY = gridCells(offsetY, gridSize);
+        compoundCloud->density.scroll(cellsX, cellsY);
+        compoundCloud->oldDens.scroll(cellsX, cellsY);
 
-        compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
-            Ogre::Vector4(0.0f, 0.0f, 0.0f, 0.0f));
+        // Draws this compound cloud with a free pass.
+        m_impl->addCloud(value.first, compoundCloud, width, height);
     }
 
     // Clear the list of newly added entities so that we don't reinitialize them next frame.
@@ -315,121 +523,79 @@ CompoundCloudSystem::update(int renderTime, int) {
     {
         CompoundCloudComponent* compoundCloud = std::get<0>(value.second);
         // If the offset of the compound cloud is different from the fluid systems offset,
-        // then the player must have moved, so we need to adjust the texture.
+        // then the player must have moved, so the grid scrolls along. Only the
+        // cells that enter the grid are touched.
         if (compoundCloud->offsetX != offsetX || compoundCloud->offsetY != offsetY)
         {
-            // If we moved up.
-            if (compoundCloud->offsetX == offsetX && compoundCloud->offsetY < offsetY)
-            {
-                for (int x = 0; x < width; x++)
-                {
-                    for (int y = 0; y < height/3; y++)
-                    {
-                        compoundCloud->density[x][y] = compoundCloud->density[x][y+height/3];
-                        compoundCloud->density[x][y+height/3] =
-                            compoundCloud->density[x][y+height*2/3];
-                        compoundCloud->density[x][y+height*2/3] = 0.0;
-                    }
-                }
-                Ogre::Vector4 offset = compoundCloudsPlane->getSubEntity(0)->getCustomParameter(1);
-                compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
-                    Ogre::Vector4(offset.x, offset.y-1.0f/3, 0.0f, 0.0f));
-            }
-            // If we moved right.
-            else if (compoundCloud->offsetX < offsetX && compoundCloud->offsetY == offsetY)
-            {
-                for (int x = 0; x < width/3; x++)
-                {
-                    for (int y = 0; y < height; y++)
-                    {
-                        compoundCloud->density[x][y] = compoundCloud->density[x+height/3][y];
-                        compoundCloud->density[x+height/3][y] =
-                            compoundCloud->density[x+height*2/3][y];
-                        compoundCloud->density[x+height*2/3][y] = 0.0;
-                    }
-                }
-                Ogre::Vector4 offset = compoundCloudsPlane->getSubEntity(0)->getCustomParameter(1);
-                compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
-                    Ogre::Vector4(offset.x-1.0f/3, offset.y, 0.0f, 0.0f));
-            }
-            // If we moved left.
-            else if (compoundCloud->offsetX > offsetX && compoundCloud->offsetY == offsetY)
-            {
-                for (int x = 0; x < width/3; x++)
-                {
-                    for (int y = 0; y < height; y++)
-                    {
-                        compoundCloud->density[x+height*2/3][y] =
-                            compoundCloud->density[x+height/3][y];
-                        compoundCloud->density[x+height/3][y] = compoundCloud->density[x][y];
-                        compoundCloud->density[x][y] = 0.0;
-                    }
-                }
-                Ogre::Vector4 offset = compoundCloudsPlane->getSubEntity(0)->getCustomParameter(1);
-                compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
-                    Ogre::Vector4(offset.x+1.0f/3, offset.y, 0.0f, 0.0f));
-            }
-            // If we moved downwards.
-            else if (compoundCloud->offsetX == offsetX && compoundCloud->offsetY > offsetY)
-            {
-                for (int x = 0; x < width; x++)
-                {
-                    for (int y = 0; y < height/3; y++)
-                    {
-                        compoundCloud->density[x][y+height*2/3] =
-                            compoundCloud->density[x][y+height/3];
-                        compoundCloud->density[x][y+height/3] = compoundCloud->density[x][y];
-                        compoundCloud->density[x][y] = 0.0;
-                    }
-                }
-                Ogre::Vector4 offset = compoundCloudsPlane->getSubEntity(0)->getCustomParameter(1);
-                compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
-                    Ogre::Vector4(offset.x, offset.y+1.0f/3, 0.0f, 0.0f));
-            }
+            int dx = gridCells(offsetX, gridSize) - gridCells(compoundCloud->offsetX, gridSize);
+            int dy = gridCells(offsetY, gridSize) - gridCells(compoundCloud->offsetY, gridSize);
+            compoundCloud->density.scroll(dx, dy);
+            compoundCloud->oldDens.scroll(dx, dy);
+            // Cells that were interior before are on the border now.
+            compoundCloud->oldDens.clearBorder();
 
             compoundCloud->offsetX = offsetX;
             compoundCloud->offsetY = offsetY;
+            compoundCloud->tiles.update(compoundCloud->density);
         }
+    }
 
-        // Compound clouds move from area of high concentration to area of low.
-        diffuse(.01, compoundCloud->oldDens, compoundCloud->density, renderTime);
-        // Move the compound clouds about the velocity field.
-        advect(compoundCloud->oldDens, compoundCloud->density, renderTime);
-
-        // Store the pixel data in a hardware buffer for quick access.
-        Ogre::HardwarePixelBufferSharedPtr cloud;
-        cloud = Ogre::TextureManager::getSingleton().getByName(
-            CompoundRegistry::getCompoundInternalName(compoundCloud->m_compoundId),
-            "General")->getBuffer();
-
-        cloud->lock(Ogre::HardwareBuffer::HBL_DISCARD);
-        const Ogre::PixelBox& pixelBox = cloud->getCurrentLock();
-        uint8_t* pDest = static_cast<uint8_t*>(pixelBox.data);
-        pDest+=3;
+    // The noise moves with the plane.
+    compoundCloudsPlane->getSubEntity(0)->setCustomParameter(1,
+        Ogre::Vector4(-offsetX / (width * gridSize), -offsetY / (height * gridSize), 0.0f, 0.0f));
 
-        // Copy the density vector into the buffer.
-        for (int j = 0; j < height; j++)
+    // The compound clouds are independent of each other and only share the
+    // read only velocity field, so they are simulated in parallel. Diffusion
+    // is split into bands of rows as well. Advection scatters across bands,
+    // so it runs as one task per compound. Empty clouds stay empty and are
+    // skipped.
+    std::vector<ThreadPool::Task> tasks;
+    for (auto& value : m_impl->m_compounds)
+    {
+        CompoundCloudComponent* compoundCloud = std::get<0>(value.second);
+        if (compoundCloud->tiles.empty())
         {
-            for(int i = 0; i < width; i++)
+            continue;
+        }
+        for (int firstRow = 0; firstRow < height; firstRow += DIFFUSION_BAND_ROWS)
+        {
+            int lastRow = std::min(firstRow + DIFFUSION_BAND_ROWS, height);
+            tasks.emplace_back([this, compoundCloud, firstRow, lastRow, renderTime] {
+                // Compound clouds move from area of high concentration to area of low.
+                diffuse(.01, compoundCloud->oldDens, compoundCloud->density, firstRow, lastRow,
+                    renderTime);
+            });
+        }
+    }
+    ThreadPool::global().run(tasks);
+    tasks.clear();
+    for (auto& value : m_impl->m_compounds)
+    {
+        CompoundCloudComponent* compoundCloud = std::get<0>(value.second);
+        if (compoundCloud->tiles.empty())
+        {
+            continue;
+        }
+        tasks.emplace_back([this, compoundCloud, renderTime] {
+            // All bands are diffused, the result becomes the old density.
+            compoundCloud->density.swap(compoundCloud->oldDens);
+            // Move the compound clouds about the velocity field.
+            advect(compoundCloud->oldDens, compoundCloud->density, renderTime);
+            compoundCloud->tiles.update(compoundCloud->density);
+            if (compoundCloud->tiles.empty())
             {
-                int intensity = static_cast<int>(compoundCloud->density[i][height-j-1]);
-
-                if (intensity < 0)
-                {
-                    intensity = 0;
-                }
-                else if (intensity > 255)
-                {
-                    intensity = 255;
-                }
-                *pDest = intensity; // Alpha value of texture.
-                pDest+=4;
+                // Nothing above 1 is left to advect, what's left of the
+                // old density would only fade away.
+                compoundCloud->oldDens.fill(0.0f);
             }
-            pDest += pixelBox.getRowSkip() * Ogre::PixelUtil::getNumElemBytes(pixelBox.format);
-        }
+        });
+    }
+    ThreadPool::global().run(tasks);
 
-        // Unlock the pixel buffer.
-        cloud->unlock();
+    // Textures can only be written on the render thread.
+    for (auto& cloudPass : m_impl->m_passes)
+    {
+        m_impl->upload(cloudPass, width, height);
     }
 }
 
@@ -455,75 +621,27 @@ CompoundCloudSystem::CreateVelocityField() {
 			n1 = fieldPotential.noise(x0, y1, 0);
 			nx = n1 - n0;
 
-			xVelocity[x][y] = nx/2;
-			yVelocity[x][y] = ny/2;
+			xVelocity(x, y) = nx/2;
+			yVelocity(x, y) = ny/2;
 		}
 	}
 }
 
 void
-CompoundCloudSystem::diffuse(float diffRate, std::vector<  std::vector<float>  >& oldDens,
-    const std::vector<  std::vector<float>  >& density, int dt)
+CompoundCloudSystem::diffuse(float diffRate, const FluidField& oldDens, FluidField& density,
+    int firstRow, int lastRow, int dt)
 {
     dt = 1;
     float a = dt*diffRate;
 
-    for (int x = 1; x < width-1; x++)
-    {
-        for (int y = 1; y < height-1; y++)
-        {
-            oldDens[x][y] = (density[x][y] + a*(oldDens[x - 1][y] + oldDens[x + 1][y] +
-                oldDens[x][y-1] + oldDens[x][y+1])) / (1 + 4 * a);
-        }
-    }
+    // The density of this frame isn't needed after diffusing, so the result
+    // is written over it. The caller swaps the buffers once all rows are done.
+    m_impl->m_kernels.diffuse(density, oldDens, a, density, firstRow, lastRow);
 }
 
 void
-CompoundCloudSystem::advect(std::vector<  std::vector<float>  >& oldDens,
-    std::vector<  std::vector<float>  >& density, int dt)
+CompoundCloudSystem::advect(const FluidField& oldDens, FluidField& density, int)
 {
-    dt = 1;
-
-    for (int x = 0; x < width; x++)
-	{
-		for (int y = 0; y < height; y++)
-		{
-			density[x][y] = 0;
-		}
-	}
-
-    float dx, dy;
-    int x0, x1, y0, y1;
-    float s1, s0, t1, t0;
-	for (int x = 1; x < width-1; x++)
-	{
-		for (int y = 1; y < height-1; y++)
-		{
-		    if (oldDens[x][y] > 1) {
-                dx = x + dt*xVelocity[x][y];
-                dy = y + dt*yVelocity[x][y];
-
-                if (dx < 0.5) dx = 0.5;
-                if (dx > width - 1.5) dx = width - 1.5f;
-
-                if (dy < 0.5) dy = 0.5;
-                if (dy > height - 1.5) dy = height - 1.5f;
-
-                x0 = static_cast<int>(dx);
-                x1 = x0 + 1;
-                y0 = static_cast<int>(dy);
-                y1 = y0 + 1;
-
-                s1 = dx - x0;
-                s0 = 1 - s1;
-                t1 = dy - y0;
-                t0 = 1 - t1;
-
-                density[x0][y0] += oldDens[x][y] * s0 * t0;
-                density[x0][y1] += oldDens[x][y] * s0 * t1;
-                density[x1][y0] += oldDens[x][y] * s1 * t0;
-                density[x1][y1] += oldDens[x][y] * s1 * t1;
-		    }
-		}
-	}
+    // The plan is built for a time step of 1.
+    m_impl->m_kernels.advect(oldDens, m_impl->m_advectionPlan, density);
 }
@@ -13,6 +13,7 @@
 #include "general/perlin_noise.h"
 #include "ogre/scene_node_system.h"
 #include "microbe_stage/compound_registry.h"
+#include "microbe_stage/fluid_kernels.h"
 
 namespace thrive {
 
@@ -31,8 +32,8 @@ public:
 	float gridSize;
 
     /// The 2D array that contains the current compound clouds and those from last frame.
-    std::vector<  std::vector<float>  > density;
-    std::vector<  std::vector<float>  > oldDens;
+    FluidField density;
+    FluidField oldDens;
 
     /// The 3x3 grid of density tiles around the player for seamless movement.
     //std::vector<  std::vector<float>  > density_11;
@@ -44,6 +45,9 @@ public:
     //std::vector<  std::vector<float>  > density_32;
     //std::vector<  std::vector<float>  > density_33;
 
+    /// Which tiles of the density have content, and which changed since the texture was updated.
+    FluidTiles tiles;
+
     /// The color of the compound cloud.
     Ogre::ColourValue color;
 
@@ -102,6 +106,17 @@ public:
 
 /**
 * @brief Moves the compound clouds.
+*
+* Each cloud is drawn by its own pass of the "CompoundClouds" material.
+* The first texture unit of a pass holds the cloud's colour in its red,
+* green and blue channels and its density in the alpha channel, the second
+* one the noise texture.
+*
+* The clouds' fields are ring buffers, when the player leaves the middle of
+* the grid only the origin moves. The textures are in grid order, so the
+* buffers are unrolled when they are uploaded and a whole texture is
+* rewritten after the grid moved. Custom parameter 1 of the plane is the
+* offset of the noise texture.
 */
 class CompoundCloudSystem : public System {
 
@@ -160,12 +175,14 @@ private:
 	float gridSize;
 
     /// The velocity of the fluid.
-	std::vector<  std::vector<float>  > xVelocity;
-	std::vector<  std::vector<float>  > yVelocity;
+	FluidField xVelocity;
+	FluidField yVelocity;
 
 	void CreateVelocityField();
-	void diffuse(float diffRate, std::vector<  std::vector<float>  >& oldDens, const std::vector<  std::vector<float>  >& density, int dt);
-	void advect(std::vector<  std::vector<float>  >& oldDens, std::vector<  std::vector<float>  >& density, int dt);
+	// Diffuses rows [firstRow, lastRow) into density. Safe to call concurrently for disjoint rows.
+	void diffuse(float diffRate, const FluidField& oldDens, FluidField& density, int firstRow,
+	    int lastRow, int dt);
+	void advect(const FluidField& oldDens, FluidField& density, int dt);
 
     // Clears the density field file to blank (black).
     void initializeFile(std::string compoundName);
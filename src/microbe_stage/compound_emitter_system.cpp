@@ -4,6 +4,7 @@
 #include "bullet/rigid_body_system.h"
 #include "engine/component_factory.h"
 #include "engine/engine.h"
+#include "engine/entity_command_buffer.h"
 #include "engine/entity_filter.h"
 #include "engine/game_state.h"
 #include "engine/rng.h"
@@ -159,6 +160,9 @@ struct CompoundEmitterSystem::Implementation {
 		Optional<TimedCompoundEmitterComponent>
     > m_entities;
 
+    // Emitted particles, created after iterating over the emitters
+    EntityCommandBuffer m_emissions;
+
     Ogre::SceneManager* m_sceneManager = nullptr;
 };
 
@@ -199,7 +203,7 @@ emitCompound(
     double radius,
     CompoundEmitterComponent* emitterComponent,
     EntityId emittingEntityId,
-    GameStateData* currentState
+    EntityCommandBuffer& commands
 ) {
 
     Ogre::Vector3 emissionOffset(0,0,0);
@@ -221,7 +225,7 @@ emitCompound(
         radius * Ogre::Math::Cos(emissionAngle),
         0.0
     );
-    EntityId compoundEntityId = currentState->entityManager()->generateNewId();
+    auto compoundEntity = commands.createEntity();
     // Scene Node
     auto compoundSceneNodeComponent = make_unique<OgreSceneNodeComponent>();
     auto meshScale = CompoundRegistry::getCompoundMeshScale(compoundId);
@@ -255,8 +259,8 @@ emitCompound(
     components.emplace_back(std::move(compoundRigidBodyComponent));
     components.emplace_back(std::move(collisionHandler));
     for (auto& component : components) {
-        currentState->entityManager()->addComponent(
-            compoundEntityId,
+        commands.addComponent(
+            compoundEntity,
             std::move(component)
         );
     }
@@ -275,7 +279,8 @@ CompoundEmitterSystem::update(int, int logicTime) {
         {
             emitCompound(std::get<0>(emission), std::get<1>(emission),
                 sceneNodeComponent->m_transform.position, std::get<2>(emission),
-                std::get<3>(emission), emitterComponent, value.first, gameState());
+                std::get<3>(emission), emitterComponent, value.first,
+                m_impl->m_emissions);
         }
         emitterComponent->m_compoundEmissions.clear();
         if (timedEmitterComponent)
@@ -295,9 +300,10 @@ CompoundEmitterSystem::update(int, int logicTime) {
                         timedEmitterComponent->m_potencyPerParticle,
                         sceneNodeComponent->m_transform.position, angle,
                         emitterComponent->m_emissionRadius, emitterComponent, value.first,
-                        gameState());
+                        m_impl->m_emissions);
                 }
             }
         }
     }
+    m_impl->m_emissions.playback(*this->entityManager());
 }
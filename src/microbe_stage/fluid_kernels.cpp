@@ -0,0 +1,791 @@
+#include "microbe_stage/fluid_kernels.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define THRIVE_FLUID_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(THRIVE_FLUID_SSE2) && defined(__GNUC__)
+#define THRIVE_FLUID_AVX2
+#include <immintrin.h>
+#define THRIVE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+using namespace thrive;
+
+////////////////////////////////////////////////////////////////////////////////
+// FluidField
+////////////////////////////////////////////////////////////////////////////////
+
+static const int FLOATS_PER_ALIGNMENT = FluidField::ALIGNMENT / sizeof(float);
+
+
+FluidField::FluidField() = default;
+
+
+FluidField::FluidField(
+    int width,
+    int height
+) : m_height(height),
+    m_stride((width + FLOATS_PER_ALIGNMENT - 1) / FLOATS_PER_ALIGNMENT * FLOATS_PER_ALIGNMENT),
+    m_width(width)
+{
+    m_buffer.reset(new float[m_stride * m_height + FLOATS_PER_ALIGNMENT]());
+    size_t address = reinterpret_cast<size_t>(m_buffer.get());
+    size_t padding = (ALIGNMENT - address % ALIGNMENT) % ALIGNMENT;
+    m_data = m_buffer.get() + padding / sizeof(float);
+}
+
+
+FluidField::FluidField(
+    const FluidField& other
+) : FluidField(other.m_width, other.m_height)
+{
+    std::memcpy(m_data, other.m_data, m_stride * m_height * sizeof(float));
+    m_originX = other.m_originX;
+    m_originY = other.m_originY;
+}
+
+
+FluidField::FluidField(
+    FluidField&& other
+) : FluidField()
+{
+    this->swap(other);
+}
+
+
+FluidField&
+FluidField::operator= (
+    FluidField other
+) {
+    this->swap(other);
+    return *this;
+}
+
+
+void
+FluidField::clearBorder() {
+    std::fill(this->row(m_originY), this->row(m_originY) + m_width, 0.0f);
+    float* last = this->row(this->bufferY(m_height - 1));
+    std::fill(last, last + m_width, 0.0f);
+    const int lastX = this->bufferX(m_width - 1);
+    for (int y = 0; y < m_height; ++y) {
+        float* cells = this->row(y);
+        cells[m_originX] = 0.0f;
+        cells[lastX] = 0.0f;
+    }
+}
+
+
+void
+FluidField::fill(
+    float value
+) {
+    std::fill(m_data, m_data + m_stride * m_height, value);
+}
+
+
+void
+FluidField::scroll(
+    int dx,
+    int dy
+) {
+    if (m_width == 0 or m_height == 0) {
+        return;
+    }
+    m_originX = ((m_originX + dx) % m_width + m_width) % m_width;
+    m_originY = ((m_originY + dy) % m_height + m_height) % m_height;
+    if (std::abs(dx) >= m_width or std::abs(dy) >= m_height) {
+        this->fill(0.0f);
+        return;
+    }
+    // The cells that left on one side now enter on the other
+    int firstX = dx > 0 ? m_width - dx : 0;
+    int lastX = dx > 0 ? m_width : -dx;
+    for (int x = firstX; x < lastX; ++x) {
+        int column = this->bufferX(x);
+        for (int y = 0; y < m_height; ++y) {
+            this->row(y)[column] = 0.0f;
+        }
+    }
+    int firstY = dy > 0 ? m_height - dy : 0;
+    int lastY = dy > 0 ? m_height : -dy;
+    for (int y = firstY; y < lastY; ++y) {
+        float* cells = this->row(this->bufferY(y));
+        std::fill(cells, cells + m_width, 0.0f);
+    }
+}
+
+
+void
+FluidField::swap(
+    FluidField& other
+) {
+    std::swap(m_buffer, other.m_buffer);
+    std::swap(m_data, other.m_data);
+    std::swap(m_height, other.m_height);
+    std::swap(m_originX, other.m_originX);
+    std::swap(m_originY, other.m_originY);
+    std::swap(m_stride, other.m_stride);
+    std::swap(m_width, other.m_width);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FluidTiles
+////////////////////////////////////////////////////////////////////////////////
+
+FluidTiles::FluidTiles(
+    int width,
+    int height
+) : m_columns((width + TILE_SIZE - 1) / TILE_SIZE),
+    m_rows((height + TILE_SIZE - 1) / TILE_SIZE)
+{
+    m_changed.assign(m_columns * m_rows, 1);
+    m_occupied.assign(m_columns * m_rows, 0);
+}
+
+
+void
+FluidTiles::clearChanges() {
+    std::fill(m_changed.begin(), m_changed.end(), 0);
+}
+
+
+void
+FluidTiles::markAllChanged() {
+    std::fill(m_changed.begin(), m_changed.end(), 1);
+    std::fill(m_occupied.begin(), m_occupied.end(), 1);
+    m_occupiedCount = m_occupied.size();
+}
+
+
+void
+FluidTiles::markChanged(
+    int x,
+    int y
+) {
+    size_t index = (y / TILE_SIZE) * m_columns + x / TILE_SIZE;
+    m_changed[index] = 1;
+    if (not m_occupied[index]) {
+        m_occupied[index] = 1;
+        ++m_occupiedCount;
+    }
+}
+
+
+void
+FluidTiles::update(
+    const FluidField& field
+) {
+    m_occupiedCount = 0;
+    for (int row = 0; row < m_rows; ++row) {
+        int firstY = row * TILE_SIZE;
+        int lastY = std::min(firstY + TILE_SIZE, field.height());
+        for (int column = 0; column < m_columns; ++column) {
+            int firstX = column * TILE_SIZE;
+            int lastX = std::min(firstX + TILE_SIZE, field.width());
+            bool occupied = false;
+            for (int y = firstY; y < lastY and not occupied; ++y) {
+                const float* cells = field.row(y);
+                for (int x = firstX; x < lastX; ++x) {
+                    if (cells[x] != 0.0f) {
+                        occupied = true;
+                        break;
+                    }
+                }
+            }
+            size_t index = row * m_columns + column;
+            if (occupied or m_occupied[index]) {
+                m_changed[index] = 1;
+            }
+            m_occupied[index] = occupied;
+            m_occupiedCount += occupied;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AdvectionPlan
+////////////////////////////////////////////////////////////////////////////////
+
+AdvectionPlan::AdvectionPlan(
+    const FluidField& xVelocity,
+    const FluidField& yVelocity
+) : m_height(xVelocity.height()),
+    m_targets(xVelocity.width() * xVelocity.height()),
+    m_weights(4 * xVelocity.width(), xVelocity.height()),
+    m_width(xVelocity.width())
+{
+    if (yVelocity.width() != m_width or yVelocity.height() != m_height) {
+        throw std::runtime_error("Velocity fields differ in size");
+    }
+    for (int y = 0; y < m_height; ++y) {
+        for (int x = 0; x < m_width; ++x) {
+            float dx = x + xVelocity(x, y);
+            float dy = y + yVelocity(x, y);
+            dx = std::min(std::max(dx, 0.5f), m_width - 1.5f);
+            dy = std::min(std::max(dy, 0.5f), m_height - 1.5f);
+            int x0 = static_cast<int>(dx);
+            int y0 = static_cast<int>(dy);
+            float s1 = dx - x0;
+            float s0 = 1 - s1;
+            float t1 = dy - y0;
+            float t0 = 1 - t1;
+            m_targets[y * m_width + x] = Target{x0, y0};
+            float* weights = m_weights.row(y) + 4 * x;
+            weights[0] = s0 * t0;
+            weights[1] = s1 * t0;
+            weights[2] = s0 * t1;
+            weights[3] = s1 * t1;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Scalar kernels
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/**
+* @brief The buffer rows around one buffer row of a field
+*/
+struct RowNeighbours {
+
+    /**
+    * @brief Whether the row is on the edge of the grid
+    */
+    bool border;
+
+    int above;
+
+    int below;
+
+};
+
+
+RowNeighbours
+rowNeighbours(
+    const FluidField& field,
+    int y
+) {
+    const int height = field.height();
+    int gridY = y - field.originY();
+    if (gridY < 0) {
+        gridY += height;
+    }
+    return RowNeighbours{
+        gridY == 0 or gridY == height - 1,
+        y == 0 ? height - 1 : y - 1,
+        y == height - 1 ? 0 : y + 1
+    };
+}
+
+
+inline float
+diffuseValue(
+    float source,
+    float left,
+    float right,
+    float above,
+    float below,
+    float rate,
+    float scale
+) {
+    return (source + rate * (left + right + above + below)) / scale;
+}
+
+
+/**
+* @brief Diffuses the first and last cell of a buffer row
+*
+* Their neighbours wrap around the buffer, which the vector loops can't
+* load. The vector loops cover the cells in between.
+*/
+inline void
+diffuseRowEnds(
+    const float* source,
+    const float* above,
+    const float* centre,
+    const float* below,
+    float rate,
+    float scale,
+    int width,
+    float* target
+) {
+    const int last = width - 1;
+    target[0] = diffuseValue(source[0], centre[last], centre[1], above[0], below[0], rate, scale);
+    target[last] = diffuseValue(
+        source[last], centre[last - 1], centre[0], above[last], below[last], rate, scale
+    );
+}
+
+
+/**
+* @brief Sets the cells of a buffer row on the left and right edge of the
+* grid to 0
+*/
+inline void
+clearSeam(
+    const FluidField& field,
+    float* target
+) {
+    target[field.originX()] = 0.0f;
+    target[field.bufferX(field.width() - 1)] = 0.0f;
+}
+
+
+void
+diffuseScalar(
+    const FluidField& density,
+    const FluidField& oldDens,
+    float rate,
+    FluidField& out,
+    int firstRow,
+    int lastRow
+) {
+    const int width = out.width();
+    const float scale = 1 + 4 * rate;
+    for (int y = firstRow; y < lastRow; ++y) {
+        float* target = out.row(y);
+        RowNeighbours neighbours = rowNeighbours(out, y);
+        if (neighbours.border) {
+            std::fill(target, target + width, 0.0f);
+            continue;
+        }
+        const float* source = density.row(y);
+        const float* above = oldDens.row(neighbours.above);
+        const float* centre = oldDens.row(y);
+        const float* below = oldDens.row(neighbours.below);
+        diffuseRowEnds(source, above, centre, below, rate, scale, width, target);
+        for (int x = 1; x < width - 1; ++x) {
+            target[x] = diffuseValue(
+                source[x], centre[x - 1], centre[x + 1], above[x], below[x], rate, scale
+            );
+        }
+        clearSeam(out, target);
+    }
+}
+
+
+/**
+* @brief A contiguous run of grid columns in the buffer
+*
+* Grid column x is at buffer column x + offset.
+*/
+struct Segment {
+
+    int first;
+
+    int last;
+
+    int offset;
+
+};
+
+
+/**
+* @brief Splits the interior grid columns where they wrap around the buffer
+*
+* @return
+*   The number of segments written to \a segments, 1 or 2
+*/
+int
+interiorSegments(
+    const FluidField& field,
+    Segment segments[2]
+) {
+    const int width = field.width();
+    const int wrap = width - field.originX();
+    segments[0] = Segment{1, std::min(width - 1, wrap), field.originX()};
+    segments[1] = Segment{std::max(1, wrap), width - 1, field.originX() - width};
+    return segments[1].first < segments[1].last ? 2 : 1;
+}
+
+
+/**
+* @brief Adds \a amount times \a weights to the four targets of a cell
+*/
+inline void
+scatterScalar(
+    FluidField& density,
+    const AdvectionPlan::Target& target,
+    float amount,
+    const float* weights
+) {
+    const int left = density.bufferX(target.x);
+    const int right = density.bufferX(target.x + 1);
+    float* top = density.row(density.bufferY(target.y));
+    float* bottom = density.row(density.bufferY(target.y + 1));
+    top[left] += amount * weights[0];
+    top[right] += amount * weights[1];
+    bottom[left] += amount * weights[2];
+    bottom[right] += amount * weights[3];
+}
+
+
+void
+advectScalar(
+    const FluidField& oldDens,
+    const AdvectionPlan& plan,
+    FluidField& density
+) {
+    density.fill(0.0f);
+    Segment segments[2];
+    const int segmentCount = interiorSegments(density, segments);
+    for (int y = 1; y < density.height() - 1; ++y) {
+        const float* source = oldDens.row(density.bufferY(y));
+        for (int i = 0; i < segmentCount; ++i) {
+            const int offset = segments[i].offset;
+            for (int x = segments[i].first; x < segments[i].last; ++x) {
+                if (source[x + offset] > 1) {
+                    scatterScalar(density, plan.target(x, y), source[x + offset], plan.weights(x, y));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2 kernels
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef THRIVE_FLUID_SSE2
+
+namespace {
+
+void
+diffuseSSE2(
+    const FluidField& density,
+    const FluidField& oldDens,
+    float rate,
+    FluidField& out,
+    int firstRow,
+    int lastRow
+) {
+    const int width = out.width();
+    const float scale = 1 + 4 * rate;
+    const __m128 rates = _mm_set1_ps(rate);
+    const __m128 scales = _mm_set1_ps(scale);
+    for (int y = firstRow; y < lastRow; ++y) {
+        float* target = out.row(y);
+        RowNeighbours neighbours = rowNeighbours(out, y);
+        if (neighbours.border) {
+            std::fill(target, target + width, 0.0f);
+            continue;
+        }
+        const float* source = density.row(y);
+        const float* above = oldDens.row(neighbours.above);
+        const float* centre = oldDens.row(y);
+        const float* below = oldDens.row(neighbours.below);
+        diffuseRowEnds(source, above, centre, below, rate, scale, width, target);
+        int x = 1;
+        for (; x + 4 <= width - 1; x += 4) {
+            __m128 sum = _mm_add_ps(
+                _mm_add_ps(
+                    _mm_add_ps(_mm_loadu_ps(centre + x - 1), _mm_loadu_ps(centre + x + 1)),
+                    _mm_loadu_ps(above + x)
+                ),
+                _mm_loadu_ps(below + x)
+            );
+            __m128 value = _mm_add_ps(_mm_loadu_ps(source + x), _mm_mul_ps(rates, sum));
+            _mm_storeu_ps(target + x, _mm_div_ps(value, scales));
+        }
+        for (; x < width - 1; ++x) {
+            target[x] = diffuseValue(
+                source[x], centre[x - 1], centre[x + 1], above[x], below[x], rate, scale
+            );
+        }
+        clearSeam(out, target);
+    }
+}
+
+
+/**
+* @brief Scatters one cell with a single multiplication
+*
+* Unless the targets wrap around the buffer, the two top targets and the two
+* bottom targets are adjacent in memory, so each pair is updated with one
+* 64 bit load and store.
+*/
+inline void
+scatterSSE2(
+    FluidField& density,
+    const AdvectionPlan::Target& target,
+    float amount,
+    const float* weights
+) {
+    __m128 parts = _mm_mul_ps(_mm_set1_ps(amount), _mm_load_ps(weights));
+    const int left = density.bufferX(target.x);
+    const int right = density.bufferX(target.x + 1);
+    float* top = density.row(density.bufferY(target.y));
+    float* bottom = density.row(density.bufferY(target.y + 1));
+    if (right == left + 1) {
+        __m64* topPair = reinterpret_cast<__m64*>(top + left);
+        __m64* bottomPair = reinterpret_cast<__m64*>(bottom + left);
+        _mm_storel_pi(topPair, _mm_add_ps(_mm_loadl_pi(_mm_setzero_ps(), topPair), parts));
+        _mm_storel_pi(bottomPair, _mm_add_ps(
+            _mm_loadl_pi(_mm_setzero_ps(), bottomPair),
+            _mm_movehl_ps(parts, parts)
+        ));
+    }
+    else {
+        alignas(16) float values[4];
+        _mm_store_ps(values, parts);
+        top[left] += values[0];
+        top[right] += values[1];
+        bottom[left] += values[2];
+        bottom[right] += values[3];
+    }
+}
+
+
+void
+advectSSE2(
+    const FluidField& oldDens,
+    const AdvectionPlan& plan,
+    FluidField& density
+) {
+    density.fill(0.0f);
+    Segment segments[2];
+    const int segmentCount = interiorSegments(density, segments);
+    const __m128 threshold = _mm_set1_ps(1.0f);
+    for (int y = 1; y < density.height() - 1; ++y) {
+        const float* source = oldDens.row(density.bufferY(y));
+        for (int i = 0; i < segmentCount; ++i) {
+            const int offset = segments[i].offset;
+            const int last = segments[i].last;
+            int x = segments[i].first;
+            // Most cells are empty, test four at a time
+            for (; x + 4 <= last; x += 4) {
+                int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(source + (x + offset)), threshold));
+                for (int lane = 0; mask; ++lane, mask >>= 1) {
+                    if (mask & 1) {
+                        scatterSSE2(
+                            density,
+                            plan.target(x + lane, y),
+                            source[x + lane + offset],
+                            plan.weights(x + lane, y)
+                        );
+                    }
+                }
+            }
+            for (; x < last; ++x) {
+                if (source[x + offset] > 1) {
+                    scatterSSE2(density, plan.target(x, y), source[x + offset], plan.weights(x, y));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+#endif // THRIVE_FLUID_SSE2
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2 kernels
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef THRIVE_FLUID_AVX2
+
+namespace {
+
+THRIVE_TARGET_AVX2 void
+diffuseAVX2(
+    const FluidField& density,
+    const FluidField& oldDens,
+    float rate,
+    FluidField& out,
+    int firstRow,
+    int lastRow
+) {
+    const int width = out.width();
+    const float scale = 1 + 4 * rate;
+    const __m256 rates = _mm256_set1_ps(rate);
+    const __m256 scales = _mm256_set1_ps(scale);
+    for (int y = firstRow; y < lastRow; ++y) {
+        float* target = out.row(y);
+        RowNeighbours neighbours = rowNeighbours(out, y);
+        if (neighbours.border) {
+            std::fill(target, target + width, 0.0f);
+            continue;
+        }
+        const float* source = density.row(y);
+        const float* above = oldDens.row(neighbours.above);
+        const float* centre = oldDens.row(y);
+        const float* below = oldDens.row(neighbours.below);
+        diffuseRowEnds(source, above, centre, below, rate, scale, width, target);
+        int x = 1;
+        for (; x + 8 <= width - 1; x += 8) {
+            __m256 sum = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_add_ps(_mm256_loadu_ps(centre + x - 1), _mm256_loadu_ps(centre + x + 1)),
+                    _mm256_loadu_ps(above + x)
+                ),
+                _mm256_loadu_ps(below + x)
+            );
+            __m256 value = _mm256_add_ps(_mm256_loadu_ps(source + x), _mm256_mul_ps(rates, sum));
+            _mm256_storeu_ps(target + x, _mm256_div_ps(value, scales));
+        }
+        for (; x < width - 1; ++x) {
+            target[x] = diffuseValue(
+                source[x], centre[x - 1], centre[x + 1], above[x], below[x], rate, scale
+            );
+        }
+        clearSeam(out, target);
+    }
+}
+
+
+THRIVE_TARGET_AVX2 void
+advectAVX2(
+    const FluidField& oldDens,
+    const AdvectionPlan& plan,
+    FluidField& density
+) {
+    density.fill(0.0f);
+    Segment segments[2];
+    const int segmentCount = interiorSegments(density, segments);
+    const __m256 threshold = _mm256_set1_ps(1.0f);
+    for (int y = 1; y < density.height() - 1; ++y) {
+        const float* source = oldDens.row(density.bufferY(y));
+        for (int i = 0; i < segmentCount; ++i) {
+            const int offset = segments[i].offset;
+            const int last = segments[i].last;
+            int x = segments[i].first;
+            // The scatter itself stays 128 bits wide, each cell only has four
+            // targets
+            for (; x + 8 <= last; x += 8) {
+                int mask = _mm256_movemask_ps(
+                    _mm256_cmp_ps(_mm256_loadu_ps(source + (x + offset)), threshold, _CMP_GT_OQ)
+                );
+                for (int lane = 0; mask; ++lane, mask >>= 1) {
+                    if (mask & 1) {
+                        scatterSSE2(
+                            density,
+                            plan.target(x + lane, y),
+                            source[x + lane + offset],
+                            plan.weights(x + lane, y)
+                        );
+                    }
+                }
+            }
+            for (; x < last; ++x) {
+                if (source[x + offset] > 1) {
+                    scatterSSE2(density, plan.target(x, y), source[x + offset], plan.weights(x, y));
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+#endif // THRIVE_FLUID_AVX2
+
+
+////////////////////////////////////////////////////////////////////////////////
+// FluidKernels
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const FluidKernels SCALAR_KERNELS = {
+    &diffuseScalar,
+    &advectScalar,
+    FluidKernels::InstructionSet::Scalar,
+    "scalar"
+};
+
+#ifdef THRIVE_FLUID_SSE2
+const FluidKernels SSE2_KERNELS = {
+    &diffuseSSE2,
+    &advectSSE2,
+    FluidKernels::InstructionSet::SSE2,
+    "SSE2"
+};
+#endif
+
+#ifdef THRIVE_FLUID_AVX2
+const FluidKernels AVX2_KERNELS = {
+    &diffuseAVX2,
+    &advectAVX2,
+    FluidKernels::InstructionSet::AVX2,
+    "AVX2"
+};
+#endif
+
+} // namespace
+
+
+const FluidKernels&
+FluidKernels::best() {
+    static const FluidKernels& kernels = supported(InstructionSet::AVX2) ?
+        get(InstructionSet::AVX2) :
+        supported(InstructionSet::SSE2) ?
+            get(InstructionSet::SSE2) :
+            get(InstructionSet::Scalar);
+    return kernels;
+}
+
+
+const FluidKernels&
+FluidKernels::get(
+    InstructionSet instructionSet
+) {
+    if (not supported(instructionSet)) {
+        throw std::runtime_error("Fluid kernels not supported by this CPU");
+    }
+    switch (instructionSet) {
+#ifdef THRIVE_FLUID_AVX2
+        case InstructionSet::AVX2:
+            return AVX2_KERNELS;
+#endif
+#ifdef THRIVE_FLUID_SSE2
+        case InstructionSet::SSE2:
+            return SSE2_KERNELS;
+#endif
+        default:
+            return SCALAR_KERNELS;
+    }
+}
+
+
+bool
+FluidKernels::supported(
+    InstructionSet instructionSet
+) {
+    switch (instructionSet) {
+        case InstructionSet::Scalar:
+            return true;
+        case InstructionSet::SSE2:
+#ifdef THRIVE_FLUID_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case InstructionSet::AVX2:
+#ifdef THRIVE_FLUID_AVX2
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
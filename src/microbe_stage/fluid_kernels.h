@@ -0,0 +1,537 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace thrive {
+
+/**
+* @brief A 2D float field in a single aligned, toroidal buffer
+*
+* The float counterpart of RollingGrid. Cells are addressed in grid
+* coordinates, the buffer wraps around an origin: grid cell (x, y) is
+* stored in buffer cell ((x + originX) % width, (y + originY) % height).
+* scroll() moves the grid by changing the origin and clearing the cells
+* that enter, no other cell is touched.
+*
+* The buffer is row major, rows are padded to a multiple of ALIGNMENT
+* bytes, so every row starts aligned for SIMD loads.
+*/
+class FluidField {
+
+public:
+
+    /**
+    * @brief Alignment of each row in bytes
+    */
+    static const size_t ALIGNMENT = 32;
+
+    /**
+    * @brief Creates an empty field
+    */
+    FluidField();
+
+    /**
+    * @brief Creates a field with all cells set to 0 and the origin at (0, 0)
+    *
+    * @param width
+    *   Number of columns
+    * @param height
+    *   Number of rows
+    */
+    FluidField(
+        int width,
+        int height
+    );
+
+    FluidField(
+        const FluidField& other
+    );
+
+    FluidField(
+        FluidField&& other
+    );
+
+    FluidField&
+    operator= (
+        FluidField other
+    );
+
+    /**
+    * @brief Accesses grid cell (x, y)
+    *
+    * Coordinates are not checked.
+    */
+    float&
+    operator() (
+        int x,
+        int y
+    ) {
+        return m_data[this->bufferY(y) * m_stride + this->bufferX(x)];
+    }
+
+    /**
+    * @overload
+    */
+    float
+    operator() (
+        int x,
+        int y
+    ) const {
+        return m_data[this->bufferY(y) * m_stride + this->bufferX(x)];
+    }
+
+    /**
+    * @brief The buffer column of grid column \a x
+    */
+    int
+    bufferX(
+        int x
+    ) const {
+        x += m_originX;
+        return x < m_width ? x : x - m_width;
+    }
+
+    /**
+    * @brief The buffer row of grid row \a y
+    */
+    int
+    bufferY(
+        int y
+    ) const {
+        y += m_originY;
+        return y < m_height ? y : y - m_height;
+    }
+
+    /**
+    * @brief Sets the cells on the edge of the grid to 0
+    */
+    void
+    clearBorder();
+
+    /**
+    * @brief Sets all cells, including the padding, to \a value
+    */
+    void
+    fill(
+        float value
+    );
+
+    /**
+    * @brief Number of rows
+    */
+    int
+    height() const {
+        return m_height;
+    }
+
+    /**
+    * @brief Buffer column of grid column 0
+    */
+    int
+    originX() const {
+        return m_originX;
+    }
+
+    /**
+    * @brief Buffer row of grid row 0
+    */
+    int
+    originY() const {
+        return m_originY;
+    }
+
+    /**
+    * @brief The first cell of buffer row \a y
+    *
+    * Buffer rows, unlike grid rows, don't depend on the origin.
+    */
+    float*
+    row(
+        int y
+    ) {
+        return m_data + y * m_stride;
+    }
+
+    /**
+    * @overload
+    */
+    const float*
+    row(
+        int y
+    ) const {
+        return m_data + y * m_stride;
+    }
+
+    /**
+    * @brief Moves the grid by (\a dx, \a dy) cells
+    *
+    * Afterwards, grid cell (x, y) holds what grid cell (x + dx, y + dy)
+    * held before. Cells that enter the grid are set to 0. Any direction
+    * and distance is fine.
+    */
+    void
+    scroll(
+        int dx,
+        int dy
+    );
+
+    /**
+    * @brief Distance between two rows in floats
+    */
+    int
+    stride() const {
+        return m_stride;
+    }
+
+    /**
+    * @brief Exchanges the content of two fields without copying
+    */
+    void
+    swap(
+        FluidField& other
+    );
+
+    /**
+    * @brief Number of columns
+    */
+    int
+    width() const {
+        return m_width;
+    }
+
+private:
+
+    std::unique_ptr<float[]> m_buffer;
+
+    // The first aligned float in m_buffer
+    float* m_data = nullptr;
+
+    int m_height = 0;
+
+    int m_originX = 0;
+
+    int m_originY = 0;
+
+    int m_stride = 0;
+
+    int m_width = 0;
+
+};
+
+
+/**
+* @brief Tracks which tiles of a FluidField have content and changed
+*
+* The field's buffer is split into square tiles of TILE_SIZE cells, so
+* tiles don't move when the field scrolls. A tile is
+* occupied when any of its cells is not 0, and changed when its cells
+* were modified since the last clearChanges(). Occupancy is conservative:
+* tiles marked as changed count as occupied until the next update().
+*/
+class FluidTiles {
+
+public:
+
+    /**
+    * @brief Side length of a tile in cells
+    */
+    static const int TILE_SIZE = 8;
+
+    /**
+    * @brief Creates an empty tracker
+    */
+    FluidTiles() = default;
+
+    /**
+    * @brief Creates a tracker for an empty field
+    *
+    * All tiles start out as changed, so that the whole field is shown once.
+    *
+    * @param width
+    *   Number of columns of the field
+    * @param height
+    *   Number of rows of the field
+    */
+    FluidTiles(
+        int width,
+        int height
+    );
+
+    /**
+    * @brief Whether tile (column, row) changed
+    */
+    bool
+    changed(
+        int column,
+        int row
+    ) const {
+        return m_changed[row * m_columns + column];
+    }
+
+    /**
+    * @brief Clears the changed flags
+    */
+    void
+    clearChanges();
+
+    /**
+    * @brief Number of tile columns
+    */
+    int
+    columns() const {
+        return m_columns;
+    }
+
+    /**
+    * @brief Whether no tile is occupied
+    */
+    bool
+    empty() const {
+        return m_occupiedCount == 0;
+    }
+
+    /**
+    * @brief Marks all tiles as changed and occupied
+    */
+    void
+    markAllChanged();
+
+    /**
+    * @brief Marks the tile of buffer cell (x, y) as changed and occupied
+    */
+    void
+    markChanged(
+        int x,
+        int y
+    );
+
+    /**
+    * @brief Whether tile (column, row) is occupied
+    */
+    bool
+    occupied(
+        int column,
+        int row
+    ) const {
+        return m_occupied[row * m_columns + column];
+    }
+
+    /**
+    * @brief Number of tile rows
+    */
+    int
+    rows() const {
+        return m_rows;
+    }
+
+    /**
+    * @brief Updates occupancy after all of \a field may have changed
+    *
+    * Tiles that are occupied before or after are marked as changed. Tiles
+    * that stayed empty are not.
+    */
+    void
+    update(
+        const FluidField& field
+    );
+
+private:
+
+    std::vector<uint8_t> m_changed;
+
+    int m_columns = 0;
+
+    std::vector<uint8_t> m_occupied;
+
+    int m_occupiedCount = 0;
+
+    int m_rows = 0;
+
+};
+
+
+/**
+* @brief Precomputed targets and weights of the advection step
+*
+* The velocity field of the clouds doesn't change, so neither does where
+* each cell's content goes. The plan stores, for each cell, the grid
+* coordinates of the top left of the four cells it is scattered to and
+* their bilinear weights.
+*/
+class AdvectionPlan {
+
+public:
+
+    /**
+    * @brief Creates an empty plan
+    */
+    AdvectionPlan() = default;
+
+    /**
+    * @brief Creates the plan for a velocity field
+    *
+    * @param xVelocity
+    *   Velocity along x in cells per step
+    * @param yVelocity
+    *   Velocity along y in cells per step, must have the same size
+    */
+    AdvectionPlan(
+        const FluidField& xVelocity,
+        const FluidField& yVelocity
+    );
+
+    /**
+    * @brief Grid coordinates of the top left target of a cell
+    *
+    * The other targets are the next cell and the two cells below those.
+    */
+    struct Target {
+        int32_t x;
+        int32_t y;
+    };
+
+    /**
+    * @brief The top left target of grid cell (x, y)
+    */
+    const Target&
+    target(
+        int x,
+        int y
+    ) const {
+        return m_targets[y * m_width + x];
+    }
+
+    /**
+    * @brief The four weights of grid cell (x, y)
+    *
+    * In the order top left, top right, bottom left, bottom right. Aligned
+    * to 16 bytes.
+    */
+    const float*
+    weights(
+        int x,
+        int y
+    ) const {
+        return m_weights.row(y) + 4 * x;
+    }
+
+    /**
+    * @brief Number of columns of the velocity field
+    */
+    int
+    width() const {
+        return m_width;
+    }
+
+    /**
+    * @brief Number of rows of the velocity field
+    */
+    int
+    height() const {
+        return m_height;
+    }
+
+private:
+
+    int m_height = 0;
+
+    std::vector<Target> m_targets;
+
+    FluidField m_weights;
+
+    int m_width = 0;
+
+};
+
+
+/**
+* @brief The diffusion and advection steps of the compound clouds
+*
+* There is a scalar reference implementation and SSE2 and AVX2 versions
+* that produce the same results. Use FluidKernels::best() to get the
+* widest one the CPU supports.
+*
+* The kernels work on the buffers of the fields, wrapping around where the
+* grid does. All fields passed to one call must have the same size and
+* origin. The results don't depend on the origin.
+*/
+struct FluidKernels {
+
+    enum class InstructionSet {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    /**
+    * @brief The fastest kernels supported by this CPU
+    */
+    static const FluidKernels&
+    best();
+
+    /**
+    * @brief The kernels for \a instructionSet
+    *
+    * @throws std::runtime_error if the CPU doesn't support \a instructionSet
+    */
+    static const FluidKernels&
+    get(
+        InstructionSet instructionSet
+    );
+
+    /**
+    * @brief Whether the CPU supports \a instructionSet
+    */
+    static bool
+    supported(
+        InstructionSet instructionSet
+    );
+
+    /**
+    * @brief Diffuses buffer rows \a firstRow to \a lastRow (exclusive)
+    *
+    * Each interior cell of the grid becomes
+    * (density + rate * (sum of the 4 neighbours in oldDens)) / (1 + 4 * rate).
+    * Cells on the edge of the grid are set to 0.
+    *
+    * This is a Jacobi step, cells only read \a oldDens, so rows can be
+    * computed in any order. \a out may be \a density, but not \a oldDens.
+    */
+    void (*diffuse)(
+        const FluidField& density,
+        const FluidField& oldDens,
+        float rate,
+        FluidField& out,
+        int firstRow,
+        int lastRow
+    );
+
+    /**
+    * @brief Moves \a oldDens along the velocity field into \a density
+    *
+    * \a density is cleared first. Each interior grid cell of \a oldDens with
+    * more than 1 unit is scattered to its four targets in \a plan, other
+    * cells are dropped.
+    */
+    void (*advect)(
+        const FluidField& oldDens,
+        const AdvectionPlan& plan,
+        FluidField& density
+    );
+
+    /**
+    * @brief The instruction set the kernels use
+    */
+    InstructionSet instructionSet;
+
+    /**
+    * @brief Name of the instruction set, for logging
+    */
+    const char* name;
+
+};
+
+}
@@ -337,7 +337,7 @@ sol::object MembraneComponent::getExternOrganellePos(double x, double y)
 
 
 
-REGISTER_COMPONENT(MembraneComponent)
+REGISTER_COMPONENT_THREAD_SAFE(MembraneComponent, Dense)
 
 
 ////////////////////////////////////////////////////////////////////////////////
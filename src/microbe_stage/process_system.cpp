@@ -21,7 +21,7 @@
 
 using namespace thrive;
 
-REGISTER_COMPONENT(ProcessorComponent)
+REGISTER_COMPONENT_THREAD_SAFE(ProcessorComponent, Dense)
 
 void ProcessorComponent::luaBindings(
     sol::state &lua
@@ -71,7 +71,7 @@ ProcessorComponent::setCapacity(BioProcessId id, double capacity)
     this->process_capacities[id] = capacity;
 }
 
-REGISTER_COMPONENT(CompoundBagComponent)
+REGISTER_COMPONENT_WITH_STORAGE(CompoundBagComponent, Dense)
 
 void CompoundBagComponent::luaBindings(
     sol::state &lua
@@ -228,6 +228,7 @@ struct ProcessSystem::Implementation {
     > m_entities;
 
     void update(int);
+    void updateBag(CompoundBagComponent* bag, int logicTime);
     void updateAddedEntites(int);
     void updateRemovedEntities(int);
 
@@ -249,7 +250,11 @@ struct ProcessSystem::Implementation {
 };
 
 ProcessSystem::ProcessSystem()
-    : m_impl(new Implementation()) {}
+    : m_impl(new Implementation())
+{
+    this->declareWrite(CompoundBagComponent::TYPE_ID);
+    this->declareRead(ProcessorComponent::TYPE_ID);
+}
 
 ProcessSystem::~ProcessSystem() {}
 
@@ -431,131 +436,138 @@ ProcessSystem::Implementation::_getOptimalProcessRate(
 
 void
 ProcessSystem::Implementation::update(int logicTime) {
-    //Iterating on each entity with a ProcessorComponent.
-    for (auto& value : this->m_entities) {
-        CompoundBagComponent* bag = std::get<0>(value.second);
-        ProcessorComponent* processor = bag->processor;
-
-        // Calculating the storage space occupied;
-        bag->storageSpaceOccupied = 0;
-        for (const auto& compound : bag->compounds) {
-            double compoundAmount = compound.second.amount;
-            bag->storageSpaceOccupied += compoundAmount;
-        }
+    // Each bag is solved independently, so they can be spread over all cores
+    this->m_entities.parallelForEach([this, logicTime](const auto& value) {
+        this->updateBag(std::get<0>(value.second), logicTime);
+    });
+}
 
-        // Calculating the storage space available. The storage space capacity is increased
-        double storageSpaceAvailable = std::max(bag->storageSpace - bag->storageSpaceOccupied, 0.0);
+void
+ProcessSystem::Implementation::updateBag(
+    CompoundBagComponent* bag,
+    int logicTime
+) {
+    ProcessorComponent* processor = bag->processor;
 
-        // Phase one: setting up the compound information.
-        for (const auto& compound : bag->compounds) {
-            CompoundId compoundId = compound.first;
-            CompoundData &compoundData = bag->compounds[compoundId];
+    // Calculating the storage space occupied;
+    bag->storageSpaceOccupied = 0;
+    for (const auto& compound : bag->compounds) {
+        double compoundAmount = compound.second.amount;
+        bag->storageSpaceOccupied += compoundAmount;
+    }
 
-            // Edge case to get the prices above 0 if some demand exists.
-            if(compoundData.demand > 0 && compoundData.uninflatedPrice <= 0)
-                compoundData.uninflatedPrice = MIN_POSITIVE_COMPOUND_PRICE;
+    // Calculating the storage space available. The storage space capacity is increased
+    double storageSpaceAvailable = std::max(bag->storageSpace - bag->storageSpaceOccupied, 0.0);
 
-            // Adjusting the prices according to supply and demand.
-            double oldPrice = compoundData.uninflatedPrice;
-            compoundData.uninflatedPrice =  ProcessSystem::Implementation::_calculatePrice(oldPrice, compoundData.amount, compoundData.demand);
+    // Phase one: setting up the compound information.
+    for (const auto& compound : bag->compounds) {
+        CompoundId compoundId = compound.first;
+        CompoundData &compoundData = bag->compounds[compoundId];
 
-            if(compoundData.demand > 0 && compoundData.uninflatedPrice <= MIN_POSITIVE_COMPOUND_PRICE)
-                compoundData.uninflatedPrice = MIN_POSITIVE_COMPOUND_PRICE;
+        // Edge case to get the prices above 0 if some demand exists.
+        if(compoundData.demand > 0 && compoundData.uninflatedPrice <= 0)
+            compoundData.uninflatedPrice = MIN_POSITIVE_COMPOUND_PRICE;
 
-            // Setting the prices to 0 if they're below MIN_POSITIVE_COMPOUND_PRICE.
-            if(compoundData.uninflatedPrice < MIN_POSITIVE_COMPOUND_PRICE) {
-                compoundData.uninflatedPrice = 0;
-                compoundData.priceReductionPerUnit = 0;
-            }
+        // Adjusting the prices according to supply and demand.
+        double oldPrice = compoundData.uninflatedPrice;
+        compoundData.uninflatedPrice =  ProcessSystem::Implementation::_calculatePrice(oldPrice, compoundData.amount, compoundData.demand);
 
-            // Calculating how much the price would fall if we had one more unit,
-            // To make predictions with the demand.
-            else {
-                double reducedPrice =  ProcessSystem::Implementation::_calculatePrice(oldPrice, compoundData.amount + 1, compoundData.demand);
-                compoundData.priceReductionPerUnit = compoundData.uninflatedPrice - reducedPrice;
-            }
+        if(compoundData.demand > 0 && compoundData.uninflatedPrice <= MIN_POSITIVE_COMPOUND_PRICE)
+            compoundData.uninflatedPrice = MIN_POSITIVE_COMPOUND_PRICE;
 
-            //Inflating the price if the compound is useful outside of this system.
-            compoundData.price = compoundData.uninflatedPrice;
-            if(CompoundRegistry::isUseful(compoundId))
-            {
-                compoundData.price += (IMPORTANT_COMPOUND_BIAS + bag->storageSpace) / (compoundData.amount + 1);
-                double reducedPrice = (IMPORTANT_COMPOUND_BIAS + bag->storageSpace) / (compoundData.amount + 2);
-                compoundData.priceReductionPerUnit += compoundData.price - reducedPrice;
-            }
+        // Setting the prices to 0 if they're below MIN_POSITIVE_COMPOUND_PRICE.
+        if(compoundData.uninflatedPrice < MIN_POSITIVE_COMPOUND_PRICE) {
+            compoundData.uninflatedPrice = 0;
+            compoundData.priceReductionPerUnit = 0;
+        }
 
-            // Calculating the break-even point
-            if(compoundData.price <= 0.0)
-                compoundData.breakEvenPoint = 0;
-            else
-                compoundData.breakEvenPoint = compoundData.price / compoundData.priceReductionPerUnit;
+        // Calculating how much the price would fall if we had one more unit,
+        // To make predictions with the demand.
+        else {
+            double reducedPrice =  ProcessSystem::Implementation::_calculatePrice(oldPrice, compoundData.amount + 1, compoundData.demand);
+            compoundData.priceReductionPerUnit = compoundData.uninflatedPrice - reducedPrice;
+        }
 
-            // Setting the demand to 0 in order to recalculate it later.
-            compoundData.demand = 0;
+        //Inflating the price if the compound is useful outside of this system.
+        compoundData.price = compoundData.uninflatedPrice;
+        if(CompoundRegistry::isUseful(compoundId))
+        {
+            compoundData.price += (IMPORTANT_COMPOUND_BIAS + bag->storageSpace) / (compoundData.amount + 1);
+            double reducedPrice = (IMPORTANT_COMPOUND_BIAS + bag->storageSpace) / (compoundData.amount + 2);
+            compoundData.priceReductionPerUnit += compoundData.price - reducedPrice;
         }
 
-        // Phase two: setting up the processes.
-        for (const auto& process : processor->process_capacities) {
-            BioProcessId processId = process.first;
-            double processCapacity = process.second;
+        // Calculating the break-even point
+        if(compoundData.price <= 0.0)
+            compoundData.breakEvenPoint = 0;
+        else
+            compoundData.breakEvenPoint = compoundData.price / compoundData.priceReductionPerUnit;
+
+        // Setting the demand to 0 in order to recalculate it later.
+        compoundData.demand = 0;
+    }
 
-            double processLimitCapacity = processCapacity * logicTime; // big enough number.
+    // Phase two: setting up the processes.
+    for (const auto& process : processor->process_capacities) {
+        BioProcessId processId = process.first;
+        double processCapacity = process.second;
 
+        double processLimitCapacity = processCapacity * logicTime; // big enough number.
+
+        for (const auto& input : BioProcessRegistry::getInputCompounds(processId)) {
+            CompoundId inputId = input.first;
+            int inputNeeded = input.second;
+
+            // Limiting the process by the amount of this required compound.
+            processLimitCapacity = std::min(processLimitCapacity, bag->compounds[inputId].amount / inputNeeded);
+        }
+
+        // Calculating the desired rate, with some liberal use of linearization.
+
+        // Calculating the optimal process rate without considering the storage space.
+        double desiredRate = ProcessSystem::Implementation::_getOptimalProcessRate(
+                                                    processId,
+                                                    bag,
+                                                    false,
+                                                    storageSpaceAvailable);
+
+        // Calculating the optimal process rate considering the storage space.
+        double desiredRateWithSpace = ProcessSystem::Implementation::_getOptimalProcessRate(
+                                                            processId,
+                                                            bag,
+                                                            true,
+                                                            storageSpaceAvailable);
+
+        desiredRateWithSpace = std::min(desiredRateWithSpace, desiredRate);
+        if(desiredRate > 0.0)
+        {
+            double rate = std::min(processCapacity * logicTime / 1000, processLimitCapacity);
+            rate = std::min(rate, desiredRateWithSpace);
+
+            // Running the process at the specified rate, transforming the inputs...
             for (const auto& input : BioProcessRegistry::getInputCompounds(processId)) {
                 CompoundId inputId = input.first;
                 int inputNeeded = input.second;
+                bag->compounds[inputId].amount -= rate * inputNeeded;
 
-                // Limiting the process by the amount of this required compound.
-                processLimitCapacity = std::min(processLimitCapacity, bag->compounds[inputId].amount / inputNeeded);
+                // Phase 3: increasing the input compound demand.
+                bag->compounds[inputId].demand += desiredRate * inputNeeded * ProcessSystem::Implementation::_demandSofteningFunction(processCapacity * inputNeeded);
             }
 
-            // Calculating the desired rate, with some liberal use of linearization.
-
-            // Calculating the optimal process rate without considering the storage space.
-            double desiredRate = ProcessSystem::Implementation::_getOptimalProcessRate(
-                                                        processId,
-                                                        bag,
-                                                        false,
-                                                        storageSpaceAvailable);
-
-            // Calculating the optimal process rate considering the storage space.
-            double desiredRateWithSpace = ProcessSystem::Implementation::_getOptimalProcessRate(
-                                                                processId,
-                                                                bag,
-                                                                true,
-                                                                storageSpaceAvailable);
-
-            desiredRateWithSpace = std::min(desiredRateWithSpace, desiredRate);
-            if(desiredRate > 0.0)
-            {
-                double rate = std::min(processCapacity * logicTime / 1000, processLimitCapacity);
-                rate = std::min(rate, desiredRateWithSpace);
-
-                // Running the process at the specified rate, transforming the inputs...
-                for (const auto& input : BioProcessRegistry::getInputCompounds(processId)) {
-                    CompoundId inputId = input.first;
-                    int inputNeeded = input.second;
-                    bag->compounds[inputId].amount -= rate * inputNeeded;
-
-                    // Phase 3: increasing the input compound demand.
-                    bag->compounds[inputId].demand += desiredRate * inputNeeded * ProcessSystem::Implementation::_demandSofteningFunction(processCapacity * inputNeeded);
-                }
-
-                // ...into the outputs.
-                for (const auto& output : BioProcessRegistry::getOutputCompounds(processId)) {
-                    CompoundId outputId = output.first;
-                    int outputGenerated = output.second;
-                    bag->compounds[outputId].amount += rate * outputGenerated;
-                }
+            // ...into the outputs.
+            for (const auto& output : BioProcessRegistry::getOutputCompounds(processId)) {
+                CompoundId outputId = output.first;
+                int outputGenerated = output.second;
+                bag->compounds[outputId].amount += rate * outputGenerated;
             }
         }
+    }
 
-        // Making sure the compound amount is not negative.
-        for (const auto& compound : bag->compounds) {
-            CompoundId compoundId = compound.first;
-            CompoundData &compoundData = bag->compounds[compoundId];
-            compoundData.amount = std::max(compoundData.amount, 0.0);
-        }
+    // Making sure the compound amount is not negative.
+    for (const auto& compound : bag->compounds) {
+        CompoundId compoundId = compound.first;
+        CompoundData &compoundData = bag->compounds[compoundId];
+        compoundData.amount = std::max(compoundData.amount, 0.0);
     }
 }
 
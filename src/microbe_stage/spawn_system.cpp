@@ -71,7 +71,7 @@ SpawnedComponent::storage() const {
     return storage;
 }
 
-REGISTER_COMPONENT(SpawnedComponent)
+REGISTER_COMPONENT_THREAD_SAFE(SpawnedComponent, Dense)
 
 ////////////////////////////////////////////////////////////////////////////////
 // SpawnSystem
@@ -0,0 +1,374 @@
+#include "microbe_stage/fluid_kernels.h"
+
+#include "engine/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace thrive;
+
+namespace {
+
+const FluidKernels::InstructionSet INSTRUCTION_SETS[] = {
+    FluidKernels::InstructionSet::SSE2,
+    FluidKernels::InstructionSet::AVX2
+};
+
+/**
+* @brief A field with a few dense blobs and random noise
+*/
+FluidField
+randomField(
+    int width,
+    int height,
+    unsigned int seed
+) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> noise(0.0f, 2.0f);
+    std::uniform_real_distribution<float> blob(0.0f, 500.0f);
+    FluidField field(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            field(x, y) = (x / 7 + y / 5) % 3 == 0 ? blob(rng) : noise(rng);
+        }
+    }
+    return field;
+}
+
+
+void
+expectFieldsEqual(
+    const FluidField& expected,
+    const FluidField& actual
+) {
+    ASSERT_EQ(expected.width(), actual.width());
+    ASSERT_EQ(expected.height(), actual.height());
+    for (int y = 0; y < expected.height(); ++y) {
+        for (int x = 0; x < expected.width(); ++x) {
+            ASSERT_FLOAT_EQ(expected(x, y), actual(x, y)) << "at " << x << ", " << y;
+        }
+    }
+}
+
+
+/**
+* @brief A copy of \a field with its grid starting at buffer cell
+* (\a originX, \a originY)
+*/
+FluidField
+rotated(
+    const FluidField& field,
+    int originX,
+    int originY
+) {
+    FluidField result(field.width(), field.height());
+    result.scroll(originX, originY);
+    for (int y = 0; y < field.height(); ++y) {
+        for (int x = 0; x < field.width(); ++x) {
+            result(x, y) = field(x, y);
+        }
+    }
+    return result;
+}
+
+
+float
+total(
+    const FluidField& field
+) {
+    double sum = 0.0;
+    for (int y = 0; y < field.height(); ++y) {
+        for (int x = 0; x < field.width(); ++x) {
+            sum += field(x, y);
+        }
+    }
+    return sum;
+}
+
+} // namespace
+
+
+TEST(FluidField, Layout) {
+    FluidField field(13, 5);
+    EXPECT_EQ(13, field.width());
+    EXPECT_EQ(5, field.height());
+    EXPECT_EQ(0, field.stride() * sizeof(float) % FluidField::ALIGNMENT);
+    for (int y = 0; y < field.height(); ++y) {
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(field.row(y)) % FluidField::ALIGNMENT);
+        for (int x = 0; x < field.width(); ++x) {
+            EXPECT_EQ(0.0f, field(x, y));
+        }
+    }
+    field(3, 4) = 1.5f;
+    EXPECT_EQ(1.5f, field.row(4)[3]);
+    FluidField copy = field;
+    field(3, 4) = 2.0f;
+    EXPECT_EQ(1.5f, copy(3, 4));
+    copy.swap(field);
+    EXPECT_EQ(2.0f, copy(3, 4));
+    EXPECT_EQ(1.5f, field(3, 4));
+}
+
+
+TEST(FluidField, Scroll) {
+    FluidField field(6, 4);
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 6; ++x) {
+            field(x, y) = 10 * y + x + 1;
+        }
+    }
+    FluidField expected = field;
+    // Diagonal, then back in the other direction
+    field.scroll(2, 1);
+    EXPECT_EQ(2, field.originX());
+    EXPECT_EQ(1, field.originY());
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 6; ++x) {
+            bool entered = x >= 4 or y >= 3;
+            EXPECT_EQ(entered ? 0.0f : expected(x + 2, y + 1), field(x, y)) << x << ", " << y;
+        }
+    }
+    field.scroll(-3, -1);
+    EXPECT_EQ(5, field.originX());
+    EXPECT_EQ(0, field.originY());
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 6; ++x) {
+            bool kept = x >= 3 and y >= 1;
+            EXPECT_EQ(kept ? expected(x - 1, y) : 0.0f, field(x, y)) << x << ", " << y;
+        }
+    }
+    // The buffer itself didn't move
+    EXPECT_EQ(expected(3, 2), field.row(2)[3]);
+    FluidField copy = field;
+    EXPECT_EQ(5, copy.originX());
+    EXPECT_EQ(field(4, 1), copy(4, 1));
+    // Scrolling further than the grid clears it
+    field.scroll(-6, 2);
+    EXPECT_EQ(5, field.originX());
+    EXPECT_EQ(2, field.originY());
+    for (int y = 0; y < 4; ++y) {
+        for (int x = 0; x < 6; ++x) {
+            EXPECT_EQ(0.0f, field(x, y));
+        }
+    }
+    copy.clearBorder();
+    EXPECT_EQ(0.0f, copy(4, 0));
+    EXPECT_EQ(0.0f, copy(5, 1));
+    EXPECT_EQ(expected(3, 1), copy(4, 1));
+}
+
+
+TEST(FluidTiles, Tracking) {
+    const int size = FluidTiles::TILE_SIZE;
+    // The last tile column and row are partial
+    FluidField field(2 * size + 3, size + 1);
+    FluidTiles tiles(field.width(), field.height());
+    ASSERT_EQ(3, tiles.columns());
+    ASSERT_EQ(2, tiles.rows());
+    EXPECT_TRUE(tiles.empty());
+    EXPECT_TRUE(tiles.changed(2, 1));
+    tiles.clearChanges();
+    EXPECT_FALSE(tiles.changed(2, 1));
+    // Empty tiles that stay empty don't change
+    tiles.update(field);
+    EXPECT_FALSE(tiles.changed(0, 0));
+    EXPECT_TRUE(tiles.empty());
+    // Marked by hand
+    field(size + 1, 2) = 5.0f;
+    tiles.markChanged(size + 1, 2);
+    EXPECT_FALSE(tiles.empty());
+    EXPECT_TRUE(tiles.changed(1, 0));
+    EXPECT_TRUE(tiles.occupied(1, 0));
+    EXPECT_FALSE(tiles.changed(0, 0));
+    tiles.clearChanges();
+    // Content moves to the partial corner tile
+    field(size + 1, 2) = 0.0f;
+    field(2 * size + 2, size) = 1.0f;
+    tiles.update(field);
+    EXPECT_TRUE(tiles.changed(1, 0));
+    EXPECT_FALSE(tiles.occupied(1, 0));
+    EXPECT_TRUE(tiles.changed(2, 1));
+    EXPECT_TRUE(tiles.occupied(2, 1));
+    EXPECT_FALSE(tiles.changed(0, 1));
+    EXPECT_FALSE(tiles.empty());
+    tiles.clearChanges();
+    field(2 * size + 2, size) = 0.0f;
+    tiles.update(field);
+    EXPECT_TRUE(tiles.changed(2, 1));
+    EXPECT_TRUE(tiles.empty());
+    tiles.markAllChanged();
+    EXPECT_FALSE(tiles.empty());
+    EXPECT_TRUE(tiles.changed(0, 1));
+}
+
+
+TEST(FluidKernels, ScalarDiffuse) {
+    const float rate = 0.01f;
+    FluidField density(5, 4);
+    FluidField oldDens(5, 4);
+    density(2, 1) = 10.0f;
+    oldDens(1, 1) = 4.0f;
+    oldDens(2, 2) = 8.0f;
+    oldDens(0, 0) = 100.0f;
+    FluidField out(5, 4);
+    out.fill(-1.0f);
+    FluidKernels::get(FluidKernels::InstructionSet::Scalar).diffuse(
+        density, oldDens, rate, out, 0, 4
+    );
+    EXPECT_FLOAT_EQ((10.0f + rate * 12.0f) / (1 + 4 * rate), out(2, 1));
+    EXPECT_FLOAT_EQ(rate * 12.0f / (1 + 4 * rate), out(1, 2));
+    for (int x = 0; x < 5; ++x) {
+        EXPECT_EQ(0.0f, out(x, 0));
+        EXPECT_EQ(0.0f, out(x, 3));
+    }
+    for (int y = 0; y < 4; ++y) {
+        EXPECT_EQ(0.0f, out(0, y));
+        EXPECT_EQ(0.0f, out(4, y));
+    }
+}
+
+
+TEST(FluidKernels, ScalarAdvect) {
+    FluidField xVelocity(6, 6);
+    FluidField yVelocity(6, 6);
+    xVelocity(2, 2) = 1.25f;
+    yVelocity(2, 2) = 0.5f;
+    // Clamped to the interior
+    xVelocity(4, 4) = 10.0f;
+    AdvectionPlan plan(xVelocity, yVelocity);
+    FluidField oldDens(6, 6);
+    oldDens(2, 2) = 8.0f;
+    oldDens(4, 4) = 2.0f;
+    // Too little to move
+    oldDens(1, 1) = 0.5f;
+    FluidField density(6, 6);
+    density(0, 0) = 3.0f;
+    FluidKernels::get(FluidKernels::InstructionSet::Scalar).advect(oldDens, plan, density);
+    EXPECT_FLOAT_EQ(8.0f * 0.75f * 0.5f, density(3, 2));
+    EXPECT_FLOAT_EQ(8.0f * 0.25f * 0.5f, density(4, 2));
+    EXPECT_FLOAT_EQ(8.0f * 0.75f * 0.5f, density(3, 3));
+    EXPECT_FLOAT_EQ(8.0f * 0.25f * 0.5f, density(4, 3));
+    EXPECT_FLOAT_EQ(2.0f * 0.5f, density(4, 4));
+    EXPECT_FLOAT_EQ(2.0f * 0.5f, density(5, 4));
+    EXPECT_EQ(0.0f, density(0, 0));
+    EXPECT_EQ(0.0f, density(1, 1));
+    EXPECT_FLOAT_EQ(10.0f, total(density));
+}
+
+
+TEST(FluidKernels, MatchScalar) {
+    const FluidKernels& scalar = FluidKernels::get(FluidKernels::InstructionSet::Scalar);
+    // Odd sizes exercise the remainder loops
+    for (int width : {120, 37}) {
+        const int height = 29;
+        AdvectionPlan plan(
+            randomField(width, height, 1),
+            randomField(width, height, 2)
+        );
+        for (auto instructionSet : INSTRUCTION_SETS) {
+            if (not FluidKernels::supported(instructionSet)) {
+                continue;
+            }
+            const FluidKernels& kernels = FluidKernels::get(instructionSet);
+            SCOPED_TRACE(kernels.name);
+            FluidField expectedDensity = randomField(width, height, 3);
+            FluidField expectedOld = randomField(width, height, 4);
+            FluidField density = expectedDensity;
+            FluidField oldDens = expectedOld;
+            // A few frames, as the cloud system runs them
+            for (int frame = 0; frame < 3; ++frame) {
+                scalar.diffuse(expectedDensity, expectedOld, 0.01f, expectedDensity, 0, height);
+                expectedDensity.swap(expectedOld);
+                scalar.advect(expectedOld, plan, expectedDensity);
+                kernels.diffuse(density, oldDens, 0.01f, density, 0, height);
+                density.swap(oldDens);
+                kernels.advect(oldDens, plan, density);
+                expectFieldsEqual(expectedOld, oldDens);
+                expectFieldsEqual(expectedDensity, density);
+            }
+        }
+    }
+}
+
+
+TEST(FluidKernels, ScrolledMatchesUnscrolled) {
+    const int width = 37;
+    const int height = 29;
+    AdvectionPlan plan(
+        randomField(width, height, 1),
+        randomField(width, height, 2)
+    );
+    // Origins that put the seam in the middle, at the edges and next to them
+    const std::pair<int, int> origins[] = {
+        std::make_pair(17, 11), std::make_pair(1, height - 1), std::make_pair(width - 1, 1),
+        std::make_pair(width - 2, 2)
+    };
+    for (auto instructionSet : {
+        FluidKernels::InstructionSet::Scalar,
+        FluidKernels::InstructionSet::SSE2,
+        FluidKernels::InstructionSet::AVX2
+    }) {
+        if (not FluidKernels::supported(instructionSet)) {
+            continue;
+        }
+        const FluidKernels& kernels = FluidKernels::get(instructionSet);
+        SCOPED_TRACE(kernels.name);
+        for (auto origin : origins) {
+            FluidField expectedDensity = randomField(width, height, 3);
+            FluidField expectedOld = randomField(width, height, 4);
+            FluidField density = rotated(expectedDensity, origin.first, origin.second);
+            FluidField oldDens = rotated(expectedOld, origin.first, origin.second);
+            for (int frame = 0; frame < 3; ++frame) {
+                kernels.diffuse(expectedDensity, expectedOld, 0.01f, expectedDensity, 0, height);
+                expectedDensity.swap(expectedOld);
+                kernels.advect(expectedOld, plan, expectedDensity);
+                kernels.diffuse(density, oldDens, 0.01f, density, 0, height);
+                density.swap(oldDens);
+                kernels.advect(oldDens, plan, density);
+            }
+            // Same operations in the same order, so exactly the same results
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    ASSERT_EQ(expectedDensity(x, y), density(x, y)) << "at " << x << ", " << y;
+                    ASSERT_EQ(expectedOld(x, y), oldDens(x, y)) << "at " << x << ", " << y;
+                }
+            }
+        }
+    }
+}
+
+
+TEST(FluidKernels, DiffuseRowBands) {
+    const FluidKernels& kernels = FluidKernels::best();
+    FluidField density = randomField(40, 30, 5);
+    FluidField oldDens = randomField(40, 30, 6);
+    FluidField whole(40, 30);
+    kernels.diffuse(density, oldDens, 0.01f, whole, 0, 30);
+    // Written over the density like CompoundCloudSystem does, concurrently.
+    // The bands are buffer rows, the grid wraps around inside them.
+    oldDens = rotated(oldDens, 9, 13);
+    FluidField banded = rotated(density, 9, 13);
+    ThreadPool threadPool(3);
+    std::vector<ThreadPool::Task> tasks;
+    for (auto band : {std::make_pair(0, 1), std::make_pair(1, 17), std::make_pair(17, 30)}) {
+        tasks.emplace_back([&, band] {
+            kernels.diffuse(banded, oldDens, 0.01f, banded, band.first, band.second);
+        });
+    }
+    threadPool.run(tasks);
+    expectFieldsEqual(whole, banded);
+}
+
+
+TEST(FluidKernels, UnsupportedThrows) {
+    EXPECT_TRUE(FluidKernels::supported(FluidKernels::InstructionSet::Scalar));
+    for (auto instructionSet : INSTRUCTION_SETS) {
+        if (not FluidKernels::supported(instructionSet)) {
+            EXPECT_THROW(FluidKernels::get(instructionSet), std::runtime_error);
+        }
+    }
+}
@@ -0,0 +1,112 @@
+#include "engine/system_scheduler.h"
+
+#include "bullet/bullet_to_ogre_system.h"
+#include "bullet/collision_system.h"
+#include "bullet/rigid_body_system.h"
+#include "bullet/update_physics_system.h"
+#include "engine/system.h"
+#include "engine/thread_pool.h"
+#include "general/timed_life_system.h"
+#include "microbe_stage/compound.h"
+#include "microbe_stage/compound_absorber_system.h"
+#include "microbe_stage/process_system.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+using namespace thrive;
+
+// The systems below are in the order of the microbe stage's system list in
+// scripts/microbe_stage/setup.lua. Keep them in sync.
+
+namespace {
+
+bool
+accesses(
+    const System& system,
+    ComponentTypeId typeId
+) {
+    const auto& reads = system.readComponents();
+    const auto& writes = system.writtenComponents();
+    return std::find(reads.begin(), reads.end(), typeId) != reads.end()
+        or std::find(writes.begin(), writes.end(), typeId) != writes.end();
+}
+
+
+void
+expectNoConflicts(
+    const SystemScheduler& scheduler
+) {
+    for (size_t index = 0; index < scheduler.stageCount(); ++index) {
+        const std::vector<System*>& stage = scheduler.stage(index);
+        for (System* writer : stage) {
+            for (ComponentTypeId typeId : writer->writtenComponents()) {
+                for (System* other : stage) {
+                    EXPECT_TRUE(other == writer or not accesses(*other, typeId))
+                        << "Stage " << index << " reads and writes type " << typeId;
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+
+TEST(MicrobeStageSystems, CompoundStages) {
+    ThreadPool pool(2);
+    SystemScheduler scheduler(pool);
+    TimedLifeSystem timedLifeSystem;
+    CompoundMovementSystem compoundMovementSystem;
+    CompoundAbsorberSystem compoundAbsorberSystem;
+    ProcessSystem processSystem;
+    scheduler.addSystem(&timedLifeSystem);
+    scheduler.addSystem(&compoundMovementSystem);
+    scheduler.addSystem(&compoundAbsorberSystem);
+    scheduler.addSystem(&processSystem);
+    ASSERT_EQ(3u, scheduler.stageCount());
+    EXPECT_EQ(
+        (std::vector<System*>{&timedLifeSystem, &compoundMovementSystem}),
+        scheduler.stage(0)
+    );
+    // The absorber calls into Lua
+    EXPECT_EQ((std::vector<System*>{&compoundAbsorberSystem}), scheduler.stage(1));
+    EXPECT_EQ((std::vector<System*>{&processSystem}), scheduler.stage(2));
+    expectNoConflicts(scheduler);
+}
+
+
+TEST(MicrobeStageSystems, PhysicsStages) {
+    ThreadPool pool(2);
+    SystemScheduler scheduler(pool);
+    RigidBodyInputSystem rigidBodyInputSystem;
+    UpdatePhysicsSystem updatePhysicsSystem;
+    RigidBodyOutputSystem rigidBodyOutputSystem;
+    BulletToOgreSystem bulletToOgreSystem;
+    CollisionSystem collisionSystem;
+    scheduler.addSystem(&rigidBodyInputSystem);
+    scheduler.addSystem(&updatePhysicsSystem);
+    scheduler.addSystem(&rigidBodyOutputSystem);
+    scheduler.addSystem(&bulletToOgreSystem);
+    scheduler.addSystem(&collisionSystem);
+    // Each of them touches the bodies or the physics world
+    ASSERT_EQ(5u, scheduler.stageCount());
+    EXPECT_EQ((std::vector<System*>{&rigidBodyInputSystem}), scheduler.stage(0));
+    EXPECT_EQ((std::vector<System*>{&updatePhysicsSystem}), scheduler.stage(1));
+    EXPECT_EQ((std::vector<System*>{&rigidBodyOutputSystem}), scheduler.stage(2));
+    EXPECT_EQ((std::vector<System*>{&bulletToOgreSystem}), scheduler.stage(3));
+    EXPECT_EQ((std::vector<System*>{&collisionSystem}), scheduler.stage(4));
+    expectNoConflicts(scheduler);
+}
+
+
+TEST(MicrobeStageSystems, CollisionsDontRunNextToThePhysicsWorld) {
+    ThreadPool pool(2);
+    SystemScheduler scheduler(pool);
+    CompoundMovementSystem compoundMovementSystem;
+    CollisionSystem collisionSystem;
+    scheduler.addSystem(&compoundMovementSystem);
+    scheduler.addSystem(&collisionSystem);
+    EXPECT_EQ(2u, scheduler.stageCount());
+    expectNoConflicts(scheduler);
+}
@@ -223,7 +223,7 @@ OgreSceneNodeComponent::attachSoundListener() {
     m_attachToListener.touch();
 }
 
-REGISTER_COMPONENT(OgreSceneNodeComponent)
+REGISTER_COMPONENT_THREAD_SAFE(OgreSceneNodeComponent, Dense)
 
 ////////////////////////////////////////////////////////////////////////////////
 // OgreAddSceneNodeSystem
@@ -53,7 +53,10 @@ struct ScriptEntityFilter::Implementation {
         if (not m_entityManager or m_requiredComponents.empty()) {
             return false;
         }
-        for (ComponentTypeId typeId : m_requiredComponents) {
+        if (not m_entityManager->hasComponents(id, m_requiredSignature)) {
+            return false;
+        }
+        for (ComponentTypeId typeId : m_unsignedComponents) {
             if (not m_entityManager->getComponent(id, typeId)) {
                 return false;
             }
@@ -61,6 +64,21 @@ struct ScriptEntityFilter::Implementation {
         return true;
     }
 
+    void
+    initSignature() {
+        m_requiredSignature.reset();
+        m_unsignedComponents.clear();
+        for (ComponentTypeId typeId : m_requiredComponents) {
+            size_t bit = m_entityManager->componentBit(typeId);
+            if (bit == ComponentSignature::NO_BIT) {
+                m_unsignedComponents.push_back(typeId);
+            }
+            else {
+                m_requiredSignature.set(bit);
+            }
+        }
+    }
+
     void
     registerCallbacks() {
         for (ComponentTypeId typeId : m_requiredComponents) {
@@ -93,6 +111,7 @@ struct ScriptEntityFilter::Implementation {
         m_removedEntities.clear();
         m_entities.clear();
         if (entityManager) {
+            this->initSignature();
             this->initialize();
             this->registerCallbacks();
         }
@@ -133,6 +152,11 @@ struct ScriptEntityFilter::Implementation {
 
     std::unordered_set<ComponentTypeId> m_requiredComponents;
 
+    ComponentSignature m_requiredSignature;
+
+    // Required types that don't fit into the signature
+    std::vector<ComponentTypeId> m_unsignedComponents;
+
 };
 
 void ScriptEntityFilter::luaBindings(
@@ -11,13 +11,17 @@
 
 
 #include "engine/entity_manager.h"
+#include "engine/entity_template.h"
 #include "engine/component.h"
 #include "engine/component_factory.h"
+#include "engine/component_signature.h"
+#include "engine/creation_library.h"
 #include "engine/engine.h"
 #include "engine/entity.h"
 #include "engine/game_state.h"
 #include "engine/serialization.h"
 #include "engine/system.h"
+#include "engine/system_scheduler.h"
 #include "engine/touchable.h"
 #include "engine/player_data.h"
 #include "engine/rng.h"
@@ -251,13 +255,18 @@ void bindClassesToLua(sol::state &lua){
     {
         StorageContainer::luaBindings(lua);
         StorageList::luaBindings(lua);
+        StorageView::luaBindings(lua);
+        CreationLibrary::luaBindings(lua);
 
         System::luaBindings(lua);
+        SystemScheduler::luaBindings(lua);
         Component::luaBindings(lua);
         ComponentWrapper::luaBindings(lua);
         ComponentFactory::luaBindings(lua);
+        ComponentSignature::luaBindings(lua);
 
         EntityManager::luaBindings(lua);
+        EntityTemplate::luaBindings(lua);
         Entity::luaBindings(lua);
 
         Touchable::luaBindings(lua);